@@ -0,0 +1,300 @@
+﻿#include "aes_engine.h"
+#include <string.h>
+#include "aes_tables.h"
+#include "cpu_features.h"
+
+namespace crypto {
+
+// aes_ni.cc; stubs off x86.
+void AesNiEncryptBlocks(const AesKeySchedule &schedule, const uint8_t *in,
+                        uint8_t *out, size_t blocks);
+void AesNiDecryptBlocks(const AesKeySchedule &schedule, const uint8_t *in,
+                        uint8_t *out, size_t blocks);
+void AesNiCbcEncrypt(const AesKeySchedule &schedule, uint8_t *iv,
+                     const uint8_t *in, uint8_t *out, size_t blocks);
+void AesNiCbcDecrypt(const AesKeySchedule &schedule, uint8_t *iv,
+                     const uint8_t *in, uint8_t *out, size_t blocks);
+void AesNiCtrCrypt(const AesKeySchedule &schedule, uint8_t *counter,
+                   const uint8_t *in, uint8_t *out, size_t size);
+
+namespace {
+
+inline uint32_t LoadWord(const uint8_t *p) {
+  return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) |
+         (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+inline void StoreWord(uint32_t word, uint8_t *p) {
+  p[0] = static_cast<uint8_t>(word >> 24);
+  p[1] = static_cast<uint8_t>(word >> 16);
+  p[2] = static_cast<uint8_t>(word >> 8);
+  p[3] = static_cast<uint8_t>(word);
+}
+
+inline uint32_t SubWord(uint32_t word) {
+  const uint8_t *s = kAesSBoxes.forward;
+  return PackColumn(s[word >> 24], s[(word >> 16) & 255], s[(word >> 8) & 255],
+                    s[word & 255]);
+}
+
+// InvMixColumns of one column: undo the S-box, then look the byte up in
+// the decryption tables, which fold InvMixColumns over InvS.
+inline uint32_t InvMixColumn(uint32_t word) {
+  const uint8_t *s = kAesSBoxes.forward;
+  const AesRoundTables &t = kAesRoundTables;
+  return t.decrypt[0][s[word >> 24]] ^ t.decrypt[1][s[(word >> 16) & 255]] ^
+         t.decrypt[2][s[(word >> 8) & 255]] ^ t.decrypt[3][s[word & 255]];
+}
+
+void TableEncryptBlocks(const AesKeySchedule &schedule,
+                        const uint8_t *in,
+                        uint8_t *out,
+                        size_t blocks) {
+  const uint32_t (*t)[256] = kAesRoundTables.encrypt;
+  const uint8_t *s = kAesSBoxes.forward;
+  for (size_t b = 0; b < blocks; b++) {
+    const uint8_t *k = schedule.encrypt[0];
+    uint32_t s0 = LoadWord(in) ^ LoadWord(k);
+    uint32_t s1 = LoadWord(in + 4) ^ LoadWord(k + 4);
+    uint32_t s2 = LoadWord(in + 8) ^ LoadWord(k + 8);
+    uint32_t s3 = LoadWord(in + 12) ^ LoadWord(k + 12);
+    for (int r = 1; r < schedule.rounds; r++) {
+      k = schedule.encrypt[r];
+      uint32_t t0 = t[0][s0 >> 24] ^ t[1][(s1 >> 16) & 255] ^
+                    t[2][(s2 >> 8) & 255] ^ t[3][s3 & 255] ^ LoadWord(k);
+      uint32_t t1 = t[0][s1 >> 24] ^ t[1][(s2 >> 16) & 255] ^
+                    t[2][(s3 >> 8) & 255] ^ t[3][s0 & 255] ^ LoadWord(k + 4);
+      uint32_t t2 = t[0][s2 >> 24] ^ t[1][(s3 >> 16) & 255] ^
+                    t[2][(s0 >> 8) & 255] ^ t[3][s1 & 255] ^ LoadWord(k + 8);
+      uint32_t t3 = t[0][s3 >> 24] ^ t[1][(s0 >> 16) & 255] ^
+                    t[2][(s1 >> 8) & 255] ^ t[3][s2 & 255] ^ LoadWord(k + 12);
+      s0 = t0;
+      s1 = t1;
+      s2 = t2;
+      s3 = t3;
+    }
+    // No MixColumns in the last round.
+    k = schedule.encrypt[schedule.rounds];
+    StoreWord(PackColumn(s[s0 >> 24], s[(s1 >> 16) & 255],
+                         s[(s2 >> 8) & 255], s[s3 & 255]) ^ LoadWord(k), out);
+    StoreWord(PackColumn(s[s1 >> 24], s[(s2 >> 16) & 255],
+                         s[(s3 >> 8) & 255], s[s0 & 255]) ^ LoadWord(k + 4),
+              out + 4);
+    StoreWord(PackColumn(s[s2 >> 24], s[(s3 >> 16) & 255],
+                         s[(s0 >> 8) & 255], s[s1 & 255]) ^ LoadWord(k + 8),
+              out + 8);
+    StoreWord(PackColumn(s[s3 >> 24], s[(s0 >> 16) & 255],
+                         s[(s1 >> 8) & 255], s[s2 & 255]) ^ LoadWord(k + 12),
+              out + 12);
+    in += AES_BLOCK_SIZE;
+    out += AES_BLOCK_SIZE;
+  }
+}
+
+// Same structure with InvShiftRows taking bytes from the other side.
+void TableDecryptBlocks(const AesKeySchedule &schedule,
+                        const uint8_t *in,
+                        uint8_t *out,
+                        size_t blocks) {
+  const uint32_t (*t)[256] = kAesRoundTables.decrypt;
+  const uint8_t *v = kAesSBoxes.inverse;
+  for (size_t b = 0; b < blocks; b++) {
+    const uint8_t *k = schedule.decrypt[0];
+    uint32_t s0 = LoadWord(in) ^ LoadWord(k);
+    uint32_t s1 = LoadWord(in + 4) ^ LoadWord(k + 4);
+    uint32_t s2 = LoadWord(in + 8) ^ LoadWord(k + 8);
+    uint32_t s3 = LoadWord(in + 12) ^ LoadWord(k + 12);
+    for (int r = 1; r < schedule.rounds; r++) {
+      k = schedule.decrypt[r];
+      uint32_t t0 = t[0][s0 >> 24] ^ t[1][(s3 >> 16) & 255] ^
+                    t[2][(s2 >> 8) & 255] ^ t[3][s1 & 255] ^ LoadWord(k);
+      uint32_t t1 = t[0][s1 >> 24] ^ t[1][(s0 >> 16) & 255] ^
+                    t[2][(s3 >> 8) & 255] ^ t[3][s2 & 255] ^ LoadWord(k + 4);
+      uint32_t t2 = t[0][s2 >> 24] ^ t[1][(s1 >> 16) & 255] ^
+                    t[2][(s0 >> 8) & 255] ^ t[3][s3 & 255] ^ LoadWord(k + 8);
+      uint32_t t3 = t[0][s3 >> 24] ^ t[1][(s2 >> 16) & 255] ^
+                    t[2][(s1 >> 8) & 255] ^ t[3][s0 & 255] ^ LoadWord(k + 12);
+      s0 = t0;
+      s1 = t1;
+      s2 = t2;
+      s3 = t3;
+    }
+    k = schedule.decrypt[schedule.rounds];
+    StoreWord(PackColumn(v[s0 >> 24], v[(s3 >> 16) & 255],
+                         v[(s2 >> 8) & 255], v[s1 & 255]) ^ LoadWord(k), out);
+    StoreWord(PackColumn(v[s1 >> 24], v[(s0 >> 16) & 255],
+                         v[(s3 >> 8) & 255], v[s2 & 255]) ^ LoadWord(k + 4),
+              out + 4);
+    StoreWord(PackColumn(v[s2 >> 24], v[(s1 >> 16) & 255],
+                         v[(s0 >> 8) & 255], v[s3 & 255]) ^ LoadWord(k + 8),
+              out + 8);
+    StoreWord(PackColumn(v[s3 >> 24], v[(s2 >> 16) & 255],
+                         v[(s1 >> 8) & 255], v[s0 & 255]) ^ LoadWord(k + 12),
+              out + 12);
+    in += AES_BLOCK_SIZE;
+    out += AES_BLOCK_SIZE;
+  }
+}
+
+}  // namespace
+
+bool ExpandAesKey(std::string_view key, AesKeySchedule *schedule) {
+  size_t nk = key.size() / 4;
+  if (key.size() != 16 && key.size() != 24 && key.size() != 32)
+    return false;
+  schedule->rounds = static_cast<int>(nk) + 6;
+  size_t total = 4 * (schedule->rounds + 1);
+
+  uint32_t w[4 * (AES_MAX_ROUNDS + 1)];
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(key.data());
+  for (size_t i = 0; i < nk; i++)
+    w[i] = LoadWord(bytes + 4 * i);
+  uint8_t rcon = 1;
+  for (size_t i = nk; i < total; i++) {
+    uint32_t temp = w[i - 1];
+    if (i % nk == 0) {
+      temp = SubWord((temp << 8) | (temp >> 24)) ^ (uint32_t(rcon) << 24);
+      rcon = GfMultiply(rcon, 2);
+    } else if (nk > 6 && i % nk == 4) {
+      temp = SubWord(temp);
+    }
+    w[i] = w[i - nk] ^ temp;
+  }
+
+  int rounds = schedule->rounds;
+  for (int r = 0; r <= rounds; r++) {
+    for (int c = 0; c < 4; c++) {
+      uint32_t word = w[4 * r + c];
+      StoreWord(word, schedule->encrypt[r] + 4 * c);
+      if (r != 0 && r != rounds)
+        word = InvMixColumn(word);
+      StoreWord(word, schedule->decrypt[rounds - r] + 4 * c);
+    }
+  }
+  SecureZero(w, sizeof(w));
+  return true;
+}
+
+KeyCache<AesKeySchedule>::Entry GetAesKeySchedule(
+    KeyCache<AesKeySchedule> *cache,
+    std::string_view key) {
+  if (key.size() != 16 && key.size() != 24 && key.size() != 32)
+    return nullptr;
+  return cache->Get(key, [](std::string_view raw) {
+    KeyCache<AesKeySchedule>::Entry entry(
+        new AesKeySchedule,
+        [](AesKeySchedule *p) {
+          SecureZero(p, sizeof(*p));
+          delete p;
+        });
+    ExpandAesKey(raw, entry.get());
+    return entry;
+  });
+}
+
+bool IsAesNiEnabled() {
+  static const bool enabled = GetCpuFeatures().aesni;
+  return enabled;
+}
+
+void AesEncryptBlocks(const AesKeySchedule &schedule,
+                      const uint8_t *in,
+                      uint8_t *out,
+                      size_t blocks) {
+  if (IsAesNiEnabled())
+    AesNiEncryptBlocks(schedule, in, out, blocks);
+  else
+    TableEncryptBlocks(schedule, in, out, blocks);
+}
+
+void AesDecryptBlocks(const AesKeySchedule &schedule,
+                      const uint8_t *in,
+                      uint8_t *out,
+                      size_t blocks) {
+  if (IsAesNiEnabled())
+    AesNiDecryptBlocks(schedule, in, out, blocks);
+  else
+    TableDecryptBlocks(schedule, in, out, blocks);
+}
+
+void AesCbcEncrypt(const AesKeySchedule &schedule,
+                   uint8_t iv[AES_BLOCK_SIZE],
+                   const uint8_t *in,
+                   uint8_t *out,
+                   size_t blocks) {
+  if (IsAesNiEnabled()) {
+    AesNiCbcEncrypt(schedule, iv, in, out, blocks);
+    return;
+  }
+  for (size_t b = 0; b < blocks; b++) {
+    XorBytes(iv, in + b * AES_BLOCK_SIZE, iv, AES_BLOCK_SIZE);
+    TableEncryptBlocks(schedule, iv, iv, 1);
+    memcpy(out + b * AES_BLOCK_SIZE, iv, AES_BLOCK_SIZE);
+  }
+}
+
+// As TripleDesCbcDecrypt(): each chunk's ciphertext is saved so that the
+// XOR still has it when decrypting in place.
+void AesCbcDecrypt(const AesKeySchedule &schedule,
+                   uint8_t iv[AES_BLOCK_SIZE],
+                   const uint8_t *in,
+                   uint8_t *out,
+                   size_t blocks) {
+  if (IsAesNiEnabled()) {
+    AesNiCbcDecrypt(schedule, iv, in, out, blocks);
+    return;
+  }
+  uint8_t saved[CHAIN_CHUNK_BYTES];
+  const size_t chunk_blocks = CHAIN_CHUNK_BYTES / AES_BLOCK_SIZE;
+  while (blocks > 0) {
+    size_t count = blocks < chunk_blocks ? blocks : chunk_blocks;
+    size_t size = count * AES_BLOCK_SIZE;
+    memcpy(saved, in, size);
+    TableDecryptBlocks(schedule, saved, out, count);
+    XorBytes(out, iv, out, AES_BLOCK_SIZE);
+    XorBytes(out + AES_BLOCK_SIZE, saved, out + AES_BLOCK_SIZE,
+             size - AES_BLOCK_SIZE);
+    memcpy(iv, saved + size - AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+    in += size;
+    out += size;
+    blocks -= count;
+  }
+}
+
+void AesCtrCrypt(const AesKeySchedule &schedule,
+                 uint8_t counter[AES_BLOCK_SIZE],
+                 const uint8_t *in,
+                 uint8_t *out,
+                 size_t size) {
+  if (IsAesNiEnabled()) {
+    AesNiCtrCrypt(schedule, counter, in, out, size);
+    return;
+  }
+  uint8_t keystream[CHAIN_CHUNK_BYTES];
+  while (size > 0) {
+    size_t count = size < CHAIN_CHUNK_BYTES ? size : CHAIN_CHUNK_BYTES;
+    size_t blocks = (count + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE;
+    FillCounterBlocks(counter, AES_BLOCK_SIZE, keystream, blocks);
+    TableEncryptBlocks(schedule, keystream, keystream, blocks);
+    XorBytes(in, keystream, out, count);
+    in += count;
+    out += count;
+    size -= count;
+  }
+  SecureZero(keystream, sizeof(keystream));
+}
+
+#if !defined(_M_X64) && !defined(_M_IX86) && !defined(__x86_64__) && !defined(__i386__)
+void AesNiEncryptBlocks(const AesKeySchedule &, const uint8_t *, uint8_t *,
+                        size_t) {}
+void AesNiDecryptBlocks(const AesKeySchedule &, const uint8_t *, uint8_t *,
+                        size_t) {}
+void AesNiCbcEncrypt(const AesKeySchedule &, uint8_t *, const uint8_t *,
+                     uint8_t *, size_t) {}
+void AesNiCbcDecrypt(const AesKeySchedule &, uint8_t *, const uint8_t *,
+                     uint8_t *, size_t) {}
+void AesNiCtrCrypt(const AesKeySchedule &, uint8_t *, const uint8_t *,
+                   uint8_t *, size_t) {}
+#endif
+
+} //crypto
\ No newline at end of file
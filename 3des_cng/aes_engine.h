@@ -0,0 +1,73 @@
+﻿#ifndef AES_ENGINE_H_
+#define AES_ENGINE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string_view>
+#include "chain_mode.h"
+#include "key_cache.h"
+
+namespace crypto {
+
+const int AES_BLOCK_SIZE = 16;
+const int AES_MAX_ROUNDS = 14;
+
+// Round keys of AES-128/192/256 as the bytes AddRoundKey XORs in.
+// |decrypt| is for the equivalent inverse cipher (FIPS 197 5.3.5): the
+// encryption keys in reverse order with InvMixColumns applied to the inner
+// ones, which is the form AESDEC expects.
+struct AesKeySchedule {
+  alignas(16) uint8_t encrypt[AES_MAX_ROUNDS + 1][AES_BLOCK_SIZE];
+  alignas(16) uint8_t decrypt[AES_MAX_ROUNDS + 1][AES_BLOCK_SIZE];
+  int rounds;
+};
+
+// False unless |key| is 16, 24 or 32 bytes. Unlike 3DES keys, AES keys are
+// never padded.
+bool ExpandAesKey(std::string_view key, AesKeySchedule *schedule);
+
+// |key|'s schedule from |cache|, expanded on a miss. Null for a key of the
+// wrong size. The schedule is wiped when released.
+KeyCache<AesKeySchedule>::Entry GetAesKeySchedule(
+    KeyCache<AesKeySchedule> *cache,
+    std::string_view key);
+
+// Whether the functions below run on AES-NI. Detected once; otherwise
+// they fall back to portable table code, which is several times slower
+// and, like the DES tables, not constant time.
+bool IsAesNiEnabled();
+
+// The same operations as the TripleDes* functions in des_engine.h, on
+// 16-byte blocks. ECB, CBC decryption and CTR keep eight blocks in flight
+// on AES-NI; CBC encryption is serial. |in| and |out| may be the same
+// buffer.
+void AesEncryptBlocks(const AesKeySchedule &schedule,
+                      const uint8_t *in,
+                      uint8_t *out,
+                      size_t blocks);
+
+void AesDecryptBlocks(const AesKeySchedule &schedule,
+                      const uint8_t *in,
+                      uint8_t *out,
+                      size_t blocks);
+
+void AesCbcEncrypt(const AesKeySchedule &schedule,
+                   uint8_t iv[AES_BLOCK_SIZE],
+                   const uint8_t *in,
+                   uint8_t *out,
+                   size_t blocks);
+
+void AesCbcDecrypt(const AesKeySchedule &schedule,
+                   uint8_t iv[AES_BLOCK_SIZE],
+                   const uint8_t *in,
+                   uint8_t *out,
+                   size_t blocks);
+
+void AesCtrCrypt(const AesKeySchedule &schedule,
+                 uint8_t counter[AES_BLOCK_SIZE],
+                 const uint8_t *in,
+                 uint8_t *out,
+                 size_t size);
+} //crypto
+
+#endif  //AES_ENGINE_H_
\ No newline at end of file
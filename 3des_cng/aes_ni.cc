@@ -0,0 +1,323 @@
+﻿#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "aes_engine.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <stdlib.h>
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("aes,sse2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("aes,sse2")
+#endif
+
+namespace crypto {
+namespace {
+
+// AESENC has a latency of several cycles but a throughput of one or two per
+// cycle, so eight independent blocks go through each round together.
+const size_t kLanes = 8;
+
+inline void LoadRoundKeys(const uint8_t (*keys)[AES_BLOCK_SIZE],
+                          int rounds,
+                          __m128i *k) {
+  for (int r = 0; r <= rounds; r++)
+    k[r] = _mm_load_si128(reinterpret_cast<const __m128i *>(keys[r]));
+}
+
+inline __m128i LoadBlock(const uint8_t *p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+
+inline void StoreBlock(uint8_t *p, __m128i block) {
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(p), block);
+}
+
+inline __m128i EncryptOne(const __m128i *k, int rounds, __m128i b) {
+  b = _mm_xor_si128(b, k[0]);
+  for (int r = 1; r < rounds; r++)
+    b = _mm_aesenc_si128(b, k[r]);
+  return _mm_aesenclast_si128(b, k[rounds]);
+}
+
+inline __m128i DecryptOne(const __m128i *k, int rounds, __m128i b) {
+  b = _mm_xor_si128(b, k[0]);
+  for (int r = 1; r < rounds; r++)
+    b = _mm_aesdec_si128(b, k[r]);
+  return _mm_aesdeclast_si128(b, k[rounds]);
+}
+
+// Eight named blocks rather than an array, which compilers tend to leave
+// on the stack instead of in registers.
+struct Lanes {
+  __m128i b0, b1, b2, b3, b4, b5, b6, b7;
+
+  void Load(const uint8_t *p) {
+    b0 = LoadBlock(p);
+    b1 = LoadBlock(p + 16);
+    b2 = LoadBlock(p + 32);
+    b3 = LoadBlock(p + 48);
+    b4 = LoadBlock(p + 64);
+    b5 = LoadBlock(p + 80);
+    b6 = LoadBlock(p + 96);
+    b7 = LoadBlock(p + 112);
+  }
+
+  void Store(uint8_t *p) const {
+    StoreBlock(p, b0);
+    StoreBlock(p + 16, b1);
+    StoreBlock(p + 32, b2);
+    StoreBlock(p + 48, b3);
+    StoreBlock(p + 64, b4);
+    StoreBlock(p + 80, b5);
+    StoreBlock(p + 96, b6);
+    StoreBlock(p + 112, b7);
+  }
+
+  // Each block XOR-ed with the matching block at |p|.
+  void Xor(const uint8_t *p) {
+    b0 = _mm_xor_si128(b0, LoadBlock(p));
+    b1 = _mm_xor_si128(b1, LoadBlock(p + 16));
+    b2 = _mm_xor_si128(b2, LoadBlock(p + 32));
+    b3 = _mm_xor_si128(b3, LoadBlock(p + 48));
+    b4 = _mm_xor_si128(b4, LoadBlock(p + 64));
+    b5 = _mm_xor_si128(b5, LoadBlock(p + 80));
+    b6 = _mm_xor_si128(b6, LoadBlock(p + 96));
+    b7 = _mm_xor_si128(b7, LoadBlock(p + 112));
+  }
+
+  template <__m128i (*Op)(__m128i, __m128i)>
+  void Apply(__m128i key) {
+    b0 = Op(b0, key);
+    b1 = Op(b1, key);
+    b2 = Op(b2, key);
+    b3 = Op(b3, key);
+    b4 = Op(b4, key);
+    b5 = Op(b5, key);
+    b6 = Op(b6, key);
+    b7 = Op(b7, key);
+  }
+};
+
+inline __m128i Xor(__m128i a, __m128i b) { return _mm_xor_si128(a, b); }
+inline __m128i Enc(__m128i a, __m128i b) { return _mm_aesenc_si128(a, b); }
+inline __m128i EncLast(__m128i a, __m128i b) {
+  return _mm_aesenclast_si128(a, b);
+}
+inline __m128i Dec(__m128i a, __m128i b) { return _mm_aesdec_si128(a, b); }
+inline __m128i DecLast(__m128i a, __m128i b) {
+  return _mm_aesdeclast_si128(a, b);
+}
+
+inline void EncryptLanes(const __m128i *k, int rounds, Lanes *lanes) {
+  lanes->Apply<Xor>(k[0]);
+  for (int r = 1; r < rounds; r++)
+    lanes->Apply<Enc>(k[r]);
+  lanes->Apply<EncLast>(k[rounds]);
+}
+
+inline void DecryptLanes(const __m128i *k, int rounds, Lanes *lanes) {
+  lanes->Apply<Xor>(k[0]);
+  for (int r = 1; r < rounds; r++)
+    lanes->Apply<Dec>(k[r]);
+  lanes->Apply<DecLast>(k[rounds]);
+}
+
+inline uint64_t ByteSwap64(uint64_t value) {
+#if defined(_MSC_VER)
+  return _byteswap_uint64(value);
+#else
+  return __builtin_bswap64(value);
+#endif
+}
+
+// The 128-bit big-endian counter as two native halves.
+struct Counter {
+  uint64_t high;
+  uint64_t low;
+
+  explicit Counter(const uint8_t *bytes) {
+    memcpy(&high, bytes, 8);
+    memcpy(&low, bytes + 8, 8);
+    high = ByteSwap64(high);
+    low = ByteSwap64(low);
+  }
+
+  void Store(uint8_t *bytes) const {
+    uint64_t h = ByteSwap64(high);
+    uint64_t l = ByteSwap64(low);
+    memcpy(bytes, &h, 8);
+    memcpy(bytes + 8, &l, 8);
+  }
+
+  // The current value as a block, then advanced by one.
+  __m128i Next() {
+    __m128i block = _mm_set_epi64x(static_cast<long long>(ByteSwap64(low)),
+                                   static_cast<long long>(ByteSwap64(high)));
+    if (++low == 0)
+      ++high;
+    return block;
+  }
+};
+
+}  // namespace
+
+void AesNiEncryptBlocks(const AesKeySchedule &schedule,
+                        const uint8_t *in,
+                        uint8_t *out,
+                        size_t blocks) {
+  __m128i k[AES_MAX_ROUNDS + 1];
+  int rounds = schedule.rounds;
+  LoadRoundKeys(schedule.encrypt, rounds, k);
+  Lanes lanes;
+  for (; blocks >= kLanes; blocks -= kLanes) {
+    lanes.Load(in);
+    EncryptLanes(k, rounds, &lanes);
+    lanes.Store(out);
+    in += kLanes * AES_BLOCK_SIZE;
+    out += kLanes * AES_BLOCK_SIZE;
+  }
+  for (; blocks > 0; blocks--) {
+    StoreBlock(out, EncryptOne(k, rounds, LoadBlock(in)));
+    in += AES_BLOCK_SIZE;
+    out += AES_BLOCK_SIZE;
+  }
+}
+
+void AesNiDecryptBlocks(const AesKeySchedule &schedule,
+                        const uint8_t *in,
+                        uint8_t *out,
+                        size_t blocks) {
+  __m128i k[AES_MAX_ROUNDS + 1];
+  int rounds = schedule.rounds;
+  LoadRoundKeys(schedule.decrypt, rounds, k);
+  Lanes lanes;
+  for (; blocks >= kLanes; blocks -= kLanes) {
+    lanes.Load(in);
+    DecryptLanes(k, rounds, &lanes);
+    lanes.Store(out);
+    in += kLanes * AES_BLOCK_SIZE;
+    out += kLanes * AES_BLOCK_SIZE;
+  }
+  for (; blocks > 0; blocks--) {
+    StoreBlock(out, DecryptOne(k, rounds, LoadBlock(in)));
+    in += AES_BLOCK_SIZE;
+    out += AES_BLOCK_SIZE;
+  }
+}
+
+void AesNiCbcEncrypt(const AesKeySchedule &schedule,
+                     uint8_t *iv,
+                     const uint8_t *in,
+                     uint8_t *out,
+                     size_t blocks) {
+  __m128i k[AES_MAX_ROUNDS + 1];
+  int rounds = schedule.rounds;
+  LoadRoundKeys(schedule.encrypt, rounds, k);
+  __m128i chain = LoadBlock(iv);
+  for (; blocks > 0; blocks--) {
+    chain = EncryptOne(k, rounds, _mm_xor_si128(chain, LoadBlock(in)));
+    StoreBlock(out, chain);
+    in += AES_BLOCK_SIZE;
+    out += AES_BLOCK_SIZE;
+  }
+  StoreBlock(iv, chain);
+}
+
+// All of a group is decrypted and XOR-ed before any of it is stored, so
+// |in| == |out| works without a copy.
+void AesNiCbcDecrypt(const AesKeySchedule &schedule,
+                     uint8_t *iv,
+                     const uint8_t *in,
+                     uint8_t *out,
+                     size_t blocks) {
+  __m128i k[AES_MAX_ROUNDS + 1];
+  int rounds = schedule.rounds;
+  LoadRoundKeys(schedule.decrypt, rounds, k);
+  __m128i chain = LoadBlock(iv);
+  Lanes lanes;
+  for (; blocks >= kLanes; blocks -= kLanes) {
+    lanes.Load(in);
+    // Every ciphertext block but the last is reloaded for the XOR, so the
+    // last one is all that must be kept for in-place use.
+    __m128i last = lanes.b7;
+    DecryptLanes(k, rounds, &lanes);
+    lanes.b0 = _mm_xor_si128(lanes.b0, chain);
+    lanes.b1 = _mm_xor_si128(lanes.b1, LoadBlock(in));
+    lanes.b2 = _mm_xor_si128(lanes.b2, LoadBlock(in + 16));
+    lanes.b3 = _mm_xor_si128(lanes.b3, LoadBlock(in + 32));
+    lanes.b4 = _mm_xor_si128(lanes.b4, LoadBlock(in + 48));
+    lanes.b5 = _mm_xor_si128(lanes.b5, LoadBlock(in + 64));
+    lanes.b6 = _mm_xor_si128(lanes.b6, LoadBlock(in + 80));
+    lanes.b7 = _mm_xor_si128(lanes.b7, LoadBlock(in + 96));
+    lanes.Store(out);
+    chain = last;
+    in += kLanes * AES_BLOCK_SIZE;
+    out += kLanes * AES_BLOCK_SIZE;
+  }
+  for (; blocks > 0; blocks--) {
+    __m128i cipher = LoadBlock(in);
+    StoreBlock(out, _mm_xor_si128(DecryptOne(k, rounds, cipher), chain));
+    chain = cipher;
+    in += AES_BLOCK_SIZE;
+    out += AES_BLOCK_SIZE;
+  }
+  StoreBlock(iv, chain);
+}
+
+void AesNiCtrCrypt(const AesKeySchedule &schedule,
+                   uint8_t *counter,
+                   const uint8_t *in,
+                   uint8_t *out,
+                   size_t size) {
+  __m128i k[AES_MAX_ROUNDS + 1];
+  int rounds = schedule.rounds;
+  LoadRoundKeys(schedule.encrypt, rounds, k);
+  Counter ctr(counter);
+  Lanes lanes;
+  const size_t lane_bytes = kLanes * AES_BLOCK_SIZE;
+  for (; size >= lane_bytes; size -= lane_bytes) {
+    lanes.b0 = ctr.Next();
+    lanes.b1 = ctr.Next();
+    lanes.b2 = ctr.Next();
+    lanes.b3 = ctr.Next();
+    lanes.b4 = ctr.Next();
+    lanes.b5 = ctr.Next();
+    lanes.b6 = ctr.Next();
+    lanes.b7 = ctr.Next();
+    EncryptLanes(k, rounds, &lanes);
+    lanes.Xor(in);
+    lanes.Store(out);
+    in += lane_bytes;
+    out += lane_bytes;
+  }
+  for (; size >= AES_BLOCK_SIZE; size -= AES_BLOCK_SIZE) {
+    StoreBlock(out, _mm_xor_si128(EncryptOne(k, rounds, ctr.Next()),
+                                  LoadBlock(in)));
+    in += AES_BLOCK_SIZE;
+    out += AES_BLOCK_SIZE;
+  }
+  if (size > 0) {
+    alignas(16) uint8_t keystream[AES_BLOCK_SIZE];
+    _mm_store_si128(reinterpret_cast<__m128i *>(keystream),
+                    EncryptOne(k, rounds, ctr.Next()));
+    XorBytes(in, keystream, out, size);
+    SecureZero(keystream, sizeof(keystream));
+  }
+  ctr.Store(counter);
+}
+
+} //crypto
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,202 @@
+﻿#include "aes_soft.h"
+#include <string.h>
+
+namespace crypto {
+
+CryptoAesSoft::CryptoAesSoft(Padding padding,
+                             ChainMode mode,
+                             size_t key_cache_capacity)
+    : padding_(padding),
+      mode_(mode),
+      block_size_(AES_BLOCK_SIZE),
+      initialized_(false),
+      key_cache_(key_cache_capacity) {}
+
+CryptoAesSoft::~CryptoAesSoft() {
+}
+
+bool CryptoAesSoft::Initialize() {
+  initialized_ = true;
+  return true;
+}
+
+size_t CryptoAesSoft::RequiredOutputSize(size_t plaintext_size) const {
+  if (mode_ == CTR)
+    return plaintext_size;
+  return PaddedSize(padding_, plaintext_size, block_size_);
+}
+
+bool CryptoAesSoft::DoEncrypt(const std::string &key,
+                              const std::string &plaintext,
+                              std::string *ciphertext) {
+  return DoEncrypt(key, std::string(), plaintext, ciphertext);
+}
+
+bool CryptoAesSoft::DoDecrypt(const std::string &key,
+                              const std::string &ciphertext,
+                              std::string *plaintext) {
+  return DoDecrypt(key, std::string(), ciphertext, plaintext);
+}
+
+bool CryptoAesSoft::DoEncrypt(const std::string &key,
+                              const std::string &iv,
+                              const std::string &plaintext,
+                              std::string *ciphertext) {
+  ciphertext->resize(RequiredOutputSize(plaintext.size()));
+  size_t size = 0;
+  bool result = DoEncrypt(
+      key,
+      std::span<const uint8_t>(reinterpret_cast<const uint8_t *>(iv.data()),
+                               iv.size()),
+      std::span<const uint8_t>(
+          reinterpret_cast<const uint8_t *>(plaintext.data()),
+          plaintext.size()),
+      std::span<uint8_t>(reinterpret_cast<uint8_t *>(ciphertext->data()),
+                         ciphertext->size()),
+      &size);
+  ciphertext->resize(size);
+  return result;
+}
+
+bool CryptoAesSoft::DoDecrypt(const std::string &key,
+                              const std::string &iv,
+                              const std::string &ciphertext,
+                              std::string *plaintext) {
+  plaintext->resize(ciphertext.size());
+  size_t size = 0;
+  bool result = DoDecrypt(
+      key,
+      std::span<const uint8_t>(reinterpret_cast<const uint8_t *>(iv.data()),
+                               iv.size()),
+      std::span<const uint8_t>(
+          reinterpret_cast<const uint8_t *>(ciphertext.data()),
+          ciphertext.size()),
+      std::span<uint8_t>(reinterpret_cast<uint8_t *>(plaintext->data()),
+                         plaintext->size()),
+      &size);
+  plaintext->resize(size);
+  return result;
+}
+
+bool CryptoAesSoft::DoEncrypt(const std::string &key,
+                              std::span<const uint8_t> plaintext,
+                              std::span<uint8_t> ciphertext,
+                              size_t *written) {
+  return DoEncrypt(key, std::span<const uint8_t>(), plaintext, ciphertext,
+                   written);
+}
+
+bool CryptoAesSoft::DoDecrypt(const std::string &key,
+                              std::span<const uint8_t> ciphertext,
+                              std::span<uint8_t> plaintext,
+                              size_t *written) {
+  return DoDecrypt(key, std::span<const uint8_t>(), ciphertext, plaintext,
+                   written);
+}
+
+bool CryptoAesSoft::DoEncrypt(const std::string &key,
+                              std::span<const uint8_t> iv,
+                              std::span<const uint8_t> plaintext,
+                              std::span<uint8_t> ciphertext,
+                              size_t *written) {
+  *written = 0;
+  if (!initialized_ || !IsValidIv(mode_, iv.size(), block_size_))
+    return false;
+
+  size_t buffer_size = RequiredOutputSize(plaintext.size());
+  if (ciphertext.size() < buffer_size)
+    return false;
+
+  KeyCache<AesKeySchedule>::Entry schedule =
+      GetAesKeySchedule(&key_cache_, key);
+  if (!schedule)
+    return false;
+
+  uint8_t *output = ciphertext.data();
+  if (mode_ == CTR) {
+    uint8_t counter[AES_BLOCK_SIZE];
+    memcpy(counter, iv.data(), AES_BLOCK_SIZE);
+    AesCtrCrypt(*schedule, counter, plaintext.data(), output,
+                plaintext.size());
+    *written = buffer_size;
+    return true;
+  }
+
+  if (output != plaintext.data() && !plaintext.empty())
+    memmove(output, plaintext.data(), plaintext.size());
+  ApplyPadding(padding_, output, plaintext.size(), buffer_size);
+
+  if (mode_ == CBC) {
+    uint8_t chain[AES_BLOCK_SIZE];
+    memcpy(chain, iv.data(), AES_BLOCK_SIZE);
+    AesCbcEncrypt(*schedule, chain, output, output,
+                  buffer_size / block_size_);
+  } else {
+    AesEncryptBlocks(*schedule, output, output, buffer_size / block_size_);
+  }
+  *written = buffer_size;
+  return true;
+}
+
+bool CryptoAesSoft::DoDecrypt(const std::string &key,
+                              std::span<const uint8_t> iv,
+                              std::span<const uint8_t> ciphertext,
+                              std::span<uint8_t> plaintext,
+                              size_t *written) {
+  *written = 0;
+  if (!initialized_ || !IsValidIv(mode_, iv.size(), block_size_))
+    return false;
+
+  size_t cipher_size = ciphertext.size();
+  if ((mode_ != CTR && cipher_size % block_size_) ||
+      plaintext.size() < cipher_size)
+    return false;
+
+  KeyCache<AesKeySchedule>::Entry schedule =
+      GetAesKeySchedule(&key_cache_, key);
+  if (!schedule)
+    return false;
+
+  if (cipher_size == 0)
+    return true;
+  uint8_t *output = plaintext.data();
+  uint8_t chain[AES_BLOCK_SIZE];
+  switch (mode_) {
+    case CTR:
+      memcpy(chain, iv.data(), AES_BLOCK_SIZE);
+      AesCtrCrypt(*schedule, chain, ciphertext.data(), output, cipher_size);
+      *written = cipher_size;
+      return true;
+    case CBC:
+      memcpy(chain, iv.data(), AES_BLOCK_SIZE);
+      AesCbcDecrypt(*schedule, chain, ciphertext.data(), output,
+                    cipher_size / block_size_);
+      break;
+    default:
+      AesDecryptBlocks(*schedule, ciphertext.data(), output,
+                       cipher_size / block_size_);
+      break;
+  }
+
+  *written = cipher_size - PaddingLength(padding_, output, cipher_size);
+  return true;
+}
+
+bool CryptoAesSoft::DoEncryptInPlace(const std::string &key,
+                                     std::span<uint8_t> buffer,
+                                     size_t size,
+                                     size_t *written) {
+  if (size > buffer.size()) {
+    *written = 0;
+    return false;
+  }
+  return DoEncrypt(key, buffer.first(size), buffer, written);
+}
+
+bool CryptoAesSoft::DoDecryptInPlace(const std::string &key,
+                                     std::span<uint8_t> buffer,
+                                     size_t *written) {
+  return DoDecrypt(key, buffer, buffer, written);
+}
+
+} //crypto
\ No newline at end of file
@@ -0,0 +1,142 @@
+﻿#ifndef AES_SOFT_H_
+#define AES_SOFT_H_
+
+#include <stdint.h>
+#include <span>
+#include <string>
+#include <string_view>
+#include "aes_engine.h"
+#include "chain_mode.h"
+#include "key_cache.h"
+#include "padding.h"
+
+namespace crypto {
+
+// AES-128/192/256, picked by the key size, with the interface of
+// Crypto3DesSoft: the same padding modes and chaining modes on 16-byte
+// blocks, so CBC and CTR take a 16-byte IV. Runs on AES-NI where the CPU
+// has it (aes_engine.h).
+class CryptoAesSoft {
+public:
+  explicit CryptoAesSoft(Padding padding,
+                         ChainMode mode = ECB,
+                         size_t key_cache_capacity = DEFAULT_KEY_CACHE_CAPACITY);
+
+  virtual ~CryptoAesSoft();
+
+  bool Initialize();
+
+  bool DoEncrypt(const std::string &key,
+                 const std::string &plaintext,
+                 std::string *ciphertext);
+
+  bool DoDecrypt(const std::string &key,
+                 const std::string &ciphertext,
+                 std::string *plaintext);
+
+  bool DoEncrypt(const std::string &key,
+                 const std::string &iv,
+                 const std::string &plaintext,
+                 std::string *ciphertext);
+
+  bool DoDecrypt(const std::string &key,
+                 const std::string &iv,
+                 const std::string &ciphertext,
+                 std::string *plaintext);
+
+  size_t RequiredOutputSize(size_t plaintext_size) const;
+
+  // Same buffer rules as Crypto3DesSoft's span overloads.
+  bool DoEncrypt(const std::string &key,
+                 std::span<const uint8_t> plaintext,
+                 std::span<uint8_t> ciphertext,
+                 size_t *written);
+
+  bool DoDecrypt(const std::string &key,
+                 std::span<const uint8_t> ciphertext,
+                 std::span<uint8_t> plaintext,
+                 size_t *written);
+
+  bool DoEncrypt(const std::string &key,
+                 std::span<const uint8_t> iv,
+                 std::span<const uint8_t> plaintext,
+                 std::span<uint8_t> ciphertext,
+                 size_t *written);
+
+  bool DoDecrypt(const std::string &key,
+                 std::span<const uint8_t> iv,
+                 std::span<const uint8_t> ciphertext,
+                 std::span<uint8_t> plaintext,
+                 size_t *written);
+
+  bool DoEncryptInPlace(const std::string &key,
+                        std::span<uint8_t> buffer,
+                        size_t size,
+                        size_t *written);
+
+  bool DoDecryptInPlace(const std::string &key,
+                        std::span<uint8_t> buffer,
+                        size_t *written);
+
+  KeyCache<AesKeySchedule> &key_cache() { return key_cache_; }
+private:
+  Padding padding_;
+  ChainMode mode_;
+  uint32_t block_size_;
+  bool initialized_;
+  KeyCache<AesKeySchedule> key_cache_;
+};
+
+// Backend policy for BlockCipher (block_cipher.h) on aes_engine.h.
+class AesBackend {
+public:
+  typedef KeyCache<AesKeySchedule>::Entry Key;
+
+  static constexpr size_t BLOCK_SIZE = AES_BLOCK_SIZE;
+
+  explicit AesBackend(size_t key_cache_capacity = DEFAULT_KEY_CACHE_CAPACITY)
+      : key_cache_(key_cache_capacity) {}
+
+  bool Initialize(ChainMode) { return true; }
+
+  Key GetKey(std::string_view key) {
+    return GetAesKeySchedule(&key_cache_, key);
+  }
+
+  template <ChainMode Mode>
+  bool Encrypt(const Key &key,
+               uint8_t *iv,
+               const uint8_t *in,
+               uint8_t *out,
+               size_t size) {
+    if constexpr (Mode == ECB)
+      AesEncryptBlocks(*key, in, out, size / BLOCK_SIZE);
+    else if constexpr (Mode == CBC)
+      AesCbcEncrypt(*key, iv, in, out, size / BLOCK_SIZE);
+    else
+      AesCtrCrypt(*key, iv, in, out, size);
+    return true;
+  }
+
+  template <ChainMode Mode>
+  bool Decrypt(const Key &key,
+               uint8_t *iv,
+               const uint8_t *in,
+               uint8_t *out,
+               size_t size) {
+    if constexpr (Mode == ECB)
+      AesDecryptBlocks(*key, in, out, size / BLOCK_SIZE);
+    else if constexpr (Mode == CBC)
+      AesCbcDecrypt(*key, iv, in, out, size / BLOCK_SIZE);
+    else
+      AesCtrCrypt(*key, iv, in, out, size);
+    return true;
+  }
+
+  KeyCache<AesKeySchedule> &key_cache() { return key_cache_; }
+private:
+  KeyCache<AesKeySchedule> key_cache_;
+};
+} //crypto
+
+#endif  //AES_SOFT_H_
\ No newline at end of file
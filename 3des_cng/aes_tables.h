@@ -0,0 +1,85 @@
+﻿#ifndef AES_TABLES_H_
+#define AES_TABLES_H_
+
+#include <stdint.h>
+
+namespace crypto {
+
+// FIPS 197 tables, generated by the compiler from the field arithmetic
+// rather than written out.
+
+constexpr uint8_t GfMultiply(uint8_t a, uint8_t b) {
+  uint8_t product = 0;
+  while (b) {
+    if (b & 1)
+      product ^= a;
+    a = static_cast<uint8_t>((a << 1) ^ ((a & 0x80) ? 0x1b : 0));
+    b >>= 1;
+  }
+  return product;
+}
+
+struct AesSBoxes {
+  uint8_t forward[256];
+  uint8_t inverse[256];
+};
+
+// Multiplicative inverse in GF(2^8) followed by the affine map.
+constexpr AesSBoxes MakeAesSBoxes() {
+  AesSBoxes boxes = {};
+  for (int x = 0; x < 256; x++) {
+    uint8_t inverse = 0;
+    for (int y = 1; y < 256 && x != 0; y++) {
+      if (GfMultiply(static_cast<uint8_t>(x), static_cast<uint8_t>(y)) == 1) {
+        inverse = static_cast<uint8_t>(y);
+        break;
+      }
+    }
+    uint8_t s = inverse;
+    for (int i = 1; i < 5; i++)
+      s ^= static_cast<uint8_t>((inverse << i) | (inverse >> (8 - i)));
+    s ^= 0x63;
+    boxes.forward[x] = s;
+    boxes.inverse[s] = static_cast<uint8_t>(x);
+  }
+  return boxes;
+}
+
+inline constexpr AesSBoxes kAesSBoxes = MakeAesSBoxes();
+
+// Round tables for 32-bit big-endian columns: encrypt[0][x] is the column
+// MixColumns makes of S(x) in row 0, and table i is table 0 rotated right
+// by 8 * i bits. decrypt[] is the same for InvS and InvMixColumns.
+struct AesRoundTables {
+  uint32_t encrypt[4][256];
+  uint32_t decrypt[4][256];
+};
+
+constexpr uint32_t RotateRight32(uint32_t value, int count) {
+  return count == 0 ? value : (value >> count) | (value << (32 - count));
+}
+
+constexpr uint32_t PackColumn(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+  return (uint32_t(a) << 24) | (uint32_t(b) << 16) | (uint32_t(c) << 8) | d;
+}
+
+constexpr AesRoundTables MakeAesRoundTables() {
+  AesRoundTables tables = {};
+  for (int x = 0; x < 256; x++) {
+    uint8_t s = kAesSBoxes.forward[x];
+    uint8_t v = kAesSBoxes.inverse[x];
+    uint32_t e = PackColumn(GfMultiply(s, 2), s, s, GfMultiply(s, 3));
+    uint32_t d = PackColumn(GfMultiply(v, 14), GfMultiply(v, 9),
+                            GfMultiply(v, 13), GfMultiply(v, 11));
+    for (int i = 0; i < 4; i++) {
+      tables.encrypt[i][x] = RotateRight32(e, 8 * i);
+      tables.decrypt[i][x] = RotateRight32(d, 8 * i);
+    }
+  }
+  return tables;
+}
+
+inline constexpr AesRoundTables kAesRoundTables = MakeAesRoundTables();
+} //crypto
+
+#endif  //AES_TABLES_H_
\ No newline at end of file
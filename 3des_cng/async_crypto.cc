@@ -0,0 +1,36 @@
+﻿#include "async_crypto.h"
+#include <thread>
+
+namespace crypto {
+
+CompletionQueue::CompletionQueue(std::function<void()> wakeup)
+    : wakeup_(std::move(wakeup)),
+      scheduled_(false) {}
+
+void CompletionQueue::Push(Completion *completion) {
+  queue_.Push(completion);
+  // Pairs with the store in Drain(): either that drain pops this
+  // completion, or this push schedules another one.
+  if (!scheduled_.exchange(true, std::memory_order_seq_cst))
+    wakeup_();
+}
+
+size_t CompletionQueue::Drain() {
+  scheduled_.store(false, std::memory_order_seq_cst);
+  size_t count = 0;
+  for (;;) {
+    base::MpscQueue::Node *node = queue_.Pop();
+    if (!node) {
+      if (queue_.Empty())
+        break;
+      // A worker is half way through its push.
+      std::this_thread::yield();
+      continue;
+    }
+    ++count;
+    static_cast<Completion *>(node)->handle.resume();
+  }
+  return count;
+}
+
+} //crypto
\ No newline at end of file
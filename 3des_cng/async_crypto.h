@@ -0,0 +1,217 @@
+﻿#ifndef ASYNC_CRYPTO_H_
+#define ASYNC_CRYPTO_H_
+
+#include <stddef.h>
+#include <atomic>
+#include <coroutine>
+#include <functional>
+#include <future>
+#include <string>
+#include <utility>
+#include "crypto_service.h"
+#include "../winrt_thread/mpsc_queue.h"
+#include "../winrt_thread/work_stealing_pool.h"
+
+namespace crypto {
+
+// Below this many input bytes an async call runs inline on the caller:
+// 3DES gets through it in about the time a hand-off to a worker and back
+// costs.
+const size_t DEFAULT_ASYNC_INLINE_SIZE = 2 * 1024;
+
+struct AsyncResult {
+  bool success;
+  std::string data;
+};
+
+// Coroutines whose crypto work finished on a pool worker, waiting to be
+// resumed on the thread that owns the queue (typically an event loop).
+// Workers push without a lock; |wakeup| is called only for the first
+// completion after a Drain(), so a burst of completions costs the owner a
+// single wakeup and a single Drain().
+class CompletionQueue {
+public:
+  struct Completion : public base::MpscQueue::Node {
+    std::coroutine_handle<> handle;
+  };
+
+  // |wakeup| runs on a worker thread and must arrange for Drain() to be
+  // called on the owning thread, e.g. by posting it to a TaskRunnerThread
+  // or signalling the loop's eventfd.
+  explicit CompletionQueue(std::function<void()> wakeup);
+
+  CompletionQueue(const CompletionQueue &) = delete;
+  CompletionQueue &operator=(const CompletionQueue &) = delete;
+
+  // Any thread.
+  void Push(Completion *completion);
+
+  // Owning thread only. Resumes every coroutine completed so far, in
+  // completion order, and returns how many.
+  size_t Drain();
+
+private:
+  const std::function<void()> wakeup_;
+  base::MpscQueue queue_;
+  // Set by the push that called |wakeup_|, cleared by Drain().
+  std::atomic<bool> scheduled_;
+};
+
+// Runs DoEncrypt()/DoDecrypt() of a CryptoService<Cipher> on the workers of
+// a WorkStealingPool, so that a coroutine can encrypt a large payload
+// without blocking its thread:
+//
+//   AsyncResult result = co_await async.EncryptAsync(key, std::move(data));
+//
+// Each worker uses its own context from |service|. The awaited operation
+// lives in the coroutine frame, so a call allocates nothing beyond the
+// output. Finished coroutines are resumed through |completions| when one is
+// given, otherwise directly on the worker. Inputs smaller than
+// |inline_size| never suspend.
+//
+// |service|, |pool| (started) and |completions| must outlive every call.
+template <typename Cipher>
+class AsyncCrypto {
+public:
+  class Operation : public base::WorkStealingPool::Delegate,
+                    private CompletionQueue::Completion {
+  public:
+    Operation(AsyncCrypto *owner, bool encrypt,
+              std::string key, std::string input)
+        : owner_(owner),
+          encrypt_(encrypt),
+          key_(std::move(key)),
+          input_(std::move(input)) {
+      result_.success = false;
+    }
+
+    Operation(const Operation &) = delete;
+    Operation &operator=(const Operation &) = delete;
+
+    bool await_ready() {
+      if (input_.size() >= owner_->inline_size_)
+        return false;
+      Crypt();
+      return true;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+      this->handle = handle;
+      owner_->pool_->AddWork(this);
+    }
+
+    AsyncResult await_resume() { return std::move(result_); }
+
+    // On a pool worker.
+    void Run() override {
+      Crypt();
+      CompletionQueue *completions = owner_->completions_;
+      // Either call may destroy this operation along with its frame.
+      if (completions)
+        completions->Push(this);
+      else
+        this->handle.resume();
+    }
+
+  private:
+    void Crypt() {
+      Cipher *cipher = owner_->service_->GetForCurrentThread();
+      if (!cipher)
+        return;
+      result_.success = encrypt_
+          ? cipher->DoEncrypt(key_, input_, &result_.data)
+          : cipher->DoDecrypt(key_, input_, &result_.data);
+    }
+
+    AsyncCrypto *const owner_;
+    const bool encrypt_;
+    const std::string key_;
+    const std::string input_;
+    AsyncResult result_;
+  };
+
+  AsyncCrypto(CryptoService<Cipher> *service,
+              base::WorkStealingPool *pool,
+              CompletionQueue *completions = nullptr,
+              size_t inline_size = DEFAULT_ASYNC_INLINE_SIZE)
+      : service_(service),
+        pool_(pool),
+        completions_(completions),
+        inline_size_(inline_size) {}
+
+  AsyncCrypto(const AsyncCrypto &) = delete;
+  AsyncCrypto &operator=(const AsyncCrypto &) = delete;
+
+  // To be co_awaited.
+  Operation EncryptAsync(std::string key, std::string plaintext) {
+    return Operation(this, true, std::move(key), std::move(plaintext));
+  }
+
+  Operation DecryptAsync(std::string key, std::string ciphertext) {
+    return Operation(this, false, std::move(key), std::move(ciphertext));
+  }
+
+  // For callers that are not coroutines. The future is set on the worker;
+  // small inputs come back already set.
+  std::future<AsyncResult> EncryptFuture(std::string key,
+                                         std::string plaintext) {
+    return Submit(true, std::move(key), std::move(plaintext));
+  }
+
+  std::future<AsyncResult> DecryptFuture(std::string key,
+                                         std::string ciphertext) {
+    return Submit(false, std::move(key), std::move(ciphertext));
+  }
+
+private:
+  class FutureJob : public base::WorkStealingPool::Delegate {
+  public:
+    FutureJob(CryptoService<Cipher> *service, bool encrypt,
+              std::string key, std::string input)
+        : service_(service),
+          encrypt_(encrypt),
+          key_(std::move(key)),
+          input_(std::move(input)) {}
+
+    std::future<AsyncResult> GetFuture() { return promise_.get_future(); }
+
+    // Deletes the job.
+    void Run() override {
+      AsyncResult result;
+      result.success = encrypt_
+          ? service_->DoEncrypt(key_, input_, &result.data)
+          : service_->DoDecrypt(key_, input_, &result.data);
+      promise_.set_value(std::move(result));
+      delete this;
+    }
+
+  private:
+    CryptoService<Cipher> *const service_;
+    const bool encrypt_;
+    const std::string key_;
+    const std::string input_;
+    std::promise<AsyncResult> promise_;
+  };
+
+  std::future<AsyncResult> Submit(bool encrypt,
+                                  std::string key,
+                                  std::string input) {
+    bool run_inline = input.size() < inline_size_;
+    FutureJob *job = new FutureJob(service_, encrypt,
+                                   std::move(key), std::move(input));
+    std::future<AsyncResult> future = job->GetFuture();
+    if (run_inline)
+      job->Run();
+    else
+      pool_->AddWork(job);
+    return future;
+  }
+
+  CryptoService<Cipher> *const service_;
+  base::WorkStealingPool *const pool_;
+  CompletionQueue *const completions_;
+  const size_t inline_size_;
+};
+} //crypto
+
+#endif  //ASYNC_CRYPTO_H_
\ No newline at end of file
@@ -0,0 +1,361 @@
+﻿// Throughput and latency of DoEncrypt/DoDecrypt for every backend that
+// builds on this platform. Results go to stdout as JSON, one record per
+// (backend, operation, padding, key state, message size, threads).
+//
+// Linux:
+//   g++ -std=c++20 -O2 -pthread benchmark.cc aes_engine.cc aes_ni.cc
+//       aes_soft.cc chain_mode.cc cpu_features.cc des_bitslice.cc
+//       des_bitslice_sse2.cc des_bitslice_avx2.cc des_bitslice_avx512.cc
+//       des_engine.cc des_soft.cc padding.cc parallel_ecb.cc
+//       -o des_benchmark
+//
+// Options:
+//   --min-size=N --max-size=N  message sizes, stepping by 8x (8 .. 64 MB)
+//   --threads=N                caller threads, stepping by 2x (1 .. all)
+//   --min-time=S               seconds per measurement (0.2)
+//   --max-memory=N             skip cases needing more buffer bytes (1 GB)
+//   --backend=NAME             only run this backend
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <latch>
+#include <memory>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+#include "aes_soft.h"
+#include "block_cipher.h"
+#include "des_bitslice.h"
+#include "des_soft.h"
+#include "parallel_ecb.h"
+#if defined(_WIN32)
+#include "des.h"
+#endif
+
+namespace {
+
+using crypto::Padding;
+
+typedef std::chrono::steady_clock Clock;
+
+// Common face of the backends; each is shared by all caller threads.
+class Backend {
+public:
+  virtual ~Backend() {}
+  virtual const char *name() const = 0;
+  virtual size_t RequiredOutputSize(size_t size) const = 0;
+  virtual bool Encrypt(const std::string &key,
+                       std::span<const uint8_t> in,
+                       std::span<uint8_t> out,
+                       size_t *written) = 0;
+  virtual bool Decrypt(const std::string &key,
+                       std::span<const uint8_t> in,
+                       std::span<uint8_t> out,
+                       size_t *written) = 0;
+};
+
+template <typename T>
+class BackendAdapter : public Backend {
+public:
+  template <typename... Args>
+  BackendAdapter(const char *name, Args... args)
+      : name_(name), impl_(args...) {
+    impl_.Initialize();
+  }
+
+  const char *name() const override { return name_; }
+
+  size_t RequiredOutputSize(size_t size) const override {
+    return impl_.RequiredOutputSize(size);
+  }
+
+  bool Encrypt(const std::string &key,
+               std::span<const uint8_t> in,
+               std::span<uint8_t> out,
+               size_t *written) override {
+    return impl_.DoEncrypt(key, in, out, written);
+  }
+
+  bool Decrypt(const std::string &key,
+               std::span<const uint8_t> in,
+               std::span<uint8_t> out,
+               size_t *written) override {
+    return impl_.DoDecrypt(key, in, out, written);
+  }
+private:
+  const char *name_;
+  T impl_;
+};
+
+std::unique_ptr<Backend> CreateBackend(const std::string &name, Padding padding) {
+  if (name == "soft")
+    return std::make_unique<BackendAdapter<crypto::Crypto3DesSoft>>("soft", padding);
+  if (name == "block_cipher") {
+    if (padding == crypto::PKCS5)
+      return std::make_unique<BackendAdapter<crypto::BlockCipher<
+          crypto::SoftDesBackend, crypto::ECB, crypto::PKCS5>>>("block_cipher");
+    return std::make_unique<BackendAdapter<crypto::BlockCipher<
+        crypto::SoftDesBackend, crypto::ECB, crypto::NOPKCS>>>("block_cipher");
+  }
+  if (name == "parallel_ecb")
+    return std::make_unique<BackendAdapter<crypto::ParallelEcb>>("parallel_ecb",
+                                                                 padding);
+  // The 24-byte keys make this AES-192.
+  if (name == "aes")
+    return std::make_unique<BackendAdapter<crypto::CryptoAesSoft>>("aes", padding);
+#if defined(_WIN32)
+  if (name == "cng")
+    return std::make_unique<BackendAdapter<crypto::Crypto3DesCNG>>("cng", padding);
+#endif
+  return nullptr;
+}
+
+const char *const kBackends[] = {
+  "soft",
+  "block_cipher",
+  "parallel_ecb",
+  "aes",
+#if defined(_WIN32)
+  "cng",
+#endif
+};
+
+struct Options {
+  size_t min_size = 8;
+  size_t max_size = 64 << 20;
+  size_t max_threads = 0;
+  double min_time = 0.2;
+  size_t max_memory = size_t(1) << 30;
+  std::string backend;
+};
+
+struct Case {
+  Backend *backend;
+  bool encrypt;
+  Padding padding;
+  bool warm;
+  size_t size;
+  size_t threads;
+};
+
+struct Result {
+  uint64_t operations;
+  double seconds;
+  double p50_ns;
+  double p99_ns;
+  double max_ns;
+  bool ok;
+};
+
+// Warm runs reuse one key per thread; cold runs give every operation a key
+// the cache has never seen, so each call pays for expansion and eviction.
+std::string MakeKey(size_t thread, uint64_t serial) {
+  std::string key(crypto::DES3_KEY_SIZE, '\0');
+  for (int i = 0; i < 8; i++) {
+    key[i] = static_cast<char>(serial >> (8 * i));
+    key[8 + i] = static_cast<char>(thread >> (8 * i));
+  }
+  key[16] = 'b';
+  return key;
+}
+
+double Percentile(std::vector<double> *samples, double fraction) {
+  if (samples->empty())
+    return 0;
+  size_t index = static_cast<size_t>(fraction * (samples->size() - 1));
+  std::nth_element(samples->begin(), samples->begin() + index, samples->end());
+  return (*samples)[index];
+}
+
+Result Run(const Case &c, const Options &options, std::span<const uint8_t> input) {
+  Backend *backend = c.backend;
+  size_t out_size = std::max(backend->RequiredOutputSize(c.size), c.size);
+  std::vector<std::vector<uint8_t>> outputs(c.threads);
+  std::vector<std::vector<double>> latencies(c.threads);
+  std::vector<uint64_t> counts(c.threads);
+  std::atomic<bool> ok(true);
+
+  // Decryption runs on a real ciphertext of the thread's warm key.
+  std::vector<std::vector<uint8_t>> ciphertexts(c.threads);
+  for (size_t t = 0; t < c.threads; t++) {
+    outputs[t].resize(out_size);
+    if (!c.encrypt) {
+      ciphertexts[t].resize(backend->RequiredOutputSize(c.size));
+      size_t written;
+      if (!backend->Encrypt(MakeKey(t, 0), input, ciphertexts[t], &written))
+        ok = false;
+      ciphertexts[t].resize(written);
+    }
+  }
+
+  std::latch start(c.threads + 1);
+  std::atomic<bool> stop(false);
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < c.threads; t++) {
+    workers.emplace_back([&, t] {
+      std::span<const uint8_t> in = c.encrypt
+          ? input
+          : std::span<const uint8_t>(ciphertexts[t]);
+      std::string key = MakeKey(t, 0);
+      uint64_t serial = 0;
+      size_t written;
+      // One untimed call to fault in the buffers and, when warm, the key.
+      if (!(c.encrypt ? backend->Encrypt(key, in, outputs[t], &written)
+                      : backend->Decrypt(key, in, outputs[t], &written)))
+        ok = false;
+      start.arrive_and_wait();
+      while (!stop.load(std::memory_order_relaxed)) {
+        if (!c.warm)
+          key = MakeKey(t, ++serial);
+        Clock::time_point begin = Clock::now();
+        bool result = c.encrypt ? backend->Encrypt(key, in, outputs[t], &written)
+                                : backend->Decrypt(key, in, outputs[t], &written);
+        Clock::time_point end = Clock::now();
+        if (!result)
+          ok = false;
+        latencies[t].push_back(
+            std::chrono::duration<double, std::nano>(end - begin).count());
+        ++counts[t];
+      }
+    });
+  }
+
+  start.arrive_and_wait();
+  Clock::time_point begin = Clock::now();
+  std::this_thread::sleep_for(std::chrono::duration<double>(options.min_time));
+  stop = true;
+  for (std::thread &worker : workers)
+    worker.join();
+  Clock::time_point end = Clock::now();
+
+  Result result = {};
+  std::vector<double> all;
+  for (size_t t = 0; t < c.threads; t++) {
+    result.operations += counts[t];
+    all.insert(all.end(), latencies[t].begin(), latencies[t].end());
+  }
+  result.seconds = std::chrono::duration<double>(end - begin).count();
+  result.p50_ns = Percentile(&all, 0.50);
+  result.p99_ns = Percentile(&all, 0.99);
+  result.max_ns = all.empty() ? 0 : *std::max_element(all.begin(), all.end());
+  result.ok = ok;
+  return result;
+}
+
+bool ParseSize(const char *arg, const char *flag, size_t *value) {
+  size_t length = strlen(flag);
+  if (strncmp(arg, flag, length) != 0)
+    return false;
+  *value = strtoull(arg + length, nullptr, 10);
+  return true;
+}
+
+bool ParseOptions(int argc, char *argv[], Options *options) {
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    if (ParseSize(arg, "--min-size=", &options->min_size) ||
+        ParseSize(arg, "--max-size=", &options->max_size) ||
+        ParseSize(arg, "--threads=", &options->max_threads) ||
+        ParseSize(arg, "--max-memory=", &options->max_memory))
+      continue;
+    if (strncmp(arg, "--min-time=", 11) == 0) {
+      options->min_time = atof(arg + 11);
+    } else if (strncmp(arg, "--backend=", 10) == 0) {
+      options->backend = arg + 10;
+    } else {
+      fprintf(stderr, "unknown option %s\n", arg);
+      return false;
+    }
+  }
+  if (options->max_threads == 0)
+    options->max_threads = std::max(1u, std::thread::hardware_concurrency());
+  if (options->min_size == 0)
+    options->min_size = 1;
+  if (options->min_size > options->max_size) {
+    fprintf(stderr, "--min-size must not exceed --max-size\n");
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  Options options;
+  if (!ParseOptions(argc, argv, &options))
+    return 1;
+
+  std::vector<uint8_t> input(options.max_size);
+  uint64_t state = 0x9e3779b97f4a7c15ULL;
+  for (uint8_t &byte : input) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    byte = static_cast<uint8_t>(state >> 56);
+  }
+
+  printf("{\n  \"context\": {\"bitslice_isa\": \"%s\", \"hardware_threads\": %u, "
+         "\"min_time\": %g},\n  \"results\": [",
+         crypto::BitsliceIsaName(crypto::BestBitsliceIsa()),
+         std::thread::hardware_concurrency(),
+         options.min_time);
+
+  bool first = true;
+  bool all_ok = true;
+  for (const char *name : kBackends) {
+    if (!options.backend.empty() && options.backend != name)
+      continue;
+    for (Padding padding : {crypto::NOPKCS, crypto::PKCS5}) {
+      std::unique_ptr<Backend> backend = CreateBackend(name, padding);
+      // 8x steps, always ending on --max-size itself.
+      for (size_t size = options.min_size;;
+           size = std::min(size * 8, options.max_size)) {
+        for (size_t threads = 1; threads <= options.max_threads; threads *= 2) {
+          // Shared input plus one output (and ciphertext) per thread.
+          if (size * (1 + 2 * threads) > options.max_memory)
+            continue;
+          for (bool encrypt : {true, false}) {
+            for (bool warm : {true, false}) {
+              Case c = {backend.get(), encrypt, padding, warm, size, threads};
+              Result r = Run(c, options,
+                             std::span<const uint8_t>(input.data(), size));
+              all_ok = all_ok && r.ok;
+              double bytes = static_cast<double>(r.operations) * size;
+              printf("%s\n    {\"backend\": \"%s\", \"op\": \"%s\", "
+                     "\"padding\": \"%s\", \"key\": \"%s\", \"size\": %zu, "
+                     "\"threads\": %zu, \"ops\": %llu, \"seconds\": %.6f, "
+                     "\"mb_per_s\": %.3f, \"ops_per_s\": %.1f, "
+                     "\"p50_ns\": %.0f, \"p99_ns\": %.0f, \"max_ns\": %.0f, "
+                     "\"ok\": %s}",
+                     first ? "" : ",",
+                     backend->name(),
+                     encrypt ? "encrypt" : "decrypt",
+                     padding == crypto::PKCS5 ? "pkcs5" : "nopkcs",
+                     warm ? "warm" : "cold",
+                     size,
+                     threads,
+                     static_cast<unsigned long long>(r.operations),
+                     r.seconds,
+                     bytes / r.seconds / (1 << 20),
+                     r.operations / r.seconds,
+                     r.p50_ns,
+                     r.p99_ns,
+                     r.max_ns,
+                     r.ok ? "true" : "false");
+              first = false;
+              fflush(stdout);
+            }
+          }
+        }
+        if (size >= options.max_size)
+          break;
+      }
+    }
+  }
+  printf("\n  ]\n}\n");
+  return all_ok ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,377 @@
+﻿#ifndef BLOCK_CIPHER_H_
+#define BLOCK_CIPHER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include "chain_mode.h"
+#include "padding.h"
+#include "text_codec.h"
+
+namespace crypto {
+
+// DoEncrypt()/DoDecrypt() front end with the backend, chaining mode and
+// padding fixed at compile time. The padding, the IV handling and the
+// block size are resolved by the compiler, and the backend is called
+// directly rather than through a virtual interface.
+//
+// A Backend supplies:
+//   static constexpr size_t BLOCK_SIZE;
+//   typedef ... Key;                    // null when the key is unusable
+//   bool Initialize(ChainMode mode);
+//   Key GetKey(std::string_view key);
+//   template <ChainMode Mode>
+//   bool Encrypt(const Key &key, uint8_t *iv,
+//                const uint8_t *in, uint8_t *out, size_t size);
+//   template <ChainMode Mode>
+//   bool Decrypt(const Key &key, uint8_t *iv,
+//                const uint8_t *in, uint8_t *out, size_t size);
+// Encrypt() and Decrypt() take whole blocks in ECB and CBC and any size in
+// CTR. |iv| is null in ECB and is left at the next chaining value
+// otherwise. |in| and |out| may be the same buffer.
+//
+// Output is byte for byte that of Crypto3DesCNG and Crypto3DesSoft
+// constructed with the same mode and padding.
+template <typename Backend, ChainMode Mode, Padding PaddingMode>
+class BlockCipher {
+public:
+  static constexpr size_t BLOCK_SIZE = Backend::BLOCK_SIZE;
+  static constexpr size_t IV_SIZE = Mode == ECB ? 0 : BLOCK_SIZE;
+
+  // Arguments are passed on to the backend.
+  template <typename... Args>
+  explicit BlockCipher(Args &&...args) : backend_(std::forward<Args>(args)...) {}
+
+  BlockCipher(const BlockCipher &) = delete;
+  BlockCipher &operator=(const BlockCipher &) = delete;
+
+  // Must succeed before anything else is called; unlike the runtime
+  // classes, the per-call paths do not check it again.
+  bool Initialize() {
+    return backend_.Initialize(Mode);
+  }
+
+  // Ciphertext size for |plaintext_size| bytes of input.
+  static constexpr size_t RequiredOutputSize(size_t plaintext_size) {
+    if constexpr (Mode == CTR)
+      return plaintext_size;
+    else
+      return Pad::PaddedSize(plaintext_size);
+  }
+
+  bool DoEncrypt(std::string_view key,
+                 const std::string &plaintext,
+                 std::string *ciphertext) requires (Mode == ECB) {
+    return DoEncrypt(key, std::string(), plaintext, ciphertext);
+  }
+
+  bool DoDecrypt(std::string_view key,
+                 const std::string &ciphertext,
+                 std::string *plaintext) requires (Mode == ECB) {
+    return DoDecrypt(key, std::string(), ciphertext, plaintext);
+  }
+
+  bool DoEncrypt(std::string_view key,
+                 const std::string &iv,
+                 const std::string &plaintext,
+                 std::string *ciphertext) {
+    ciphertext->resize(RequiredOutputSize(plaintext.size()));
+    size_t size = 0;
+    bool result = DoEncrypt(key, Bytes(iv), Bytes(plaintext),
+                            MutableBytes(ciphertext), &size);
+    ciphertext->resize(size);
+    return result;
+  }
+
+  bool DoDecrypt(std::string_view key,
+                 const std::string &iv,
+                 const std::string &ciphertext,
+                 std::string *plaintext) {
+    plaintext->resize(ciphertext.size());
+    size_t size = 0;
+    bool result = DoDecrypt(key, Bytes(iv), Bytes(ciphertext),
+                            MutableBytes(plaintext), &size);
+    plaintext->resize(size);
+    return result;
+  }
+
+  // |ciphertext| must hold RequiredOutputSize(plaintext.size()) bytes and
+  // |plaintext| must hold ciphertext.size() bytes. Input and output may be
+  // the same buffer.
+  bool DoEncrypt(std::string_view key,
+                 std::span<const uint8_t> plaintext,
+                 std::span<uint8_t> ciphertext,
+                 size_t *written) requires (Mode == ECB) {
+    return DoEncrypt(key, std::span<const uint8_t>(), plaintext, ciphertext,
+                     written);
+  }
+
+  bool DoDecrypt(std::string_view key,
+                 std::span<const uint8_t> ciphertext,
+                 std::span<uint8_t> plaintext,
+                 size_t *written) requires (Mode == ECB) {
+    return DoDecrypt(key, std::span<const uint8_t>(), ciphertext, plaintext,
+                     written);
+  }
+
+  bool DoEncrypt(std::string_view key,
+                 std::span<const uint8_t> iv,
+                 std::span<const uint8_t> plaintext,
+                 std::span<uint8_t> ciphertext,
+                 size_t *written) {
+    *written = 0;
+    size_t size = plaintext.size();
+    size_t buffer_size = RequiredOutputSize(size);
+    if (iv.size() != IV_SIZE || ciphertext.size() < buffer_size)
+      return false;
+
+    typename Backend::Key handle = backend_.GetKey(key);
+    if (!handle)
+      return false;
+
+    uint8_t chain[BLOCK_SIZE];
+    uint8_t *state = nullptr;
+    if constexpr (Mode != ECB) {
+      memcpy(chain, iv.data(), BLOCK_SIZE);
+      state = chain;
+    }
+
+    if constexpr (Mode == CTR) {
+      if (size > 0 &&
+          !backend_.template Encrypt<Mode>(handle, state, plaintext.data(),
+                                           ciphertext.data(), size))
+        return false;
+    } else {
+      // Whole blocks are encrypted straight from the input; only the last,
+      // padded block is staged. The tail is copied out first in case the
+      // output overwrites it.
+      size_t whole = size - size % BLOCK_SIZE;
+      uint8_t last[BLOCK_SIZE];
+      if (buffer_size > whole) {
+        memcpy(last, plaintext.data() + whole, size - whole);
+        Pad::Apply(last, size - whole);
+      }
+      if (whole > 0 &&
+          !backend_.template Encrypt<Mode>(handle, state, plaintext.data(),
+                                           ciphertext.data(), whole))
+        return false;
+      if (buffer_size > whole &&
+          !backend_.template Encrypt<Mode>(handle, state, last,
+                                           ciphertext.data() + whole,
+                                           BLOCK_SIZE))
+        return false;
+    }
+    *written = buffer_size;
+    return true;
+  }
+
+  bool DoDecrypt(std::string_view key,
+                 std::span<const uint8_t> iv,
+                 std::span<const uint8_t> ciphertext,
+                 std::span<uint8_t> plaintext,
+                 size_t *written) {
+    *written = 0;
+    size_t cipher_size = ciphertext.size();
+    if (iv.size() != IV_SIZE || plaintext.size() < cipher_size)
+      return false;
+    if constexpr (Mode != CTR) {
+      if (cipher_size % BLOCK_SIZE)
+        return false;
+    }
+
+    typename Backend::Key handle = backend_.GetKey(key);
+    if (!handle)
+      return false;
+    if (cipher_size == 0)
+      return true;
+
+    uint8_t chain[BLOCK_SIZE];
+    uint8_t *state = nullptr;
+    if constexpr (Mode != ECB) {
+      memcpy(chain, iv.data(), BLOCK_SIZE);
+      state = chain;
+    }
+    if (!backend_.template Decrypt<Mode>(handle, state, ciphertext.data(),
+                                         plaintext.data(), cipher_size))
+      return false;
+
+    if constexpr (Mode == CTR)
+      *written = cipher_size;
+    else
+      *written = cipher_size - Pad::Length(plaintext.data(), cipher_size);
+    return true;
+  }
+
+  // DoEncrypt() and DoDecrypt() with Base64 ciphertext (text_codec.h).
+  // The message goes through in chunks of TEXT_CHUNK_BYTES, each encoded
+  // or decrypted while it is still in L1, so the binary ciphertext is
+  // never held as a whole: encryption stages one chunk on the stack and
+  // decryption decodes straight into |plaintext|, then decrypts in place.
+  bool EncryptToBase64(std::string_view key,
+                       const std::string &plaintext,
+                       std::string *text) requires (Mode == ECB) {
+    return EncryptToText<Base64Codec>(key, std::span<const uint8_t>(),
+                                      Bytes(plaintext), text);
+  }
+
+  bool DecryptFromBase64(std::string_view key,
+                         std::string_view text,
+                         std::string *plaintext) requires (Mode == ECB) {
+    return DecryptFromText<Base64Codec>(key, std::span<const uint8_t>(), text,
+                                        plaintext);
+  }
+
+  bool EncryptToBase64(std::string_view key,
+                       const std::string &iv,
+                       const std::string &plaintext,
+                       std::string *text) {
+    return EncryptToText<Base64Codec>(key, Bytes(iv), Bytes(plaintext), text);
+  }
+
+  bool DecryptFromBase64(std::string_view key,
+                         const std::string &iv,
+                         std::string_view text,
+                         std::string *plaintext) {
+    return DecryptFromText<Base64Codec>(key, Bytes(iv), text, plaintext);
+  }
+
+  // The same for any codec of text_codec.h, e.g. HexCodec.
+  template <typename Codec>
+  bool EncryptToText(std::string_view key,
+                     std::span<const uint8_t> iv,
+                     std::span<const uint8_t> plaintext,
+                     std::string *text) {
+    text->clear();
+    if (iv.size() != IV_SIZE)
+      return false;
+    typename Backend::Key handle = backend_.GetKey(key);
+    if (!handle)
+      return false;
+
+    uint8_t chain[BLOCK_SIZE];
+    uint8_t *state = nullptr;
+    if constexpr (Mode != ECB) {
+      memcpy(chain, iv.data(), BLOCK_SIZE);
+      state = chain;
+    }
+
+    size_t size = plaintext.size();
+    size_t cipher_size = RequiredOutputSize(size);
+    size_t whole = Mode == CTR ? size : size - size % BLOCK_SIZE;
+    uint8_t last[BLOCK_SIZE];
+    if (cipher_size > whole) {
+      memcpy(last, plaintext.data() + whole, size - whole);
+      Pad::Apply(last, size - whole);
+    }
+
+    text->resize(Codec::EncodedSize(cipher_size));
+    char *out = text->data();
+    alignas(64) uint8_t chunk[TextChunkBytes<Codec>()];
+    for (size_t done = 0; done < cipher_size;) {
+      size_t count = cipher_size - done;
+      if (count > sizeof(chunk))
+        count = sizeof(chunk);
+      // Chunks hold whole blocks, so the padded block is always the last
+      // one of the last chunk.
+      size_t bulk = whole - done < count ? whole - done : count;
+      if ((bulk > 0 &&
+           !backend_.template Encrypt<Mode>(handle, state,
+                                            plaintext.data() + done, chunk,
+                                            bulk)) ||
+          (bulk < count &&
+           !backend_.template Encrypt<Mode>(handle, state, last, chunk + bulk,
+                                            BLOCK_SIZE))) {
+        text->clear();
+        return false;
+      }
+      Codec::Encode(std::span<const uint8_t>(chunk, count), out);
+      out += Codec::EncodedSize(count);
+      done += count;
+    }
+    return true;
+  }
+
+  template <typename Codec>
+  bool DecryptFromText(std::string_view key,
+                       std::span<const uint8_t> iv,
+                       std::string_view text,
+                       std::string *plaintext) {
+    plaintext->clear();
+    size_t cipher_size = 0;
+    if (iv.size() != IV_SIZE || !Codec::DecodedSize(text, &cipher_size))
+      return false;
+    if constexpr (Mode != CTR) {
+      if (cipher_size % BLOCK_SIZE)
+        return false;
+    }
+
+    typename Backend::Key handle = backend_.GetKey(key);
+    if (!handle)
+      return false;
+    if (cipher_size == 0)
+      return true;
+
+    uint8_t chain[BLOCK_SIZE];
+    uint8_t *state = nullptr;
+    if constexpr (Mode != ECB) {
+      memcpy(chain, iv.data(), BLOCK_SIZE);
+      state = chain;
+    }
+
+    plaintext->resize(cipher_size);
+    uint8_t *out = reinterpret_cast<uint8_t *>(plaintext->data());
+    const size_t chunk_bytes = TextChunkBytes<Codec>();
+    for (size_t done = 0; done < cipher_size; done += chunk_bytes) {
+      size_t count = cipher_size - done;
+      if (count > chunk_bytes)
+        count = chunk_bytes;
+      // A piece decoding to less than a whole chunk had padding in the
+      // middle of the text.
+      std::string_view piece =
+          text.substr(done / Codec::BYTES * Codec::CHARS,
+                      Codec::EncodedSize(chunk_bytes));
+      size_t decoded = 0;
+      if (!Codec::Decode(piece, out + done, &decoded) || decoded != count ||
+          !backend_.template Decrypt<Mode>(handle, state, out + done,
+                                           out + done, count)) {
+        plaintext->clear();
+        return false;
+      }
+    }
+
+    if constexpr (Mode != CTR)
+      plaintext->resize(cipher_size - Pad::Length(out, cipher_size));
+    return true;
+  }
+
+  Backend &backend() { return backend_; }
+private:
+  typedef StaticPadding<PaddingMode, BLOCK_SIZE> Pad;
+
+  // Plaintext per chunk of EncryptToText()/DecryptFromText(): whole
+  // blocks and whole codec groups, about TEXT_CHUNK_BYTES.
+  template <typename Codec>
+  static constexpr size_t TextChunkBytes() {
+    constexpr size_t unit = BLOCK_SIZE * Codec::BYTES;
+    return TEXT_CHUNK_BYTES / unit * unit;
+  }
+
+  static std::span<const uint8_t> Bytes(const std::string &s) {
+    return std::span<const uint8_t>(
+        reinterpret_cast<const uint8_t *>(s.data()), s.size());
+  }
+
+  static std::span<uint8_t> MutableBytes(std::string *s) {
+    return std::span<uint8_t>(reinterpret_cast<uint8_t *>(s->data()),
+                              s->size());
+  }
+
+  Backend backend_;
+};
+} //crypto
+
+#endif  //BLOCK_CIPHER_H_
\ No newline at end of file
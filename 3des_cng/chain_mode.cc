@@ -0,0 +1,40 @@
+﻿#include "chain_mode.h"
+#include <string.h>
+
+namespace crypto {
+
+bool IsValidIv(ChainMode mode, size_t iv_size, size_t block_size) {
+  return mode == ECB || iv_size == block_size;
+}
+
+void IncrementCounter(uint8_t *counter, size_t block_size) {
+  for (size_t i = block_size; i > 0; i--) {
+    if (++counter[i - 1] != 0)
+      break;
+  }
+}
+
+void FillCounterBlocks(uint8_t *counter,
+                       size_t block_size,
+                       uint8_t *out,
+                       size_t blocks) {
+  for (size_t i = 0; i < blocks; i++) {
+    memcpy(out + i * block_size, counter, block_size);
+    IncrementCounter(counter, block_size);
+  }
+}
+
+void XorBytes(const uint8_t *a, const uint8_t *b, uint8_t *out, size_t size) {
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t x, y;
+    memcpy(&x, a + i, 8);
+    memcpy(&y, b + i, 8);
+    x ^= y;
+    memcpy(out + i, &x, 8);
+  }
+  for (; i < size; i++)
+    out[i] = a[i] ^ b[i];
+}
+
+} //crypto
\ No newline at end of file
@@ -0,0 +1,38 @@
+﻿#ifndef CHAIN_MODE_H_
+#define CHAIN_MODE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace crypto {
+// ECB needs no IV. CBC and CTR take one block of IV; CTR treats it as a
+// big-endian counter over the whole block, needs no padding and produces
+// output of the same size as its input.
+enum ChainMode {
+  ECB,
+  CBC,
+  CTR
+};
+
+// Blocks the keystream and CBC scratch buffers are processed in: enough
+// for a whole AVX-512 bitslice batch of 8-byte blocks.
+const size_t CHAIN_CHUNK_BYTES = 4096;
+
+// Whether |iv_size| bytes of IV are right for |mode|.
+bool IsValidIv(ChainMode mode, size_t iv_size, size_t block_size);
+
+// Adds one to the |block_size|-byte big-endian |counter|, wrapping around.
+void IncrementCounter(uint8_t *counter, size_t block_size);
+
+// Writes |blocks| consecutive counter values starting at |counter| into
+// |out| and leaves |counter| at the next unused value.
+void FillCounterBlocks(uint8_t *counter,
+                       size_t block_size,
+                       uint8_t *out,
+                       size_t blocks);
+
+// out[i] = a[i] ^ b[i]. |out| may alias |a| or |b|.
+void XorBytes(const uint8_t *a, const uint8_t *b, uint8_t *out, size_t size);
+} //crypto
+
+#endif  //CHAIN_MODE_H_
\ No newline at end of file
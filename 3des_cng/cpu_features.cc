@@ -0,0 +1,76 @@
+﻿#include "cpu_features.h"
+#include <stdint.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CRYPTO_ARCH_X86 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace crypto {
+
+namespace {
+
+#if defined(CRYPTO_ARCH_X86)
+void CpuId(uint32_t leaf, uint32_t subleaf, uint32_t regs[4]) {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuidex(info, static_cast<int>(leaf), static_cast<int>(subleaf));
+  for (int i = 0; i < 4; i++)
+    regs[i] = static_cast<uint32_t>(info[i]);
+#else
+  __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+uint64_t GetXcr0() {
+#if defined(_MSC_VER)
+  return _xgetbv(0);
+#else
+  uint32_t eax, edx;
+  __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+}
+#endif
+
+CpuFeatures DetectCpuFeatures() {
+  CpuFeatures features = {};
+#if defined(CRYPTO_ARCH_X86)
+  uint32_t regs[4];
+  CpuId(0, 0, regs);
+  uint32_t max_leaf = regs[0];
+
+  CpuId(1, 0, regs);
+  features.sse2 = (regs[3] >> 26) & 1;
+  features.ssse3 = (regs[2] >> 9) & 1;
+  features.aesni = (regs[2] >> 25) & 1;
+  bool osxsave = (regs[2] >> 27) & 1;
+  bool avx = (regs[2] >> 28) & 1;
+
+  uint64_t xcr0 = osxsave ? GetXcr0() : 0;
+  bool ymm_enabled = (xcr0 & 0x6) == 0x6;
+  bool zmm_enabled = (xcr0 & 0xe6) == 0xe6;
+
+  if (max_leaf >= 7) {
+    CpuId(7, 0, regs);
+    features.avx2 = avx && ymm_enabled && ((regs[1] >> 5) & 1);
+    features.avx512 = zmm_enabled &&
+                      ((regs[1] >> 16) & 1) &&  // AVX512F
+                      ((regs[1] >> 30) & 1);    // AVX512BW
+  }
+#endif
+  return features;
+}
+
+}  // namespace
+
+const CpuFeatures &GetCpuFeatures() {
+  static const CpuFeatures features = DetectCpuFeatures();
+  return features;
+}
+
+} //crypto
\ No newline at end of file
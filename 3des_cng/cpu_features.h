@@ -0,0 +1,20 @@
+﻿#ifndef CPU_FEATURES_H_
+#define CPU_FEATURES_H_
+
+namespace crypto {
+
+// x86 instruction set extensions usable by this process, i.e. reported by
+// CPUID and with their register state enabled by the OS. All false on other
+// architectures.
+struct CpuFeatures {
+  bool sse2;
+  bool ssse3;
+  bool avx2;
+  bool avx512;  // AVX512F + AVX512BW
+  bool aesni;
+};
+
+const CpuFeatures &GetCpuFeatures();
+} //crypto
+
+#endif  //CPU_FEATURES_H_
\ No newline at end of file
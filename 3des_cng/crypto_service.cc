@@ -0,0 +1,63 @@
+﻿#include "crypto_service.h"
+#include <vector>
+
+namespace crypto {
+namespace internal {
+
+namespace {
+
+// The slots of one thread. Its destructor runs at thread exit and tears
+// down every context the thread still has.
+class ThreadContexts {
+public:
+  ~ThreadContexts() {
+    for (ThreadContextSlot *slot : slots_) {
+      slot->DestroyContext();
+      slot->Release();
+    }
+  }
+
+  ThreadContextSlot *Find(uint64_t service_id) {
+    for (size_t i = 0; i < slots_.size(); i++) {
+      ThreadContextSlot *slot = slots_[i];
+      if (slot->service_id == service_id)
+        return slot;
+      // Only this thread's reference is left: the service is gone.
+      if (slot->refs.load(std::memory_order_acquire) == 1) {
+        slot->Release();
+        slots_[i] = slots_.back();
+        slots_.pop_back();
+        --i;
+      }
+    }
+    return nullptr;
+  }
+
+  void Add(ThreadContextSlot *slot) {
+    slots_.push_back(slot);
+  }
+
+private:
+  std::vector<ThreadContextSlot *> slots_;
+};
+
+thread_local ThreadContexts g_thread_contexts;
+
+std::atomic<uint64_t> g_next_service_id(1);
+
+}  // namespace
+
+ThreadContextSlot *FindThreadContextSlot(uint64_t service_id) {
+  return g_thread_contexts.Find(service_id);
+}
+
+void AddThreadContextSlot(ThreadContextSlot *slot) {
+  g_thread_contexts.Add(slot);
+}
+
+uint64_t NextServiceId() {
+  return g_next_service_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+}  // namespace internal
+} //crypto
\ No newline at end of file
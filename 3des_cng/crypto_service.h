@@ -0,0 +1,155 @@
+﻿#ifndef CRYPTO_SERVICE_H_
+#define CRYPTO_SERVICE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <utility>
+
+namespace crypto {
+
+namespace internal {
+
+// One thread's context for one CryptoService. Referenced by the thread
+// (torn down when it exits) and by the service (torn down when it is
+// destroyed); whichever comes first destroys the context, the last one
+// frees the slot.
+struct ThreadContextSlot {
+  uint64_t service_id;
+  std::atomic<void *> context;
+  void (*destroy)(void *);
+  std::atomic<int> refs;
+  // The owning service's list.
+  ThreadContextSlot *next;
+
+  void DestroyContext() {
+    void *c = context.exchange(nullptr, std::memory_order_acq_rel);
+    if (c)
+      destroy(c);
+  }
+
+  void Release() {
+    if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      delete this;
+  }
+};
+
+// This thread's slot for |service_id|, or null. Only touches thread-local
+// data; slots of destroyed services are dropped on the way.
+ThreadContextSlot *FindThreadContextSlot(uint64_t service_id);
+
+// Hands the thread's reference on |slot| to this thread's exit handler.
+void AddThreadContextSlot(ThreadContextSlot *slot);
+
+uint64_t NextServiceId();
+
+}  // namespace internal
+
+// Gives every calling thread its own |Cipher| (Crypto3DesCNG,
+// Crypto3DesSoft, CryptoWinRT, BlockCipher, ...) and with it its own key
+// cache and backend handles, so that a service shared by many threads
+// needs no lock around the calls. Contexts are created by |factory| on a
+// thread's first call, entirely on that thread; after that, finding one
+// is a scan of a short thread-local list. A context is destroyed when its
+// thread exits or when the service is destroyed, whichever comes first.
+//
+// The service must outlive calls made through it; it may be destroyed
+// while threads that used it keep running.
+template <typename Cipher>
+class CryptoService {
+public:
+  // Called on each new thread, possibly on several at once. Returns an
+  // initialized context, or null to fail the call (retried next time).
+  typedef std::function<std::unique_ptr<Cipher>()> Factory;
+
+  explicit CryptoService(Factory factory)
+      : id_(internal::NextServiceId()),
+        factory_(std::move(factory)),
+        slots_(nullptr) {}
+
+  CryptoService(const CryptoService &) = delete;
+  CryptoService &operator=(const CryptoService &) = delete;
+
+  ~CryptoService() {
+    internal::ThreadContextSlot *slot =
+        slots_.exchange(nullptr, std::memory_order_acquire);
+    while (slot) {
+      internal::ThreadContextSlot *next = slot->next;
+      slot->DestroyContext();
+      slot->Release();
+      slot = next;
+    }
+  }
+
+  // The calling thread's context, created on first use. Null if |factory|
+  // failed.
+  Cipher *GetForCurrentThread() {
+    internal::ThreadContextSlot *slot = internal::FindThreadContextSlot(id_);
+    if (slot) {
+      void *context = slot->context.load(std::memory_order_relaxed);
+      if (context)
+        return static_cast<Cipher *>(context);
+    }
+
+    std::unique_ptr<Cipher> cipher = factory_();
+    if (!cipher)
+      return nullptr;
+    if (!slot) {
+      slot = new internal::ThreadContextSlot;
+      slot->service_id = id_;
+      slot->context.store(nullptr, std::memory_order_relaxed);
+      slot->destroy = &Destroy;
+      slot->refs.store(2, std::memory_order_relaxed);
+      slot->next = slots_.load(std::memory_order_relaxed);
+      while (!slots_.compare_exchange_weak(slot->next, slot,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+      }
+      internal::AddThreadContextSlot(slot);
+    }
+    Cipher *context = cipher.release();
+    slot->context.store(context, std::memory_order_release);
+    return context;
+  }
+
+  // Forwarded to this thread's context.
+  template <typename... Args>
+  bool DoEncrypt(Args &&...args) {
+    Cipher *cipher = GetForCurrentThread();
+    return cipher && cipher->DoEncrypt(std::forward<Args>(args)...);
+  }
+
+  template <typename... Args>
+  bool DoDecrypt(Args &&...args) {
+    Cipher *cipher = GetForCurrentThread();
+    return cipher && cipher->DoDecrypt(std::forward<Args>(args)...);
+  }
+
+  // Threads currently holding a context. Approximate while threads start
+  // or exit.
+  size_t context_count() const {
+    size_t count = 0;
+    for (internal::ThreadContextSlot *slot =
+             slots_.load(std::memory_order_acquire);
+         slot; slot = slot->next) {
+      if (slot->context.load(std::memory_order_relaxed))
+        ++count;
+    }
+    return count;
+  }
+
+private:
+  static void Destroy(void *context) {
+    delete static_cast<Cipher *>(context);
+  }
+
+  const uint64_t id_;
+  const Factory factory_;
+  // Every slot ever created for this service; pushed without a lock.
+  std::atomic<internal::ThreadContextSlot *> slots_;
+};
+} //crypto
+
+#endif  //CRYPTO_SERVICE_H_
\ No newline at end of file
@@ -1,25 +1,26 @@
 ﻿#include "des.h"
 #include <string.h>
-#include <memory>
+#include "des_engine.h"
 
 #pragma comment(lib, "Bcrypt.lib")
 
 namespace crypto {
 
-namespace {
-const int DES_BLOCK_SIZE = 8;
-}
-
-Crypto3DesCNG::Crypto3DesCNG(Padding padding)
+Crypto3DesCNG::Crypto3DesCNG(Padding padding,
+                             ChainMode mode,
+                             size_t key_cache_capacity)
     : padding_(padding),
+      mode_(mode),
       block_size_(DES_BLOCK_SIZE),
-      alg_handle_(nullptr) {}
+      alg_handle_(nullptr),
+      key_cache_(key_cache_capacity) {}
 
 Crypto3DesCNG::~Crypto3DesCNG() {
   Destroy();
 }
 
 void Crypto3DesCNG::Destroy() {
+  key_cache_.Clear();
   if (alg_handle_) {
     BCryptCloseAlgorithmProvider(alg_handle_, 0);
     alg_handle_ = nullptr;
@@ -35,11 +36,20 @@ bool Crypto3DesCNG::Initialize() {
     return false;
   }
 
-  status = BCryptSetProperty(alg_handle_,
-                             BCRYPT_CHAINING_MODE,
-                             (PBYTE) BCRYPT_CHAIN_MODE_ECB,
-                             sizeof(BCRYPT_CHAIN_MODE_ECB),
-                             0);
+  // CTR runs BCrypt in ECB mode over the counter blocks.
+  if (mode_ == CBC) {
+    status = BCryptSetProperty(alg_handle_,
+                               BCRYPT_CHAINING_MODE,
+                               (PBYTE) BCRYPT_CHAIN_MODE_CBC,
+                               sizeof(BCRYPT_CHAIN_MODE_CBC),
+                               0);
+  } else {
+    status = BCryptSetProperty(alg_handle_,
+                               BCRYPT_CHAINING_MODE,
+                               (PBYTE) BCRYPT_CHAIN_MODE_ECB,
+                               sizeof(BCRYPT_CHAIN_MODE_ECB),
+                               0);
+  }
   if (!BCRYPT_SUCCESS(status)) {
     Destroy();
     return false;
@@ -59,154 +69,416 @@ bool Crypto3DesCNG::Initialize() {
   return true;
 }
 
-BCRYPT_KEY_HANDLE Crypto3DesCNG::CreateKeyHandle(const std::string &key) {
-  size_t key_count = key.size() / DES_BLOCK_SIZE;
-  if (key.size() % DES_BLOCK_SIZE)
-    key_count += 1;
-  if (key_count < 3)
-    key_count = 3;
-  size_t key_size = key_count * DES_BLOCK_SIZE;
+KeyCache<void>::Entry Crypto3DesCNG::GetKeyHandle(const std::string &key) {
+  // Keys are zero-extended to at least three DES keys; anything longer
+  // than 24 bytes is rejected by BCryptGenerateSymmetricKey anyway.
+  uint8_t deskey[DES3_KEY_SIZE];
+  if (!PadTripleDesKey(key, deskey))
+    return nullptr;
+  KeyCache<void>::Entry key_handle = key_cache_.Get(
+      std::string_view(reinterpret_cast<const char *>(deskey), DES3_KEY_SIZE),
+      [this](std::string_view padded) { return CreateKeyHandle(padded); });
+  SecureZero(deskey, sizeof(deskey));
+  return key_handle;
+}
 
-  auto deskey = std::make_unique<uint8_t[]>(key_size);
-  memset(deskey.get(), 0, key_count);
-  memcpy_s(deskey.get(), key_size, key.data(), key.size());
+KeyCache<void>::Entry Crypto3DesCNG::CreateKeyHandle(std::string_view deskey) {
   BCRYPT_KEY_HANDLE key_handle = nullptr;
   NTSTATUS status = BCryptGenerateSymmetricKey(alg_handle_,
                                                &key_handle,
                                                NULL,
                                                0,
-                                               (PBYTE) (deskey.get()),
-                                               key_size,
+                                               (PBYTE) (deskey.data()),
+                                               (ULONG) deskey.size(),
                                                0);
   if (!BCRYPT_SUCCESS(status)) {
-    return NULL;
+    return nullptr;
   }
-  return key_handle;
+  return KeyCache<void>::Entry(key_handle, [](BCRYPT_KEY_HANDLE handle) {
+    BCryptDestroyKey(handle);
+  });
+}
+
+bool Crypto3DesCNG::CtrCrypt(BCRYPT_KEY_HANDLE key_handle,
+                             std::span<const uint8_t> iv,
+                             const uint8_t *in,
+                             uint8_t *out,
+                             size_t size) {
+  uint8_t counter[DES_BLOCK_SIZE];
+  uint8_t keystream[CHAIN_CHUNK_BYTES];
+  memcpy(counter, iv.data(), DES_BLOCK_SIZE);
+  bool result = true;
+  while (size > 0) {
+    size_t count = size < CHAIN_CHUNK_BYTES ? size : CHAIN_CHUNK_BYTES;
+    size_t blocks = (count + DES_BLOCK_SIZE - 1) / DES_BLOCK_SIZE;
+    FillCounterBlocks(counter, DES_BLOCK_SIZE, keystream, blocks);
+
+    DWORD encrypted;
+    NTSTATUS status = BCryptEncrypt(key_handle,
+                                    (PUCHAR) keystream,
+                                    (ULONG) (blocks * DES_BLOCK_SIZE),
+                                    nullptr,
+                                    nullptr,
+                                    0,
+                                    (PUCHAR) keystream,
+                                    (ULONG) (blocks * DES_BLOCK_SIZE),
+                                    &encrypted,
+                                    0);
+    if (!BCRYPT_SUCCESS(status)) {
+      result = false;
+      break;
+    }
+    XorBytes(in, keystream, out, count);
+    in += count;
+    out += count;
+    size -= count;
+  }
+  SecureZero(keystream, sizeof(keystream));
+  return result;
+}
+
+size_t Crypto3DesCNG::RequiredOutputSize(size_t plaintext_size) const {
+  if (mode_ == CTR)
+    return plaintext_size;
+  return PaddedSize(padding_, plaintext_size, block_size_);
+}
+
+bool Crypto3DesCNG::DoEncrypt(const std::string &key,
+                              const std::string &plaintext,
+                              std::string *ciphertext) {
+  return DoEncrypt(key, std::string(), plaintext, ciphertext);
+}
+
+bool Crypto3DesCNG::DoDecrypt(const std::string &key,
+                              const std::string &ciphertext,
+                              std::string *plaintext) {
+  return DoDecrypt(key, std::string(), ciphertext, plaintext);
 }
 
 bool Crypto3DesCNG::DoEncrypt(const std::string &key,
+                              const std::string &iv,
                               const std::string &plaintext,
                               std::string *ciphertext) {
-  if (alg_handle_ == NULL)
+  ciphertext->resize(RequiredOutputSize(plaintext.size()));
+  size_t size = 0;
+  bool result = DoEncrypt(
+      key,
+      std::span<const uint8_t>(reinterpret_cast<const uint8_t *>(iv.data()),
+                               iv.size()),
+      std::span<const uint8_t>(
+          reinterpret_cast<const uint8_t *>(plaintext.data()), plaintext.size()),
+      std::span<uint8_t>(reinterpret_cast<uint8_t *>(ciphertext->data()),
+                         ciphertext->size()),
+      &size);
+  ciphertext->resize(size);
+  return result;
+}
+
+bool Crypto3DesCNG::DoDecrypt(const std::string &key,
+                              const std::string &iv,
+                              const std::string &ciphertext,
+                              std::string *plaintext) {
+  plaintext->resize(ciphertext.size());
+  size_t size = 0;
+  bool result = DoDecrypt(
+      key,
+      std::span<const uint8_t>(reinterpret_cast<const uint8_t *>(iv.data()),
+                               iv.size()),
+      std::span<const uint8_t>(
+          reinterpret_cast<const uint8_t *>(ciphertext.data()), ciphertext.size()),
+      std::span<uint8_t>(reinterpret_cast<uint8_t *>(plaintext->data()),
+                         plaintext->size()),
+      &size);
+  plaintext->resize(size);
+  return result;
+}
+
+bool Crypto3DesCNG::DoEncrypt(const std::string &key,
+                              std::span<const uint8_t> plaintext,
+                              std::span<uint8_t> ciphertext,
+                              size_t *written) {
+  return DoEncrypt(key, std::span<const uint8_t>(), plaintext, ciphertext,
+                   written);
+}
+
+bool Crypto3DesCNG::DoDecrypt(const std::string &key,
+                              std::span<const uint8_t> ciphertext,
+                              std::span<uint8_t> plaintext,
+                              size_t *written) {
+  return DoDecrypt(key, std::span<const uint8_t>(), ciphertext, plaintext,
+                   written);
+}
+
+bool Crypto3DesCNG::DoEncrypt(const std::string &key,
+                              std::span<const uint8_t> iv,
+                              std::span<const uint8_t> plaintext,
+                              std::span<uint8_t> ciphertext,
+                              size_t *written) {
+  *written = 0;
+  if (alg_handle_ == NULL || !IsValidIv(mode_, iv.size(), block_size_))
     return false;
-  BCRYPT_KEY_HANDLE key_handle = CreateKeyHandle(key);
-  if (key_handle == NULL)
+
+  size_t buffer_size = RequiredOutputSize(plaintext.size());
+  if (ciphertext.size() < buffer_size)
     return false;
 
-  int pad = plaintext.size() % block_size_;
-  size_t buffer_size = plaintext.size();
-  if (padding_ == PKCS5 || pad > 0) {
-    buffer_size += (block_size_ - pad);
-  }
-  std::unique_ptr<uint8_t[]> source(new uint8_t[buffer_size]);
-  memset(source.get(), 0, buffer_size);
-  memcpy_s(source.get(), buffer_size, plaintext.data(), plaintext.size());
+  KeyCache<void>::Entry key_entry = GetKeyHandle(key);
+  if (!key_entry)
+    return false;
+  BCRYPT_KEY_HANDLE key_handle = key_entry.get();
 
-  if (padding_ == PKCS5) {
-    for (int i = plaintext.size(); i < buffer_size; i++) {
-      source[i] = pad ? (block_size_ - pad) : 0x08;
-    }
+  uint8_t *output = ciphertext.data();
+  if (mode_ == CTR) {
+    if (!CtrCrypt(key_handle, iv, plaintext.data(), output, plaintext.size()))
+      return false;
+    *written = buffer_size;
+    return true;
   }
 
+  // The padded plaintext is built in the output buffer and encrypted in
+  // place; ECB and CBC output is the same size as the input, so no size
+  // query. BCrypt updates the IV it is given, hence the copy.
+  if (output != plaintext.data() && !plaintext.empty())
+    memmove(output, plaintext.data(), plaintext.size());
+  ApplyPadding(padding_, output, plaintext.size(), buffer_size);
+
+  uint8_t chain[DES_BLOCK_SIZE];
+  if (mode_ == CBC)
+    memcpy(chain, iv.data(), DES_BLOCK_SIZE);
+
   DWORD size;
   NTSTATUS status = BCryptEncrypt(key_handle,
-                                  (PUCHAR) source.get(),
-                                  buffer_size,
+                                  (PUCHAR) output,
+                                  (ULONG) buffer_size,
                                   nullptr,
-                                  nullptr,
-                                  block_size_,
-                                  nullptr,
-                                  0,
+                                  mode_ == CBC ? (PUCHAR) chain : nullptr,
+                                  mode_ == CBC ? block_size_ : 0,
+                                  (PUCHAR) output,
+                                  (ULONG) buffer_size,
                                   &size,
                                   0);
-  if (!BCRYPT_SUCCESS(status)) {
-    BCryptDestroyKey(key_handle);
-    return false;
-  }
-  auto output = std::make_unique<UCHAR[]>(size);
-  status = BCryptEncrypt(key_handle,
-                         (PUCHAR) source.get(),
-                         buffer_size,
-                         nullptr,
-                         nullptr,
-                         block_size_,
-                         &output[0],
-                         size,
-                         &size,
-                         0);
-  BCryptDestroyKey(key_handle);
   if (!BCRYPT_SUCCESS(status)) {
     return false;
   }
-  ciphertext->clear();
-  ciphertext->append((char *) output.get(), size);
+  *written = size;
   return true;
 }
 
 bool Crypto3DesCNG::DoDecrypt(const std::string &key,
-                              const std::string &ciphertext,
-                              std::string *plaintext) {
+                              std::span<const uint8_t> iv,
+                              std::span<const uint8_t> ciphertext,
+                              std::span<uint8_t> plaintext,
+                              size_t *written) {
+  *written = 0;
+  if (alg_handle_ == NULL || !IsValidIv(mode_, iv.size(), block_size_))
+    return false;
 
-  if (alg_handle_ == NULL)
+  size_t cipher_size = ciphertext.size();
+  if (plaintext.size() < cipher_size)
     return false;
 
-  BCRYPT_KEY_HANDLE key_handle = CreateKeyHandle(key);
-  if (key_handle == NULL)
+  KeyCache<void>::Entry key_entry = GetKeyHandle(key);
+  if (!key_entry)
     return false;
+  BCRYPT_KEY_HANDLE key_handle = key_entry.get();
 
-  size_t cipher_size = ciphertext.size();
+  if (cipher_size == 0)
+    return true;
+
+  if (mode_ == CTR) {
+    if (!CtrCrypt(key_handle, iv, ciphertext.data(), plaintext.data(),
+                  cipher_size))
+      return false;
+    *written = cipher_size;
+    return true;
+  }
 
-  std::unique_ptr<uint8_t[]> source(new uint8_t[cipher_size]);
-  memset(source.get(), 0, cipher_size);
-  memcpy_s(source.get(), cipher_size, ciphertext.data(), cipher_size);
+  uint8_t chain[DES_BLOCK_SIZE];
+  if (mode_ == CBC)
+    memcpy(chain, iv.data(), DES_BLOCK_SIZE);
 
   DWORD size;
   NTSTATUS status = BCryptDecrypt(key_handle,
-                                  (PUCHAR) source.get(),
-                                  cipher_size,
+                                  (PUCHAR) ciphertext.data(),
+                                  (ULONG) cipher_size,
                                   nullptr,
-                                  nullptr,
-                                  block_size_,
-                                  nullptr,
-                                  0,
+                                  mode_ == CBC ? (PUCHAR) chain : nullptr,
+                                  mode_ == CBC ? block_size_ : 0,
+                                  (PUCHAR) plaintext.data(),
+                                  (ULONG) cipher_size,
                                   &size,
                                   0);
   if (!BCRYPT_SUCCESS(status)) {
-    BCryptDestroyKey(key_handle);
     return false;
   }
-  auto output = std::make_unique<UCHAR[]>(size);
-  status = BCryptDecrypt(key_handle,
-                         (PUCHAR) source.get(),
-                         cipher_size,
-                         nullptr,
-                         nullptr,
-                         block_size_,
-                         &output[0],
-                         size,
-                         &size,
-                         0);
-  BCryptDestroyKey(key_handle);
 
+  size_t unpad = PaddingLength(padding_, plaintext.data(), size);
+  *written = size - unpad;
+  return true;
+}
+
+bool Crypto3DesCNG::DoEncryptInPlace(const std::string &key,
+                                     std::span<uint8_t> buffer,
+                                     size_t size,
+                                     size_t *written) {
+  if (size > buffer.size()) {
+    *written = 0;
+    return false;
+  }
+  return DoEncrypt(key, buffer.first(size), buffer, written);
+}
+
+bool Crypto3DesCNG::DoDecryptInPlace(const std::string &key,
+                                     std::span<uint8_t> buffer,
+                                     size_t *written) {
+  return DoDecrypt(key, buffer, buffer, written);
+}
+
+Cng3DesBackend::Cng3DesBackend(size_t key_cache_capacity)
+    : alg_handle_(nullptr),
+      key_cache_(key_cache_capacity) {}
+
+Cng3DesBackend::~Cng3DesBackend() {
+  key_cache_.Clear();
+  if (alg_handle_)
+    BCryptCloseAlgorithmProvider(alg_handle_, 0);
+}
+
+bool Cng3DesBackend::Initialize(ChainMode mode) {
+  if (alg_handle_)
+    return true;
+  BCRYPT_ALG_HANDLE alg_handle = nullptr;
+  NTSTATUS status = BCryptOpenAlgorithmProvider(&alg_handle,
+                                                BCRYPT_3DES_ALGORITHM,
+                                                nullptr,
+                                                0);
+  if (!BCRYPT_SUCCESS(status))
+    return false;
+
+  const wchar_t *chain_mode =
+      mode == CBC ? BCRYPT_CHAIN_MODE_CBC : BCRYPT_CHAIN_MODE_ECB;
+  status = BCryptSetProperty(alg_handle,
+                             BCRYPT_CHAINING_MODE,
+                             (PBYTE) chain_mode,
+                             (ULONG) ((wcslen(chain_mode) + 1) * sizeof(wchar_t)),
+                             0);
   if (!BCRYPT_SUCCESS(status)) {
+    BCryptCloseAlgorithmProvider(alg_handle, 0);
     return false;
   }
-  plaintext->clear();
+  alg_handle_ = alg_handle;
+  return true;
+}
+
+Cng3DesBackend::Key Cng3DesBackend::GetKey(std::string_view key) {
+  uint8_t deskey[DES3_KEY_SIZE];
+  if (!PadTripleDesKey(key, deskey))
+    return nullptr;
+  Key key_handle = key_cache_.Get(
+      std::string_view(reinterpret_cast<const char *>(deskey), DES3_KEY_SIZE),
+      [this](std::string_view padded) -> Key {
+        BCRYPT_KEY_HANDLE handle = nullptr;
+        NTSTATUS status = BCryptGenerateSymmetricKey(alg_handle_,
+                                                     &handle,
+                                                     NULL,
+                                                     0,
+                                                     (PBYTE) (padded.data()),
+                                                     (ULONG) padded.size(),
+                                                     0);
+        if (!BCRYPT_SUCCESS(status))
+          return nullptr;
+        return Key(handle, [](BCRYPT_KEY_HANDLE h) { BCryptDestroyKey(h); });
+      });
+  SecureZero(deskey, sizeof(deskey));
+  return key_handle;
+}
 
-  uint8_t unpad = 0;
-  if (padding_ == PKCS5) {
-    unpad = output[size - 1];
-    if (unpad > cipher_size)
-      unpad = 0;
+template <ChainMode Mode>
+bool Cng3DesBackend::Encrypt(const Key &key,
+                             uint8_t *iv,
+                             const uint8_t *in,
+                             uint8_t *out,
+                             size_t size) {
+  DWORD done;
+  if constexpr (Mode != CTR) {
+    // BCrypt leaves the last ciphertext block in |iv| for CBC.
+    NTSTATUS status = BCryptEncrypt(key.get(),
+                                    (PUCHAR) in,
+                                    (ULONG) size,
+                                    nullptr,
+                                    (PUCHAR) iv,
+                                    Mode == CBC ? BLOCK_SIZE : 0,
+                                    (PUCHAR) out,
+                                    (ULONG) size,
+                                    &done,
+                                    0);
+    return BCRYPT_SUCCESS(status);
   } else {
-    for (int i = size - 1; i > 0; i--) {
-      if (output[i] > 0)
+    uint8_t keystream[CHAIN_CHUNK_BYTES];
+    bool result = true;
+    while (size > 0) {
+      size_t count = size < CHAIN_CHUNK_BYTES ? size : CHAIN_CHUNK_BYTES;
+      size_t blocks = (count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+      FillCounterBlocks(iv, BLOCK_SIZE, keystream, blocks);
+      NTSTATUS status = BCryptEncrypt(key.get(),
+                                      (PUCHAR) keystream,
+                                      (ULONG) (blocks * BLOCK_SIZE),
+                                      nullptr,
+                                      nullptr,
+                                      0,
+                                      (PUCHAR) keystream,
+                                      (ULONG) (blocks * BLOCK_SIZE),
+                                      &done,
+                                      0);
+      if (!BCRYPT_SUCCESS(status)) {
+        result = false;
         break;
-      ++unpad;
+      }
+      XorBytes(in, keystream, out, count);
+      in += count;
+      out += count;
+      size -= count;
     }
+    SecureZero(keystream, sizeof(keystream));
+    return result;
   }
-  plaintext->append(output.get(), output.get() + size - unpad);
-  return true;
 }
 
+template <ChainMode Mode>
+bool Cng3DesBackend::Decrypt(const Key &key,
+                             uint8_t *iv,
+                             const uint8_t *in,
+                             uint8_t *out,
+                             size_t size) {
+  if constexpr (Mode == CTR) {
+    return Encrypt<CTR>(key, iv, in, out, size);
+  } else {
+    DWORD done;
+    NTSTATUS status = BCryptDecrypt(key.get(),
+                                    (PUCHAR) in,
+                                    (ULONG) size,
+                                    nullptr,
+                                    (PUCHAR) iv,
+                                    Mode == CBC ? BLOCK_SIZE : 0,
+                                    (PUCHAR) out,
+                                    (ULONG) size,
+                                    &done,
+                                    0);
+    return BCRYPT_SUCCESS(status);
+  }
+}
+
+template bool Cng3DesBackend::Encrypt<ECB>(const Key &, uint8_t *,
+                                           const uint8_t *, uint8_t *, size_t);
+template bool Cng3DesBackend::Encrypt<CBC>(const Key &, uint8_t *,
+                                           const uint8_t *, uint8_t *, size_t);
+template bool Cng3DesBackend::Encrypt<CTR>(const Key &, uint8_t *,
+                                           const uint8_t *, uint8_t *, size_t);
+template bool Cng3DesBackend::Decrypt<ECB>(const Key &, uint8_t *,
+                                           const uint8_t *, uint8_t *, size_t);
+template bool Cng3DesBackend::Decrypt<CBC>(const Key &, uint8_t *,
+                                           const uint8_t *, uint8_t *, size_t);
+template bool Cng3DesBackend::Decrypt<CTR>(const Key &, uint8_t *,
+                                           const uint8_t *, uint8_t *, size_t);
+
 } //cryto
\ No newline at end of file
@@ -1,19 +1,24 @@
 ﻿#ifndef DES_H_
 #define DES_H_
 
+#include <span>
 #include <string>
+#include <string_view>
 #include <windows.h>
 #include <bcrypt.h>
+#include "chain_mode.h"
+#include "key_cache.h"
+#include "padding.h"
 
 namespace crypto {
-enum Padding {
-  NOPKCS,
-  PKCS5
-};
 
 class Crypto3DesCNG {
 public:
-  explicit Crypto3DesCNG(Padding padding);
+  // CBC uses BCrypt's own chaining; CTR is built on ECB by encrypting
+  // counter blocks.
+  explicit Crypto3DesCNG(Padding padding,
+                         ChainMode mode = ECB,
+                         size_t key_cache_capacity = DEFAULT_KEY_CACHE_CAPACITY);
 
   virtual ~Crypto3DesCNG();
 
@@ -26,14 +31,124 @@ public:
   bool DoDecrypt(const std::string &key,
                  const std::string &ciphertext,
                  std::string *plaintext);
+
+  // CBC and CTR take an 8-byte |iv|; the overloads without one only work
+  // in ECB mode.
+  bool DoEncrypt(const std::string &key,
+                 const std::string &iv,
+                 const std::string &plaintext,
+                 std::string *ciphertext);
+
+  bool DoDecrypt(const std::string &key,
+                 const std::string &iv,
+                 const std::string &ciphertext,
+                 std::string *plaintext);
+
+  // Ciphertext size for |plaintext_size| bytes of input.
+  size_t RequiredOutputSize(size_t plaintext_size) const;
+
+  // Allocation-free variants that let BCrypt work in the caller's buffer.
+  // |ciphertext| must hold RequiredOutputSize(plaintext.size()) bytes and
+  // |plaintext| must hold ciphertext.size() bytes. Input and output may be
+  // the same buffer.
+  bool DoEncrypt(const std::string &key,
+                 std::span<const uint8_t> plaintext,
+                 std::span<uint8_t> ciphertext,
+                 size_t *written);
+
+  bool DoDecrypt(const std::string &key,
+                 std::span<const uint8_t> ciphertext,
+                 std::span<uint8_t> plaintext,
+                 size_t *written);
+
+  bool DoEncrypt(const std::string &key,
+                 std::span<const uint8_t> iv,
+                 std::span<const uint8_t> plaintext,
+                 std::span<uint8_t> ciphertext,
+                 size_t *written);
+
+  bool DoDecrypt(const std::string &key,
+                 std::span<const uint8_t> iv,
+                 std::span<const uint8_t> ciphertext,
+                 std::span<uint8_t> plaintext,
+                 size_t *written);
+
+  // Encrypts the first |size| bytes of |buffer| in place; |buffer| must have
+  // room for the padding.
+  bool DoEncryptInPlace(const std::string &key,
+                        std::span<uint8_t> buffer,
+                        size_t size,
+                        size_t *written);
+
+  bool DoDecryptInPlace(const std::string &key,
+                        std::span<uint8_t> buffer,
+                        size_t *written);
+
+  // Key handles are cached by padded key; the entry owns the
+  // BCRYPT_KEY_HANDLE and destroys it once evicted and no longer in use.
+  KeyCache<void> &key_cache() { return key_cache_; }
 private:
   void Destroy();
 
-  BCRYPT_KEY_HANDLE CreateKeyHandle(const std::string &key);
+  KeyCache<void>::Entry GetKeyHandle(const std::string &key);
+
+  KeyCache<void>::Entry CreateKeyHandle(std::string_view deskey);
+
+  // XORs |size| bytes with the ECB encryption of counter blocks starting at
+  // |iv|, a chunk at a time.
+  bool CtrCrypt(BCRYPT_KEY_HANDLE key_handle,
+                std::span<const uint8_t> iv,
+                const uint8_t *in,
+                uint8_t *out,
+                size_t size);
 
   Padding padding_;
+  ChainMode mode_;
   uint32_t block_size_;
   BCRYPT_ALG_HANDLE alg_handle_;
+  KeyCache<void> key_cache_;
+};
+
+// Backend policy for BlockCipher (block_cipher.h) on BCrypt. Keys are
+// padded and cached as in Crypto3DesCNG.
+class Cng3DesBackend {
+public:
+  typedef KeyCache<void>::Entry Key;
+
+  static constexpr size_t BLOCK_SIZE = 8;
+
+  explicit Cng3DesBackend(
+      size_t key_cache_capacity = DEFAULT_KEY_CACHE_CAPACITY);
+
+  ~Cng3DesBackend();
+
+  // Opens the provider with BCrypt's CBC chaining for CBC and ECB for the
+  // other two modes.
+  bool Initialize(ChainMode mode);
+
+  Key GetKey(std::string_view key);
+
+  template <ChainMode Mode>
+  bool Encrypt(const Key &key,
+               uint8_t *iv,
+               const uint8_t *in,
+               uint8_t *out,
+               size_t size);
+
+  template <ChainMode Mode>
+  bool Decrypt(const Key &key,
+               uint8_t *iv,
+               const uint8_t *in,
+               uint8_t *out,
+               size_t size);
+
+  KeyCache<void> &key_cache() { return key_cache_; }
+private:
+  Cng3DesBackend(const Cng3DesBackend &) = delete;
+  Cng3DesBackend &operator=(const Cng3DesBackend &) = delete;
+
+  BCRYPT_ALG_HANDLE alg_handle_;
+  KeyCache<void> key_cache_;
 };
 } //crypto
 
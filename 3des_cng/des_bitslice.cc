@@ -0,0 +1,175 @@
+﻿#include "des_bitslice.h"
+#include <memory>
+#include <utility>
+#include "cpu_features.h"
+#include "des_tables.h"
+#include "key_cache.h"
+
+namespace crypto {
+namespace {
+
+struct ScalarVector {
+  static constexpr int kWords = 1;
+  uint64_t v;
+
+  static ScalarVector Zero() { return {0}; }
+  static ScalarVector Ones() { return {~uint64_t(0)}; }
+  static ScalarVector Broadcast(uint64_t value) { return {value}; }
+  static ScalarVector And(ScalarVector a, ScalarVector b) { return {a.v & b.v}; }
+  static ScalarVector Or(ScalarVector a, ScalarVector b) { return {a.v | b.v}; }
+  static ScalarVector Xor(ScalarVector a, ScalarVector b) { return {a.v ^ b.v}; }
+  template <int count>
+  static ScalarVector ShiftLeft(ScalarVector a) {
+    return {a.v << count};
+  }
+  template <int count>
+  static ScalarVector ShiftRight(ScalarVector a) {
+    return {a.v >> count};
+  }
+  static ScalarVector Load(const uint64_t *p) { return {*p}; }
+  static void Store(uint64_t *p, ScalarVector a) { *p = a.v; }
+};
+
+}  // namespace
+} //crypto
+
+#include "des_bitslice_kernel.h"
+
+namespace crypto {
+
+#if !defined(_M_X64) && !defined(_M_IX86) && !defined(__x86_64__) && !defined(__i386__)
+void BitslicedCryptSse2(const uint8_t (*)[8], const uint8_t *, uint8_t *, size_t) {}
+void BitslicedCryptAvx2(const uint8_t (*)[8], const uint8_t *, uint8_t *, size_t) {}
+void BitslicedCryptAvx512(const uint8_t (*)[8], const uint8_t *, uint8_t *, size_t) {}
+void BitslicedCryptMultiKeySse2(const uint64_t *const *, const uint8_t *,
+                                uint8_t *, size_t, uint64_t *) {}
+void BitslicedCryptMultiKeyAvx2(const uint64_t *const *, const uint8_t *,
+                                uint8_t *, size_t, uint64_t *) {}
+void BitslicedCryptMultiKeyAvx512(const uint64_t *const *, const uint8_t *,
+                                  uint8_t *, size_t, uint64_t *) {}
+#endif
+
+BitsliceIsa BestBitsliceIsa() {
+  static const BitsliceIsa isa = [] {
+    const CpuFeatures &features = GetCpuFeatures();
+    if (features.avx512)
+      return BitsliceIsa::AVX512;
+    if (features.avx2)
+      return BitsliceIsa::AVX2;
+    if (features.sse2)
+      return BitsliceIsa::SSE2;
+    return BitsliceIsa::SCALAR;
+  }();
+  return isa;
+}
+
+bool IsBitsliceIsaSupported(BitsliceIsa isa) {
+  const CpuFeatures &features = GetCpuFeatures();
+  switch (isa) {
+    case BitsliceIsa::SCALAR:
+      return true;
+    case BitsliceIsa::SSE2:
+      return features.sse2;
+    case BitsliceIsa::AVX2:
+      return features.avx2;
+    case BitsliceIsa::AVX512:
+      return features.avx512;
+  }
+  return false;
+}
+
+const char *BitsliceIsaName(BitsliceIsa isa) {
+  switch (isa) {
+    case BitsliceIsa::SCALAR:
+      return "scalar";
+    case BitsliceIsa::SSE2:
+      return "sse2";
+    case BitsliceIsa::AVX2:
+      return "avx2";
+    case BitsliceIsa::AVX512:
+      return "avx512";
+  }
+  return "";
+}
+
+size_t BitsliceBatchBlocks(BitsliceIsa isa) {
+  switch (isa) {
+    case BitsliceIsa::SCALAR:
+      return 64;
+    case BitsliceIsa::SSE2:
+      return 128;
+    case BitsliceIsa::AVX2:
+      return 256;
+    case BitsliceIsa::AVX512:
+      return 512;
+  }
+  return 64;
+}
+
+void BitslicedCryptBlocks(BitsliceIsa isa,
+                          const uint8_t (*round_keys)[8],
+                          const uint8_t *in,
+                          uint8_t *out,
+                          size_t batches) {
+  switch (isa) {
+    case BitsliceIsa::SCALAR:
+      CryptBatches<ScalarVector>(round_keys, in, out, batches);
+      break;
+    case BitsliceIsa::SSE2:
+      BitslicedCryptSse2(round_keys, in, out, batches);
+      break;
+    case BitsliceIsa::AVX2:
+      BitslicedCryptAvx2(round_keys, in, out, batches);
+      break;
+    case BitsliceIsa::AVX512:
+      BitslicedCryptAvx512(round_keys, in, out, batches);
+      break;
+  }
+}
+
+namespace {
+
+// Room for the transposed keys of one batch, 64-byte aligned: 36 vectors
+// per round bit, 144 KB for AVX-512, too much for the stack of an
+// arbitrary thread. Kept per thread and grown to the widest ISA it has
+// used, so a batch does not go through the allocator; wiped after each
+// call, since it holds the callers' round keys.
+uint64_t *MultiKeyScratch(size_t words) {
+  thread_local std::unique_ptr<uint64_t[]> storage;
+  thread_local size_t capacity = 0;
+  if (capacity < words) {
+    storage.reset(new uint64_t[words + 8]);
+    capacity = words;
+  }
+  return reinterpret_cast<uint64_t *>(
+      (reinterpret_cast<uintptr_t>(storage.get()) + 63) & ~uintptr_t(63));
+}
+
+}  // namespace
+
+void BitslicedCryptBlocksMultiKey(BitsliceIsa isa,
+                                  const uint64_t *const *block_keys,
+                                  const uint8_t *in,
+                                  uint8_t *out,
+                                  size_t batches) {
+  size_t words = BITSLICE_KEY_WORDS * 64 * (BitsliceBatchBlocks(isa) / 64);
+  uint64_t *scratch = MultiKeyScratch(words);
+
+  switch (isa) {
+    case BitsliceIsa::SCALAR:
+      CryptBatchesMultiKey<ScalarVector>(block_keys, in, out, batches, scratch);
+      break;
+    case BitsliceIsa::SSE2:
+      BitslicedCryptMultiKeySse2(block_keys, in, out, batches, scratch);
+      break;
+    case BitsliceIsa::AVX2:
+      BitslicedCryptMultiKeyAvx2(block_keys, in, out, batches, scratch);
+      break;
+    case BitsliceIsa::AVX512:
+      BitslicedCryptMultiKeyAvx512(block_keys, in, out, batches, scratch);
+      break;
+  }
+  SecureZero(scratch, words * sizeof(uint64_t));
+}
+
+} //crypto
\ No newline at end of file
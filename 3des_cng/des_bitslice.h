@@ -0,0 +1,70 @@
+﻿#ifndef DES_BITSLICE_H_
+#define DES_BITSLICE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace crypto {
+
+// Bitsliced 3DES ECB: 64 * N blocks are transposed so that every DES bit
+// becomes one N-word vector, and the S-boxes are evaluated as boolean
+// circuits across all of them at once. Worth it only for bulk input; the
+// table engine handles the remainder and short messages.
+enum class BitsliceIsa {
+  SCALAR,  // 64 blocks per batch in a uint64_t
+  SSE2,    // 128 blocks
+  AVX2,    // 256 blocks
+  AVX512,  // 512 blocks
+};
+
+// Widest kernel this CPU supports.
+BitsliceIsa BestBitsliceIsa();
+
+bool IsBitsliceIsaSupported(BitsliceIsa isa);
+
+const char *BitsliceIsaName(BitsliceIsa isa);
+
+// Blocks consumed per batch by |isa|.
+size_t BitsliceBatchBlocks(BitsliceIsa isa);
+
+// Subkey bits of one 3DES key (48 rounds x 48 bits) packed MSB first, the
+// per-block key format of the multi-key kernels.
+const size_t BITSLICE_KEY_WORDS = 36;
+
+// constexpr so that schedules of fixed keys (des_key_schedule.h) are
+// packed at compile time too.
+constexpr void PackBitsliceRoundKeys(const uint8_t (*round_keys)[8],
+                                     uint64_t packed[BITSLICE_KEY_WORDS]) {
+  // Four 48-bit rounds fill exactly three words.
+  for (int r = 0; r < 48; r += 4) {
+    uint64_t k[4] = {};
+    for (int i = 0; i < 4; i++) {
+      for (int j = 0; j < 8; j++)
+        k[i] = (k[i] << 6) | round_keys[r + i][j];
+    }
+    uint64_t *p = packed + r / 4 * 3;
+    p[0] = (k[0] << 16) | (k[1] >> 32);
+    p[1] = (k[1] << 32) | (k[2] >> 16);
+    p[2] = (k[2] << 48) | k[3];
+  }
+}
+
+// Runs |batches| whole batches through the 48 |round_keys| (the encrypt or
+// decrypt half of a TripleDesKeySchedule). |in| and |out| may be the same.
+void BitslicedCryptBlocks(BitsliceIsa isa,
+                          const uint8_t (*round_keys)[8],
+                          const uint8_t *in,
+                          uint8_t *out,
+                          size_t batches);
+
+// Same, but block i is processed with its own |block_keys[i]| (packed as
+// above), so blocks under different keys share the vector lanes. The keys
+// are transposed once per batch, much like the data.
+void BitslicedCryptBlocksMultiKey(BitsliceIsa isa,
+                                  const uint64_t *const *block_keys,
+                                  const uint8_t *in,
+                                  uint8_t *out,
+                                  size_t batches);
+} //crypto
+
+#endif  //DES_BITSLICE_H_
\ No newline at end of file
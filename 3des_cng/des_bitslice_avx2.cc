@@ -0,0 +1,80 @@
+﻿#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include "des_bitslice.h"
+#include "des_tables.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+namespace crypto {
+namespace {
+
+struct Avx2Vector {
+  static constexpr int kWords = 4;
+  __m256i v;
+
+  static Avx2Vector Zero() { return {_mm256_setzero_si256()}; }
+  static Avx2Vector Ones() { return {_mm256_set1_epi32(-1)}; }
+  static Avx2Vector Broadcast(uint64_t value) {
+    return {_mm256_set1_epi64x(static_cast<long long>(value))};
+  }
+  static Avx2Vector And(Avx2Vector a, Avx2Vector b) {
+    return {_mm256_and_si256(a.v, b.v)};
+  }
+  static Avx2Vector Or(Avx2Vector a, Avx2Vector b) {
+    return {_mm256_or_si256(a.v, b.v)};
+  }
+  static Avx2Vector Xor(Avx2Vector a, Avx2Vector b) {
+    return {_mm256_xor_si256(a.v, b.v)};
+  }
+  template <int count>
+  static Avx2Vector ShiftLeft(Avx2Vector a) {
+    return {_mm256_slli_epi64(a.v, count)};
+  }
+  template <int count>
+  static Avx2Vector ShiftRight(Avx2Vector a) {
+    return {_mm256_srli_epi64(a.v, count)};
+  }
+  static Avx2Vector Load(const uint64_t *p) {
+    return {_mm256_load_si256(reinterpret_cast<const __m256i *>(p))};
+  }
+  static void Store(uint64_t *p, Avx2Vector a) {
+    _mm256_store_si256(reinterpret_cast<__m256i *>(p), a.v);
+  }
+};
+
+}  // namespace
+} //crypto
+
+#include "des_bitslice_kernel.h"
+
+namespace crypto {
+
+void BitslicedCryptAvx2(const uint8_t (*round_keys)[8],
+                        const uint8_t *in, uint8_t *out, size_t batches) {
+  CryptBatches<Avx2Vector>(round_keys, in, out, batches);
+}
+
+void BitslicedCryptMultiKeyAvx2(const uint64_t *const *block_keys,
+                                const uint8_t *in, uint8_t *out,
+                                size_t batches, uint64_t *scratch) {
+  CryptBatchesMultiKey<Avx2Vector>(block_keys, in, out, batches, scratch);
+}
+
+} //crypto
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif
\ No newline at end of file
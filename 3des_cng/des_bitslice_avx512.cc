@@ -0,0 +1,83 @@
+﻿#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include "des_bitslice.h"
+#include "des_tables.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx512f,avx512bw"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512bw")
+#endif
+
+namespace crypto {
+namespace {
+
+struct Avx512Vector {
+  static constexpr int kWords = 8;
+  __m512i v;
+
+  static Avx512Vector Zero() { return {_mm512_setzero_si512()}; }
+  static Avx512Vector Ones() { return {_mm512_set1_epi32(-1)}; }
+  static Avx512Vector Broadcast(uint64_t value) {
+    return {_mm512_set1_epi64(static_cast<long long>(value))};
+  }
+  static Avx512Vector And(Avx512Vector a, Avx512Vector b) {
+    return {_mm512_and_si512(a.v, b.v)};
+  }
+  static Avx512Vector Or(Avx512Vector a, Avx512Vector b) {
+    return {_mm512_or_si512(a.v, b.v)};
+  }
+  static Avx512Vector Xor(Avx512Vector a, Avx512Vector b) {
+    return {_mm512_xor_si512(a.v, b.v)};
+  }
+  // The zero-masking forms with every lane selected compile to the same
+  // unmasked shift; the plain ones merge into _mm512_undefined_epi32(),
+  // which GCC 12 reports as maybe-uninitialized.
+  template <int count>
+  static Avx512Vector ShiftLeft(Avx512Vector a) {
+    return {_mm512_maskz_slli_epi64(0xff, a.v, count)};
+  }
+  template <int count>
+  static Avx512Vector ShiftRight(Avx512Vector a) {
+    return {_mm512_maskz_srli_epi64(0xff, a.v, count)};
+  }
+  static Avx512Vector Load(const uint64_t *p) {
+    return {_mm512_load_si512(p)};
+  }
+  static void Store(uint64_t *p, Avx512Vector a) {
+    _mm512_store_si512(p, a.v);
+  }
+};
+
+}  // namespace
+} //crypto
+
+#include "des_bitslice_kernel.h"
+
+namespace crypto {
+
+void BitslicedCryptAvx512(const uint8_t (*round_keys)[8],
+                          const uint8_t *in, uint8_t *out, size_t batches) {
+  CryptBatches<Avx512Vector>(round_keys, in, out, batches);
+}
+
+void BitslicedCryptMultiKeyAvx512(const uint64_t *const *block_keys,
+                                  const uint8_t *in, uint8_t *out,
+                                  size_t batches, uint64_t *scratch) {
+  CryptBatchesMultiKey<Avx512Vector>(block_keys, in, out, batches, scratch);
+}
+
+} //crypto
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,319 @@
+﻿#ifndef DES_BITSLICE_KERNEL_H_
+#define DES_BITSLICE_KERNEL_H_
+
+// Bitsliced 3DES core shared by the per-ISA translation units. Each unit
+// defines a vector type V and includes this header after switching the
+// compiler to its target ISA, so everything here has internal linkage: the
+// same inline function compiled for AVX2 must never be picked by the
+// linker for the SSE2 path.
+//
+// V provides kWords (number of 64-bit words per vector) and the static
+// operations Zero, Ones, Broadcast, And, Or, Xor, ShiftLeft<count>,
+// ShiftRight<count> (per 64-bit word, by an immediate), Load and Store.
+//
+// Including units pull in this header's own includes before changing the
+// target, so that no shared inline code is compiled for the wider ISA.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include "des_bitslice.h"
+#include "des_tables.h"
+
+namespace crypto {
+
+// Per-ISA entry points. Each processes |batches| groups of
+// 64 * V::kWords blocks with the 48 round keys in |round_keys|.
+void BitslicedCryptSse2(const uint8_t (*round_keys)[8],
+                        const uint8_t *in, uint8_t *out, size_t batches);
+void BitslicedCryptAvx2(const uint8_t (*round_keys)[8],
+                        const uint8_t *in, uint8_t *out, size_t batches);
+void BitslicedCryptAvx512(const uint8_t (*round_keys)[8],
+                          const uint8_t *in, uint8_t *out, size_t batches);
+
+// Multi-key entry points; |scratch| holds 64-byte aligned room for
+// BITSLICE_KEY_WORDS * 64 * V::kWords words.
+void BitslicedCryptMultiKeySse2(const uint64_t *const *block_keys,
+                                const uint8_t *in, uint8_t *out,
+                                size_t batches, uint64_t *scratch);
+void BitslicedCryptMultiKeyAvx2(const uint64_t *const *block_keys,
+                                const uint8_t *in, uint8_t *out,
+                                size_t batches, uint64_t *scratch);
+void BitslicedCryptMultiKeyAvx512(const uint64_t *const *block_keys,
+                                  const uint8_t *in, uint8_t *out,
+                                  size_t batches, uint64_t *scratch);
+
+namespace {
+
+// position[q] is where S-box output bit q (0-based) lands after P.
+struct InversePermutationP {
+  int position[32];
+
+  constexpr InversePermutationP() : position() {
+    for (int i = 0; i < 32; i++)
+      position[kPermutationP[i] - 1] = i;
+  }
+};
+
+constexpr InversePermutationP kInversePermutationP;
+
+// Truth table over the last two S-box input bits for output bit |bit| when
+// the first four input bits equal |prefix|.
+constexpr int SBoxTail(int box, int bit, int prefix) {
+  int table = 0;
+  for (int c = 0; c < 4; c++) {
+    if ((SBoxLookup(box, prefix * 4 + c) >> (3 - bit)) & 1)
+      table |= 1 << c;
+  }
+  return table;
+}
+
+// Hacker's Delight 64x64 bit matrix transpose, rows MSB first.
+inline void Transpose64(uint64_t a[64]) {
+  uint64_t mask = 0x00000000ffffffffULL;
+  for (int j = 32; j != 0; j >>= 1, mask ^= mask << j) {
+    for (int k = 0; k < 64; k = (k + j + 1) & ~j) {
+      uint64_t t = (a[k] ^ (a[k + j] >> j)) & mask;
+      a[k] ^= t;
+      a[k + j] ^= t << j;
+    }
+  }
+}
+
+// One step of TransposeVector64, swapping the |J|-bit blocks off the
+// diagonal.
+template <int J, typename V>
+inline void TransposeVectorStep(V a[64], uint64_t mask) {
+  V m = V::Broadcast(mask);
+  for (int k = 0; k < 64; k = (k + J + 1) & ~J) {
+    V t = V::And(V::Xor(a[k], V::template ShiftRight<J>(a[k + J])), m);
+    a[k] = V::Xor(a[k], t);
+    a[k + J] = V::Xor(a[k + J], V::template ShiftLeft<J>(t));
+  }
+}
+
+// Transpose64 on kWords independent matrices at once, word g of every
+// vector belonging to matrix g. The steps are spelled out so that every
+// shift count is an immediate.
+template <typename V>
+inline void TransposeVector64(V a[64]) {
+  TransposeVectorStep<32>(a, 0x00000000ffffffffULL);
+  TransposeVectorStep<16>(a, 0x0000ffff0000ffffULL);
+  TransposeVectorStep<8>(a, 0x00ff00ff00ff00ffULL);
+  TransposeVectorStep<4>(a, 0x0f0f0f0f0f0f0f0fULL);
+  TransposeVectorStep<2>(a, 0x3333333333333333ULL);
+  TransposeVectorStep<1>(a, 0x5555555555555555ULL);
+}
+
+inline uint64_t LoadBigEndian(const uint8_t *p) {
+  uint64_t value = 0;
+  for (int i = 0; i < 8; i++)
+    value = (value << 8) | p[i];
+  return value;
+}
+
+inline void StoreBigEndian(uint64_t value, uint8_t *p) {
+  for (int i = 7; i >= 0; i--) {
+    p[i] = static_cast<uint8_t>(value);
+    value >>= 8;
+  }
+}
+
+// Key source for a single key shared by every lane: each subkey bit is
+// broadcast to an all-zero or all-one vector.
+template <typename V>
+struct SharedRoundKeys {
+  const uint8_t (*round_keys)[8];
+
+  V Get(int round, int bit) const {
+    uint64_t value = (round_keys[round][bit / 6] >> (5 - bit % 6)) & 1;
+    return V::Broadcast(0 - value);
+  }
+};
+
+// Key source with a different key per lane: |bits| holds every subkey bit
+// transposed across the batch the same way as the data.
+template <typename V>
+struct LaneRoundKeys {
+  const uint64_t (*bits)[V::kWords];
+
+  V Get(int round, int bit) const {
+    return V::Load(bits[round * 48 + bit]);
+  }
+};
+
+template <typename V, int S, int T, int I>
+inline void AddSBoxTerm(V &acc, const V *prefix, const V *tail) {
+  constexpr int table = SBoxTail(S, T, I);
+  if constexpr (table == 15) {
+    acc = V::Or(acc, prefix[I]);
+  } else if constexpr (table != 0) {
+    acc = V::Or(acc, V::And(prefix[I], tail[table]));
+  }
+}
+
+template <typename V, int S, int T, int... I>
+inline V SBoxBit(const V *prefix, const V *tail,
+                 std::integer_sequence<int, I...>) {
+  V acc = V::Zero();
+  (AddSBoxTerm<V, S, T, I>(acc, prefix, tail), ...);
+  return acc;
+}
+
+// Decodes the first four inputs into 16 minterms and the last two into all
+// 16 functions of two variables; each output bit is then an OR of minterms
+// masked by the right two-variable function, chosen at compile time from
+// the S-box table.
+template <typename V, int S>
+inline void SBox(const V x[6], V out[4]) {
+  V ones = V::Ones();
+  V a[4], b[4], prefix[16], tail[16];
+  a[0] = V::And(V::Xor(x[0], ones), V::Xor(x[1], ones));
+  a[1] = V::And(V::Xor(x[0], ones), x[1]);
+  a[2] = V::And(x[0], V::Xor(x[1], ones));
+  a[3] = V::And(x[0], x[1]);
+  b[0] = V::And(V::Xor(x[2], ones), V::Xor(x[3], ones));
+  b[1] = V::And(V::Xor(x[2], ones), x[3]);
+  b[2] = V::And(x[2], V::Xor(x[3], ones));
+  b[3] = V::And(x[2], x[3]);
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++)
+      prefix[i * 4 + j] = V::And(a[i], b[j]);
+  }
+
+  V c0 = V::And(V::Xor(x[4], ones), V::Xor(x[5], ones));
+  V c1 = V::And(V::Xor(x[4], ones), x[5]);
+  V c2 = V::And(x[4], V::Xor(x[5], ones));
+  V c3 = V::And(x[4], x[5]);
+  tail[0] = V::Zero();
+  tail[1] = c0;
+  tail[2] = c1;
+  tail[3] = V::Xor(x[4], ones);
+  tail[4] = c2;
+  tail[5] = V::Xor(x[5], ones);
+  tail[6] = V::Xor(x[4], x[5]);
+  tail[7] = V::Xor(c3, ones);
+  tail[8] = c3;
+  tail[9] = V::Xor(tail[6], ones);
+  tail[10] = x[5];
+  tail[11] = V::Xor(c2, ones);
+  tail[12] = x[4];
+  tail[13] = V::Xor(c1, ones);
+  tail[14] = V::Xor(c0, ones);
+  tail[15] = ones;
+
+  std::make_integer_sequence<int, 16> terms;
+  out[0] = SBoxBit<V, S, 0>(prefix, tail, terms);
+  out[1] = SBoxBit<V, S, 1>(prefix, tail, terms);
+  out[2] = SBoxBit<V, S, 2>(prefix, tail, terms);
+  out[3] = SBoxBit<V, S, 3>(prefix, tail, terms);
+}
+
+template <typename V, typename Key, int S>
+inline void RoundSBox(V *l, const V *r, const Key &key, int round) {
+  V x[6], y[4];
+  for (int i = 0; i < 6; i++)
+    x[i] = V::Xor(r[kExpansion[S * 6 + i] - 1], key.Get(round, S * 6 + i));
+  SBox<V, S>(x, y);
+  for (int i = 0; i < 4; i++) {
+    int position = kInversePermutationP.position[S * 4 + i];
+    l[position] = V::Xor(l[position], y[i]);
+  }
+}
+
+template <typename V, typename Key, int... S>
+inline void Round(V *l, const V *r, const Key &key, int round,
+                  std::integer_sequence<int, S...>) {
+  (RoundSBox<V, Key, S>(l, r, key, round), ...);
+}
+
+// One batch of 64 * V::kWords blocks. Transposing puts bit j of every block
+// in vector j, so IP, E, P and FP become plain indexing.
+template <typename V, typename Key>
+void CryptBatch(const Key &key, const uint8_t *in, uint8_t *out) {
+  constexpr int words = V::kWords;
+  alignas(64) uint64_t planes[64][words];
+  uint64_t rows[64];
+  for (int g = 0; g < words; g++) {
+    for (int i = 0; i < 64; i++)
+      rows[i] = LoadBigEndian(in + (g * 64 + i) * 8);
+    Transpose64(rows);
+    for (int j = 0; j < 64; j++)
+      planes[j][g] = rows[j];
+  }
+
+  V l[32], r[32];
+  for (int i = 0; i < 32; i++) {
+    l[i] = V::Load(planes[kInitialPermutation[i] - 1]);
+    r[i] = V::Load(planes[kInitialPermutation[32 + i] - 1]);
+  }
+
+  // Same round structure as the table engine: 16 rounds per pass with the
+  // halves swapped between passes.
+  V *left = l;
+  V *right = r;
+  std::make_integer_sequence<int, 8> boxes;
+  for (int pass = 0; pass < 3; pass++) {
+    for (int i = 0; i < 16; i += 2) {
+      Round(left, right, key, pass * 16 + i, boxes);
+      Round(right, left, key, pass * 16 + i + 1, boxes);
+    }
+    V *t = left;
+    left = right;
+    right = t;
+  }
+
+  for (int i = 0; i < 32; i++) {
+    V::Store(planes[kInitialPermutation[i] - 1], left[i]);
+    V::Store(planes[kInitialPermutation[32 + i] - 1], right[i]);
+  }
+  for (int g = 0; g < words; g++) {
+    for (int j = 0; j < 64; j++)
+      rows[j] = planes[j][g];
+    Transpose64(rows);
+    for (int i = 0; i < 64; i++)
+      StoreBigEndian(rows[i], out + (g * 64 + i) * 8);
+  }
+}
+
+template <typename V>
+void CryptBatches(const uint8_t (*round_keys)[8],
+                  const uint8_t *in, uint8_t *out, size_t batches) {
+  SharedRoundKeys<V> key = {round_keys};
+  const size_t batch_bytes = 64 * 8 * V::kWords;
+  for (size_t i = 0; i < batches; i++)
+    CryptBatch<V>(key, in + i * batch_bytes, out + i * batch_bytes);
+}
+
+// The 36 packed key words of the blocks in a batch are transposed word by
+// word, all kWords groups of 64 blocks at once.
+template <typename V>
+void CryptBatchesMultiKey(const uint64_t *const *block_keys,
+                          const uint8_t *in, uint8_t *out,
+                          size_t batches, uint64_t *scratch) {
+  constexpr int words = V::kWords;
+  uint64_t (*bits)[words] = reinterpret_cast<uint64_t (*)[words]>(scratch);
+  LaneRoundKeys<V> key = {bits};
+  const size_t batch_blocks = 64 * words;
+  alignas(64) uint64_t gather[64][words];
+  V rows[64];
+  for (size_t i = 0; i < batches; i++) {
+    const uint64_t *const *keys = block_keys + i * batch_blocks;
+    for (size_t w = 0; w < BITSLICE_KEY_WORDS; w++) {
+      for (int b = 0; b < 64; b++) {
+        for (int g = 0; g < words; g++)
+          gather[b][g] = keys[g * 64 + b][w];
+        rows[b] = V::Load(gather[b]);
+      }
+      TransposeVector64(rows);
+      for (int t = 0; t < 64; t++)
+        V::Store(bits[w * 64 + t], rows[t]);
+    }
+    CryptBatch<V>(key, in + i * batch_blocks * 8, out + i * batch_blocks * 8);
+  }
+}
+
+}  // namespace
+} //crypto
+
+#endif  //DES_BITSLICE_KERNEL_H_
\ No newline at end of file
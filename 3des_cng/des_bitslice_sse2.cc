@@ -0,0 +1,80 @@
+﻿#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include "des_bitslice.h"
+#include "des_tables.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("sse2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("sse2")
+#endif
+
+namespace crypto {
+namespace {
+
+struct Sse2Vector {
+  static constexpr int kWords = 2;
+  __m128i v;
+
+  static Sse2Vector Zero() { return {_mm_setzero_si128()}; }
+  static Sse2Vector Ones() { return {_mm_set1_epi32(-1)}; }
+  static Sse2Vector Broadcast(uint64_t value) {
+    return {_mm_set1_epi64x(static_cast<long long>(value))};
+  }
+  static Sse2Vector And(Sse2Vector a, Sse2Vector b) {
+    return {_mm_and_si128(a.v, b.v)};
+  }
+  static Sse2Vector Or(Sse2Vector a, Sse2Vector b) {
+    return {_mm_or_si128(a.v, b.v)};
+  }
+  static Sse2Vector Xor(Sse2Vector a, Sse2Vector b) {
+    return {_mm_xor_si128(a.v, b.v)};
+  }
+  template <int count>
+  static Sse2Vector ShiftLeft(Sse2Vector a) {
+    return {_mm_slli_epi64(a.v, count)};
+  }
+  template <int count>
+  static Sse2Vector ShiftRight(Sse2Vector a) {
+    return {_mm_srli_epi64(a.v, count)};
+  }
+  static Sse2Vector Load(const uint64_t *p) {
+    return {_mm_load_si128(reinterpret_cast<const __m128i *>(p))};
+  }
+  static void Store(uint64_t *p, Sse2Vector a) {
+    _mm_store_si128(reinterpret_cast<__m128i *>(p), a.v);
+  }
+};
+
+}  // namespace
+} //crypto
+
+#include "des_bitslice_kernel.h"
+
+namespace crypto {
+
+void BitslicedCryptSse2(const uint8_t (*round_keys)[8],
+                        const uint8_t *in, uint8_t *out, size_t batches) {
+  CryptBatches<Sse2Vector>(round_keys, in, out, batches);
+}
+
+void BitslicedCryptMultiKeySse2(const uint64_t *const *block_keys,
+                                const uint8_t *in, uint8_t *out,
+                                size_t batches, uint64_t *scratch) {
+  CryptBatchesMultiKey<Sse2Vector>(block_keys, in, out, batches, scratch);
+}
+
+} //crypto
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,274 @@
+﻿#include "des_engine.h"
+#include <string.h>
+#include <algorithm>
+#include "des_bitslice.h"
+#include "des_key_schedule.h"
+#include "des_tables.h"
+
+namespace crypto {
+
+namespace {
+
+inline uint32_t RotateLeft(uint32_t value, int count) {
+  return (value << count) | (value >> (32 - count));
+}
+
+inline uint64_t LoadBlock(const uint8_t *p) {
+  return (uint64_t(p[0]) << 56) | (uint64_t(p[1]) << 48) |
+         (uint64_t(p[2]) << 40) | (uint64_t(p[3]) << 32) |
+         (uint64_t(p[4]) << 24) | (uint64_t(p[5]) << 16) |
+         (uint64_t(p[6]) << 8) | uint64_t(p[7]);
+}
+
+inline void StoreBlock(uint64_t block, uint8_t *p) {
+  for (int i = 7; i >= 0; i--) {
+    p[i] = static_cast<uint8_t>(block);
+    block >>= 8;
+  }
+}
+
+// IP and FP as swap-move networks on the two 32-bit halves.
+inline void InitialPermutation(uint64_t block, uint32_t *left, uint32_t *right) {
+  uint32_t l = static_cast<uint32_t>(block >> 32);
+  uint32_t r = static_cast<uint32_t>(block);
+  uint32_t work;
+  work = ((l >> 4) ^ r) & 0x0f0f0f0f; r ^= work; l ^= work << 4;
+  work = ((l >> 16) ^ r) & 0x0000ffff; r ^= work; l ^= work << 16;
+  work = ((r >> 2) ^ l) & 0x33333333; l ^= work; r ^= work << 2;
+  work = ((r >> 8) ^ l) & 0x00ff00ff; l ^= work; r ^= work << 8;
+  r = RotateLeft(r, 1);
+  work = (l ^ r) & 0xaaaaaaaa; l ^= work; r ^= work;
+  *left = l;
+  *right = RotateLeft(r, 31);
+}
+
+inline uint64_t FinalPermutation(uint32_t l, uint32_t r) {
+  uint32_t work;
+  r = RotateLeft(r, 1);
+  work = (l ^ r) & 0xaaaaaaaa; l ^= work; r ^= work;
+  r = RotateLeft(r, 31);
+  work = ((r >> 8) ^ l) & 0x00ff00ff; l ^= work; r ^= work << 8;
+  work = ((r >> 2) ^ l) & 0x33333333; l ^= work; r ^= work << 2;
+  work = ((l >> 16) ^ r) & 0x0000ffff; r ^= work; l ^= work << 16;
+  work = ((l >> 4) ^ r) & 0x0f0f0f0f; r ^= work; l ^= work << 4;
+  return (uint64_t(l) << 32) | r;
+}
+
+// E expansion without a table: duplicating rotr(r, 1) into both halves of a
+// 64-bit word puts the six input bits of S-box i at bit 58 - 4 * i.
+inline uint32_t Feistel(const SpTable &table, uint32_t r, const uint8_t *k) {
+  uint32_t x = RotateLeft(r, 31);
+  uint64_t e = (uint64_t(x) << 32) | x;
+  return table.sp[0][((e >> 58) ^ k[0]) & 63] |
+         table.sp[1][((e >> 54) ^ k[1]) & 63] |
+         table.sp[2][((e >> 50) ^ k[2]) & 63] |
+         table.sp[3][((e >> 46) ^ k[3]) & 63] |
+         table.sp[4][((e >> 42) ^ k[4]) & 63] |
+         table.sp[5][((e >> 38) ^ k[5]) & 63] |
+         table.sp[6][((e >> 34) ^ k[6]) & 63] |
+         table.sp[7][((e >> 30) ^ k[7]) & 63];
+}
+
+// FP followed by IP between the three passes cancels out, so 3DES is one
+// IP, 48 rounds with a half swap after every 16, and one FP.
+void TableCryptBlocks(const uint8_t (*round_keys)[8],
+                      const uint8_t *in,
+                      uint8_t *out,
+                      size_t blocks) {
+  const SpTable &table = kSpTable;
+  for (size_t b = 0; b < blocks; b++) {
+    uint32_t l, r;
+    InitialPermutation(LoadBlock(in + b * DES_BLOCK_SIZE), &l, &r);
+    const uint8_t (*k)[8] = round_keys;
+    for (int pass = 0; pass < 3; pass++) {
+      for (int i = 0; i < 8; i++) {
+        l ^= Feistel(table, r, k[0]);
+        r ^= Feistel(table, l, k[1]);
+        k += 2;
+      }
+      uint32_t t = l;
+      l = r;
+      r = t;
+    }
+    StoreBlock(FinalPermutation(l, r), out + b * DES_BLOCK_SIZE);
+  }
+}
+
+}  // namespace
+
+bool PadTripleDesKey(std::string_view key, uint8_t padded[DES3_KEY_SIZE]) {
+  if (key.size() > DES3_KEY_SIZE)
+    return false;
+  memset(padded, 0, DES3_KEY_SIZE);
+  memcpy(padded, key.data(), key.size());
+  return true;
+}
+
+void ExpandTripleDesKey(const uint8_t key[DES3_KEY_SIZE],
+                        TripleDesKeySchedule *schedule) {
+  *schedule = MakeTripleDesKeySchedule(key);
+}
+
+KeyCache<TripleDesKeySchedule>::Entry GetTripleDesKeySchedule(
+    KeyCache<TripleDesKeySchedule> *cache,
+    std::string_view key) {
+  uint8_t deskey[DES3_KEY_SIZE];
+  if (!PadTripleDesKey(key, deskey))
+    return nullptr;
+  KeyCache<TripleDesKeySchedule>::Entry schedule = cache->Get(
+      std::string_view(reinterpret_cast<const char *>(deskey), DES3_KEY_SIZE),
+      [](std::string_view padded) {
+        KeyCache<TripleDesKeySchedule>::Entry entry(
+            new TripleDesKeySchedule,
+            [](TripleDesKeySchedule *p) {
+              SecureZero(p, sizeof(*p));
+              delete p;
+            });
+        ExpandTripleDesKey(reinterpret_cast<const uint8_t *>(padded.data()),
+                           entry.get());
+        return entry;
+      });
+  SecureZero(deskey, sizeof(deskey));
+  return schedule;
+}
+
+// Whole batches go to the widest bitsliced kernel, what is left over steps
+// down through the narrower ones, and only the last < 64 blocks use the
+// tables.
+void TripleDesCryptBlocks(const uint8_t (*round_keys)[8],
+                          const uint8_t *in,
+                          uint8_t *out,
+                          size_t blocks) {
+  if (blocks >= BitsliceBatchBlocks(BitsliceIsa::SCALAR)) {
+    for (int level = static_cast<int>(BestBitsliceIsa()); level >= 0; level--) {
+      BitsliceIsa isa = static_cast<BitsliceIsa>(level);
+      size_t batch = BitsliceBatchBlocks(isa);
+      size_t batches = blocks / batch;
+      if (batches == 0)
+        continue;
+      BitslicedCryptBlocks(isa, round_keys, in, out, batches);
+      in += batches * batch * DES_BLOCK_SIZE;
+      out += batches * batch * DES_BLOCK_SIZE;
+      blocks -= batches * batch;
+    }
+  }
+  TableCryptBlocks(round_keys, in, out, blocks);
+}
+
+void TripleDesEncryptBlocks(const TripleDesKeySchedule &schedule,
+                            const uint8_t *in,
+                            uint8_t *out,
+                            size_t blocks) {
+  TripleDesCryptBlocks(schedule.encrypt, in, out, blocks);
+}
+
+void TripleDesDecryptBlocks(const TripleDesKeySchedule &schedule,
+                            const uint8_t *in,
+                            uint8_t *out,
+                            size_t blocks) {
+  TripleDesCryptBlocks(schedule.decrypt, in, out, blocks);
+}
+
+void TripleDesCryptBlocksMultiKey(const TripleDesKeySchedule *const *schedules,
+                                  bool encrypt,
+                                  const uint8_t *in,
+                                  uint8_t *out,
+                                  size_t blocks) {
+  // Key pointers go to the kernels one window at a time, from the stack;
+  // a window is a whole number of batches of every ISA.
+  const size_t KEY_WINDOW = 512;
+  const uint64_t *block_keys[KEY_WINDOW];
+  size_t bulk = blocks / BitsliceBatchBlocks(BitsliceIsa::SCALAR) *
+                BitsliceBatchBlocks(BitsliceIsa::SCALAR);
+  size_t done = 0;
+  while (done < bulk) {
+    size_t window = std::min(bulk - done, KEY_WINDOW);
+    for (size_t i = 0; i < window; i++) {
+      block_keys[i] = encrypt ? schedules[done + i]->bitslice_encrypt
+                              : schedules[done + i]->bitslice_decrypt;
+    }
+
+    size_t offset = 0;
+    for (int level = static_cast<int>(BestBitsliceIsa()); level >= 0; level--) {
+      BitsliceIsa isa = static_cast<BitsliceIsa>(level);
+      size_t batch = BitsliceBatchBlocks(isa);
+      size_t batches = (window - offset) / batch;
+      if (batches == 0)
+        continue;
+      BitslicedCryptBlocksMultiKey(isa, block_keys + offset,
+                                   in + (done + offset) * DES_BLOCK_SIZE,
+                                   out + (done + offset) * DES_BLOCK_SIZE,
+                                   batches);
+      offset += batches * batch;
+    }
+    done += window;
+  }
+
+  while (done < blocks) {
+    size_t run = 1;
+    while (done + run < blocks && schedules[done + run] == schedules[done])
+      ++run;
+    TableCryptBlocks(encrypt ? schedules[done]->encrypt : schedules[done]->decrypt,
+                     in + done * DES_BLOCK_SIZE,
+                     out + done * DES_BLOCK_SIZE,
+                     run);
+    done += run;
+  }
+}
+
+void TripleDesCbcEncrypt(const TripleDesKeySchedule &schedule,
+                         uint8_t iv[DES_BLOCK_SIZE],
+                         const uint8_t *in,
+                         uint8_t *out,
+                         size_t blocks) {
+  for (size_t b = 0; b < blocks; b++) {
+    XorBytes(iv, in + b * DES_BLOCK_SIZE, iv, DES_BLOCK_SIZE);
+    TableCryptBlocks(schedule.encrypt, iv, iv, 1);
+    memcpy(out + b * DES_BLOCK_SIZE, iv, DES_BLOCK_SIZE);
+  }
+}
+
+// The ciphertext of each chunk is saved first so the XOR still has it when
+// decrypting in place.
+void TripleDesCbcDecrypt(const TripleDesKeySchedule &schedule,
+                         uint8_t iv[DES_BLOCK_SIZE],
+                         const uint8_t *in,
+                         uint8_t *out,
+                         size_t blocks) {
+  uint8_t saved[CHAIN_CHUNK_BYTES];
+  const size_t chunk_blocks = CHAIN_CHUNK_BYTES / DES_BLOCK_SIZE;
+  while (blocks > 0) {
+    size_t count = blocks < chunk_blocks ? blocks : chunk_blocks;
+    size_t size = count * DES_BLOCK_SIZE;
+    memcpy(saved, in, size);
+    TripleDesCryptBlocks(schedule.decrypt, saved, out, count);
+    XorBytes(out, iv, out, DES_BLOCK_SIZE);
+    XorBytes(out + DES_BLOCK_SIZE, saved, out + DES_BLOCK_SIZE,
+             size - DES_BLOCK_SIZE);
+    memcpy(iv, saved + size - DES_BLOCK_SIZE, DES_BLOCK_SIZE);
+    in += size;
+    out += size;
+    blocks -= count;
+  }
+}
+
+void TripleDesCtrCrypt(const TripleDesKeySchedule &schedule,
+                       uint8_t counter[DES_BLOCK_SIZE],
+                       const uint8_t *in,
+                       uint8_t *out,
+                       size_t size) {
+  uint8_t keystream[CHAIN_CHUNK_BYTES];
+  while (size > 0) {
+    size_t count = size < CHAIN_CHUNK_BYTES ? size : CHAIN_CHUNK_BYTES;
+    size_t blocks = (count + DES_BLOCK_SIZE - 1) / DES_BLOCK_SIZE;
+    FillCounterBlocks(counter, DES_BLOCK_SIZE, keystream, blocks);
+    TripleDesCryptBlocks(schedule.encrypt, keystream, keystream, blocks);
+    XorBytes(in, keystream, out, count);
+    in += count;
+    out += count;
+    size -= count;
+  }
+  SecureZero(keystream, sizeof(keystream));
+}
+
+} //crypto
\ No newline at end of file
@@ -0,0 +1,95 @@
+﻿#ifndef DES_ENGINE_H_
+#define DES_ENGINE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string_view>
+#include "chain_mode.h"
+#include "des_bitslice.h"
+#include "key_cache.h"
+
+namespace crypto {
+
+const int DES_BLOCK_SIZE = 8;
+const int DES3_KEY_SIZE = 24;
+const int DES3_ROUNDS = 48;
+
+// Round keys for the three DES passes of 3DES-EDE, one 6-bit S-box input
+// per byte. |encrypt| runs E(K1) D(K2) E(K3), |decrypt| the inverse. The
+// bitslice_ copies are the same keys packed for the multi-key kernels.
+struct TripleDesKeySchedule {
+  uint8_t encrypt[DES3_ROUNDS][8];
+  uint8_t decrypt[DES3_ROUNDS][8];
+  uint64_t bitslice_encrypt[BITSLICE_KEY_WORDS];
+  uint64_t bitslice_decrypt[BITSLICE_KEY_WORDS];
+};
+
+// Zero-extends |key| to 24 bytes the same way BCryptGenerateSymmetricKey is
+// fed by Crypto3DesCNG: 8 and 16 byte keys leave K2/K3 zero. Fails for keys
+// longer than 24 bytes.
+bool PadTripleDesKey(std::string_view key, uint8_t padded[DES3_KEY_SIZE]);
+
+void ExpandTripleDesKey(const uint8_t key[DES3_KEY_SIZE],
+                        TripleDesKeySchedule *schedule);
+
+// Pads |key| and returns its schedule from |cache|, expanding it on a miss.
+// Null if the key is too long. The schedule is wiped when released.
+KeyCache<TripleDesKeySchedule>::Entry GetTripleDesKeySchedule(
+    KeyCache<TripleDesKeySchedule> *cache,
+    std::string_view key);
+
+// ECB over |blocks| 8-byte blocks. |in| and |out| may be the same buffer.
+// From 64 blocks on, the bulk is handled by the bitsliced SIMD kernels
+// (des_bitslice.h) picked for the running CPU.
+void TripleDesEncryptBlocks(const TripleDesKeySchedule &schedule,
+                            const uint8_t *in,
+                            uint8_t *out,
+                            size_t blocks);
+
+void TripleDesDecryptBlocks(const TripleDesKeySchedule &schedule,
+                            const uint8_t *in,
+                            uint8_t *out,
+                            size_t blocks);
+
+// Same with either half of a schedule passed explicitly.
+void TripleDesCryptBlocks(const uint8_t (*round_keys)[8],
+                          const uint8_t *in,
+                          uint8_t *out,
+                          size_t blocks);
+
+// ECB where block i uses its own |schedules[i]|, for many short messages
+// under different keys. Whole bitslice batches carry blocks of different
+// keys side by side in the vector lanes; the rest go through the tables.
+void TripleDesCryptBlocksMultiKey(const TripleDesKeySchedule *const *schedules,
+                                  bool encrypt,
+                                  const uint8_t *in,
+                                  uint8_t *out,
+                                  size_t blocks);
+
+// CBC over whole blocks. |iv| is left at the last ciphertext block so that
+// consecutive calls continue one message. Encryption is inherently serial
+// and uses the tables; decryption runs the blocks through the bitsliced
+// kernels first and XORs afterwards. |in| and |out| may be the same.
+void TripleDesCbcEncrypt(const TripleDesKeySchedule &schedule,
+                         uint8_t iv[DES_BLOCK_SIZE],
+                         const uint8_t *in,
+                         uint8_t *out,
+                         size_t blocks);
+
+void TripleDesCbcDecrypt(const TripleDesKeySchedule &schedule,
+                         uint8_t iv[DES_BLOCK_SIZE],
+                         const uint8_t *in,
+                         uint8_t *out,
+                         size_t blocks);
+
+// CTR over |size| bytes, encrypting and decrypting alike. The keystream is
+// produced in bulk by the bitsliced kernels. |counter| is advanced past
+// every block used, including a final partial one.
+void TripleDesCtrCrypt(const TripleDesKeySchedule &schedule,
+                       uint8_t counter[DES_BLOCK_SIZE],
+                       const uint8_t *in,
+                       uint8_t *out,
+                       size_t size);
+} //crypto
+
+#endif  //DES_ENGINE_H_
\ No newline at end of file
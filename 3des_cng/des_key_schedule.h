@@ -0,0 +1,113 @@
+﻿#ifndef DES_KEY_SCHEDULE_H_
+#define DES_KEY_SCHEDULE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "des_bitslice.h"
+#include "des_engine.h"
+#include "des_tables.h"
+
+namespace crypto {
+
+// The DES key schedule as constexpr functions. ExpandTripleDesKey() runs
+// them on keys known only at run time; for a key written in the source,
+// FixedTripleDesKeySchedule<"...">() has the compiler run them and leaves
+// the finished schedule in read-only data.
+
+// PC1, the sixteen rotations and PC2 for one 8-byte DES key.
+constexpr void ExpandDesKey(const uint8_t *key, uint8_t round_keys[16][8]) {
+  uint64_t block = 0;
+  for (int i = 0; i < DES_BLOCK_SIZE; i++)
+    block = (block << 8) | key[i];
+  uint64_t cd = Permute(block, 64, kPermutedChoice1, 56);
+  uint32_t c = static_cast<uint32_t>(cd >> 28);
+  uint32_t d = static_cast<uint32_t>(cd & 0x0fffffff);
+  for (int i = 0; i < 16; i++) {
+    for (int s = 0; s < kKeyShifts[i]; s++) {
+      c = ((c << 1) | (c >> 27)) & 0x0fffffff;
+      d = ((d << 1) | (d >> 27)) & 0x0fffffff;
+    }
+    uint64_t subkey =
+        Permute((uint64_t(c) << 28) | d, 56, kPermutedChoice2, 48);
+    for (int j = 0; j < 8; j++)
+      round_keys[i][j] = static_cast<uint8_t>((subkey >> (42 - 6 * j)) & 63);
+  }
+}
+
+constexpr void CopyRoundKeys(const uint8_t (*from)[8],
+                             bool reverse,
+                             uint8_t (*to)[8]) {
+  for (int i = 0; i < 16; i++) {
+    for (int j = 0; j < 8; j++)
+      to[i][j] = from[reverse ? 15 - i : i][j];
+  }
+}
+
+// The whole schedule of a padded 24-byte key.
+constexpr TripleDesKeySchedule MakeTripleDesKeySchedule(
+    const uint8_t key[DES3_KEY_SIZE]) {
+  TripleDesKeySchedule schedule = {};
+  uint8_t k1[16][8] = {}, k2[16][8] = {}, k3[16][8] = {};
+  ExpandDesKey(key, k1);
+  ExpandDesKey(key + DES_BLOCK_SIZE, k2);
+  ExpandDesKey(key + 2 * DES_BLOCK_SIZE, k3);
+
+  CopyRoundKeys(k1, false, schedule.encrypt);
+  CopyRoundKeys(k2, true, schedule.encrypt + 16);
+  CopyRoundKeys(k3, false, schedule.encrypt + 32);
+
+  CopyRoundKeys(k3, true, schedule.decrypt);
+  CopyRoundKeys(k2, false, schedule.decrypt + 16);
+  CopyRoundKeys(k1, true, schedule.decrypt + 32);
+
+  PackBitsliceRoundKeys(schedule.encrypt, schedule.bitslice_encrypt);
+  PackBitsliceRoundKeys(schedule.decrypt, schedule.bitslice_decrypt);
+  return schedule;
+}
+
+// A string literal usable as a template argument, as in
+// FixedTripleDesKeySchedule<"12345678">().
+template <size_t N>
+struct FixedDesKey {
+  static_assert(N - 1 <= DES3_KEY_SIZE, "3DES keys are at most 24 bytes");
+
+  constexpr FixedDesKey(const char (&key)[N]) : chars() {
+    for (size_t i = 0; i < N; i++)
+      chars[i] = key[i];
+  }
+
+  static constexpr size_t size() { return N - 1; }
+
+  // Zero-extended to 24 bytes, as PadTripleDesKey() does.
+  constexpr void Pad(uint8_t padded[DES3_KEY_SIZE]) const {
+    for (size_t i = 0; i < DES3_KEY_SIZE; i++)
+      padded[i] = i < size() ? static_cast<uint8_t>(chars[i]) : 0;
+  }
+
+  char chars[N];
+};
+
+namespace internal {
+
+template <FixedDesKey Key>
+constexpr TripleDesKeySchedule MakeFixedKeySchedule() {
+  uint8_t padded[DES3_KEY_SIZE] = {};
+  Key.Pad(padded);
+  return MakeTripleDesKeySchedule(padded);
+}
+
+template <FixedDesKey Key>
+inline constexpr TripleDesKeySchedule kFixedKeySchedule =
+    MakeFixedKeySchedule<Key>();
+
+}  // namespace internal
+
+// The schedule of |Key|, expanded during compilation. Equal to what
+// GetTripleDesKeySchedule() returns for the same key.
+template <FixedDesKey Key>
+constexpr const TripleDesKeySchedule &FixedTripleDesKeySchedule() {
+  return internal::kFixedKeySchedule<Key>;
+}
+} //crypto
+
+#endif  //DES_KEY_SCHEDULE_H_
\ No newline at end of file
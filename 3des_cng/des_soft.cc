@@ -0,0 +1,351 @@
+﻿#include "des_soft.h"
+#include <string.h>
+
+namespace crypto {
+
+Crypto3DesSoft::Crypto3DesSoft(Padding padding,
+                               ChainMode mode,
+                               size_t key_cache_capacity)
+    : padding_(padding),
+      mode_(mode),
+      block_size_(DES_BLOCK_SIZE),
+      initialized_(false),
+      key_cache_(key_cache_capacity) {}
+
+Crypto3DesSoft::~Crypto3DesSoft() {
+}
+
+bool Crypto3DesSoft::Initialize() {
+  initialized_ = true;
+  return true;
+}
+
+size_t Crypto3DesSoft::RequiredOutputSize(size_t plaintext_size) const {
+  if (mode_ == CTR)
+    return plaintext_size;
+  return PaddedSize(padding_, plaintext_size, block_size_);
+}
+
+bool Crypto3DesSoft::DoEncrypt(const std::string &key,
+                               const std::string &plaintext,
+                               std::string *ciphertext) {
+  return DoEncrypt(key, std::string(), plaintext, ciphertext);
+}
+
+bool Crypto3DesSoft::DoDecrypt(const std::string &key,
+                               const std::string &ciphertext,
+                               std::string *plaintext) {
+  return DoDecrypt(key, std::string(), ciphertext, plaintext);
+}
+
+bool Crypto3DesSoft::DoEncrypt(const std::string &key,
+                               const std::string &iv,
+                               const std::string &plaintext,
+                               std::string *ciphertext) {
+  ciphertext->resize(RequiredOutputSize(plaintext.size()));
+  size_t size = 0;
+  bool result = DoEncrypt(
+      key,
+      std::span<const uint8_t>(reinterpret_cast<const uint8_t *>(iv.data()),
+                               iv.size()),
+      std::span<const uint8_t>(
+          reinterpret_cast<const uint8_t *>(plaintext.data()), plaintext.size()),
+      std::span<uint8_t>(reinterpret_cast<uint8_t *>(ciphertext->data()),
+                         ciphertext->size()),
+      &size);
+  ciphertext->resize(size);
+  return result;
+}
+
+bool Crypto3DesSoft::DoDecrypt(const std::string &key,
+                               const std::string &iv,
+                               const std::string &ciphertext,
+                               std::string *plaintext) {
+  plaintext->resize(ciphertext.size());
+  size_t size = 0;
+  bool result = DoDecrypt(
+      key,
+      std::span<const uint8_t>(reinterpret_cast<const uint8_t *>(iv.data()),
+                               iv.size()),
+      std::span<const uint8_t>(
+          reinterpret_cast<const uint8_t *>(ciphertext.data()), ciphertext.size()),
+      std::span<uint8_t>(reinterpret_cast<uint8_t *>(plaintext->data()),
+                         plaintext->size()),
+      &size);
+  plaintext->resize(size);
+  return result;
+}
+
+bool Crypto3DesSoft::DoEncrypt(const std::string &key,
+                               std::span<const uint8_t> plaintext,
+                               std::span<uint8_t> ciphertext,
+                               size_t *written) {
+  return DoEncrypt(key, std::span<const uint8_t>(), plaintext, ciphertext,
+                   written);
+}
+
+bool Crypto3DesSoft::DoDecrypt(const std::string &key,
+                               std::span<const uint8_t> ciphertext,
+                               std::span<uint8_t> plaintext,
+                               size_t *written) {
+  return DoDecrypt(key, std::span<const uint8_t>(), ciphertext, plaintext,
+                   written);
+}
+
+bool Crypto3DesSoft::DoEncrypt(const std::string &key,
+                               std::span<const uint8_t> iv,
+                               std::span<const uint8_t> plaintext,
+                               std::span<uint8_t> ciphertext,
+                               size_t *written) {
+  *written = 0;
+  if (!initialized_ || !IsValidIv(mode_, iv.size(), block_size_))
+    return false;
+
+  size_t buffer_size = RequiredOutputSize(plaintext.size());
+  if (ciphertext.size() < buffer_size)
+    return false;
+
+  KeyCache<TripleDesKeySchedule>::Entry schedule =
+      GetTripleDesKeySchedule(&key_cache_, key);
+  if (!schedule)
+    return false;
+
+  uint8_t *output = ciphertext.data();
+  if (mode_ == CTR) {
+    uint8_t counter[DES_BLOCK_SIZE];
+    memcpy(counter, iv.data(), DES_BLOCK_SIZE);
+    TripleDesCtrCrypt(*schedule, counter, plaintext.data(), output,
+                      plaintext.size());
+    *written = buffer_size;
+    return true;
+  }
+
+  if (output != plaintext.data() && !plaintext.empty())
+    memmove(output, plaintext.data(), plaintext.size());
+  ApplyPadding(padding_, output, plaintext.size(), buffer_size);
+
+  if (mode_ == CBC) {
+    uint8_t chain[DES_BLOCK_SIZE];
+    memcpy(chain, iv.data(), DES_BLOCK_SIZE);
+    TripleDesCbcEncrypt(*schedule, chain, output, output,
+                        buffer_size / block_size_);
+  } else {
+    TripleDesEncryptBlocks(*schedule, output, output, buffer_size / block_size_);
+  }
+  *written = buffer_size;
+  return true;
+}
+
+bool Crypto3DesSoft::DoDecrypt(const std::string &key,
+                               std::span<const uint8_t> iv,
+                               std::span<const uint8_t> ciphertext,
+                               std::span<uint8_t> plaintext,
+                               size_t *written) {
+  *written = 0;
+  if (!initialized_ || !IsValidIv(mode_, iv.size(), block_size_))
+    return false;
+
+  size_t cipher_size = ciphertext.size();
+  if ((mode_ != CTR && cipher_size % block_size_) ||
+      plaintext.size() < cipher_size)
+    return false;
+
+  KeyCache<TripleDesKeySchedule>::Entry schedule =
+      GetTripleDesKeySchedule(&key_cache_, key);
+  if (!schedule)
+    return false;
+
+  if (cipher_size == 0)
+    return true;
+  uint8_t *output = plaintext.data();
+  uint8_t chain[DES_BLOCK_SIZE];
+  switch (mode_) {
+    case CTR:
+      memcpy(chain, iv.data(), DES_BLOCK_SIZE);
+      TripleDesCtrCrypt(*schedule, chain, ciphertext.data(), output, cipher_size);
+      *written = cipher_size;
+      return true;
+    case CBC:
+      memcpy(chain, iv.data(), DES_BLOCK_SIZE);
+      TripleDesCbcDecrypt(*schedule, chain, ciphertext.data(), output,
+                          cipher_size / block_size_);
+      break;
+    default:
+      TripleDesDecryptBlocks(*schedule,
+                             ciphertext.data(),
+                             output,
+                             cipher_size / block_size_);
+      break;
+  }
+
+  *written = cipher_size - PaddingLength(padding_, output, cipher_size);
+  return true;
+}
+
+bool Crypto3DesSoft::DoEncryptInPlace(const std::string &key,
+                                      std::span<uint8_t> buffer,
+                                      size_t size,
+                                      size_t *written) {
+  if (size > buffer.size()) {
+    *written = 0;
+    return false;
+  }
+  return DoEncrypt(key, buffer.first(size), buffer, written);
+}
+
+bool Crypto3DesSoft::DoDecryptInPlace(const std::string &key,
+                                      std::span<uint8_t> buffer,
+                                      size_t *written) {
+  return DoDecrypt(key, buffer, buffer, written);
+}
+
+namespace {
+
+// A job of up to this many blocks is staged for the multi-key engine; a
+// larger one has a single key anyway and runs on its own.
+const size_t BATCH_MAX_JOB_BLOCKS = 64;
+
+// Blocks run per partial flush: one batch of the widest kernel, which is
+// a whole number of batches for the narrower ones too.
+const size_t BATCH_FLUSH_BLOCKS = 512;
+
+// Blocks staged at most. A partial flush leaves under one flush plus the
+// start of a job that straddles it, so the next job always fits, and the
+// window stays small enough for the stack.
+const size_t BATCH_WINDOW_BLOCKS =
+    BATCH_FLUSH_BLOCKS + 2 * BATCH_MAX_JOB_BLOCKS;
+
+}  // namespace
+
+size_t Crypto3DesSoft::EncryptBatch(std::span<const Job> jobs,
+                                    std::span<JobResult> results) {
+  return CryptBatch(true, jobs, results);
+}
+
+size_t Crypto3DesSoft::DecryptBatch(std::span<const Job> jobs,
+                                    std::span<JobResult> results) {
+  return CryptBatch(false, jobs, results);
+}
+
+// Jobs are staged into one contiguous buffer with a round-key pointer per
+// block and run through the multi-key engine. Until the last window only
+// whole batches of the widest kernel are run, so narrower kernels and the
+// scalar tail are paid once per call; jobs not yet complete move to the front of the window and the
+// finished ones are scattered back. Nothing is allocated.
+size_t Crypto3DesSoft::CryptBatch(bool encrypt,
+                                  std::span<const Job> jobs,
+                                  std::span<JobResult> results) {
+  if (results.size() < jobs.size())
+    return 0;
+
+  uint8_t staging[BATCH_WINDOW_BLOCKS * DES_BLOCK_SIZE];
+  const TripleDesKeySchedule *block_schedules[BATCH_WINDOW_BLOCKS];
+  KeyCache<TripleDesKeySchedule>::Entry schedules[BATCH_WINDOW_BLOCKS];
+  size_t window_jobs[BATCH_WINDOW_BLOCKS];
+  size_t job_starts[BATCH_WINDOW_BLOCKS];
+  size_t count = 0;
+  size_t blocks = 0;
+  size_t crypted = 0;
+  size_t succeeded = 0;
+
+  auto flush = [&](bool all) {
+    size_t n = blocks - crypted;
+    if (!all)
+      n -= n % BATCH_FLUSH_BLOCKS;
+    TripleDesCryptBlocksMultiKey(block_schedules + crypted, encrypt,
+                                 staging + crypted * DES_BLOCK_SIZE,
+                                 staging + crypted * DES_BLOCK_SIZE, n);
+    crypted += n;
+
+    size_t done = 0;
+    for (; done < count; done++) {
+      const Job &job = jobs[window_jobs[done]];
+      size_t size = encrypt ? RequiredOutputSize(job.input.size())
+                            : job.input.size();
+      if (job_starts[done] + size / DES_BLOCK_SIZE > crypted)
+        break;
+      size_t written = size;
+      if (size > 0) {
+        memcpy(job.output.data(),
+               staging + job_starts[done] * DES_BLOCK_SIZE, size);
+        if (!encrypt)
+          written -= PaddingLength(padding_, job.output.data(), size);
+      }
+      results[window_jobs[done]].ok = true;
+      results[window_jobs[done]].written = written;
+      schedules[done].reset();
+    }
+    succeeded += done;
+
+    size_t first = done < count ? job_starts[done] : blocks;
+    memmove(staging, staging + first * DES_BLOCK_SIZE,
+            (blocks - first) * DES_BLOCK_SIZE);
+    memmove(block_schedules, block_schedules + first,
+            (blocks - first) * sizeof(block_schedules[0]));
+    for (size_t j = done; j < count; j++) {
+      schedules[j - done] = std::move(schedules[j]);
+      window_jobs[j - done] = window_jobs[j];
+      job_starts[j - done] = job_starts[j] - first;
+    }
+    count -= done;
+    blocks -= first;
+    crypted -= first;
+  };
+
+  for (size_t i = 0; i < jobs.size(); i++) {
+    results[i].ok = false;
+    results[i].written = 0;
+    const Job &job = jobs[i];
+    size_t size = job.input.size();
+    size_t crypt_size = encrypt ? RequiredOutputSize(size) : size;
+    if (!initialized_ || mode_ != ECB || crypt_size % block_size_ ||
+        job.output.size() < crypt_size)
+      continue;
+    KeyCache<TripleDesKeySchedule>::Entry schedule =
+        GetTripleDesKeySchedule(&key_cache_, job.key);
+    if (!schedule)
+      continue;
+
+    size_t job_blocks = crypt_size / block_size_;
+    if (job_blocks > BATCH_MAX_JOB_BLOCKS) {
+      uint8_t *output = job.output.data();
+      if (encrypt) {
+        if (output != job.input.data())
+          memmove(output, job.input.data(), size);
+        ApplyPadding(padding_, output, size, crypt_size);
+        TripleDesEncryptBlocks(*schedule, output, output, job_blocks);
+        results[i].written = crypt_size;
+      } else {
+        TripleDesDecryptBlocks(*schedule, job.input.data(), output, job_blocks);
+        results[i].written =
+            crypt_size - PaddingLength(padding_, output, crypt_size);
+      }
+      results[i].ok = true;
+      ++succeeded;
+      continue;
+    }
+
+    // Only a window full of empty jobs needs a full flush.
+    if (count == BATCH_WINDOW_BLOCKS)
+      flush(true);
+    else if (blocks + job_blocks > BATCH_WINDOW_BLOCKS)
+      flush(false);
+    uint8_t *staged = staging + blocks * DES_BLOCK_SIZE;
+    if (size > 0)
+      memcpy(staged, job.input.data(), size);
+    if (encrypt)
+      ApplyPadding(padding_, staged, size, crypt_size);
+    for (size_t b = 0; b < job_blocks; b++)
+      block_schedules[blocks + b] = schedule.get();
+    schedules[count] = std::move(schedule);
+    job_starts[count] = blocks;
+    window_jobs[count++] = i;
+    blocks += job_blocks;
+  }
+  if (count > 0)
+    flush(true);
+  SecureZero(staging, sizeof(staging));
+  return succeeded;
+}
+
+} //crypto
\ No newline at end of file
@@ -0,0 +1,196 @@
+﻿#ifndef DES_SOFT_H_
+#define DES_SOFT_H_
+
+#include <stdint.h>
+#include <span>
+#include <string>
+#include <string_view>
+#include "chain_mode.h"
+#include "des_engine.h"
+#include "des_key_schedule.h"
+#include "key_cache.h"
+#include "padding.h"
+
+namespace crypto {
+
+// Portable 3DES-EDE with the same interface and output as Crypto3DesCNG,
+// for platforms without BCrypt.
+class Crypto3DesSoft {
+public:
+  // One message of a batch. |output| follows the span overload rules.
+  struct Job {
+    std::string_view key;
+    std::span<const uint8_t> input;
+    std::span<uint8_t> output;
+  };
+
+  struct JobResult {
+    bool ok;
+    size_t written;
+  };
+
+  explicit Crypto3DesSoft(Padding padding,
+                          ChainMode mode = ECB,
+                          size_t key_cache_capacity = DEFAULT_KEY_CACHE_CAPACITY);
+
+  virtual ~Crypto3DesSoft();
+
+  bool Initialize();
+
+  bool DoEncrypt(const std::string &key,
+                 const std::string &plaintext,
+                 std::string *ciphertext);
+
+  bool DoDecrypt(const std::string &key,
+                 const std::string &ciphertext,
+                 std::string *plaintext);
+
+  // CBC and CTR take an 8-byte |iv|; the overloads without one only work
+  // in ECB mode.
+  bool DoEncrypt(const std::string &key,
+                 const std::string &iv,
+                 const std::string &plaintext,
+                 std::string *ciphertext);
+
+  bool DoDecrypt(const std::string &key,
+                 const std::string &iv,
+                 const std::string &ciphertext,
+                 std::string *plaintext);
+
+  // Ciphertext size for |plaintext_size| bytes of input.
+  size_t RequiredOutputSize(size_t plaintext_size) const;
+
+  // Allocation-free variants. |ciphertext| must hold
+  // RequiredOutputSize(plaintext.size()) bytes and |plaintext| must hold
+  // ciphertext.size() bytes. Input and output may be the same buffer.
+  bool DoEncrypt(const std::string &key,
+                 std::span<const uint8_t> plaintext,
+                 std::span<uint8_t> ciphertext,
+                 size_t *written);
+
+  bool DoDecrypt(const std::string &key,
+                 std::span<const uint8_t> ciphertext,
+                 std::span<uint8_t> plaintext,
+                 size_t *written);
+
+  bool DoEncrypt(const std::string &key,
+                 std::span<const uint8_t> iv,
+                 std::span<const uint8_t> plaintext,
+                 std::span<uint8_t> ciphertext,
+                 size_t *written);
+
+  bool DoDecrypt(const std::string &key,
+                 std::span<const uint8_t> iv,
+                 std::span<const uint8_t> ciphertext,
+                 std::span<uint8_t> plaintext,
+                 size_t *written);
+
+  // Encrypts the first |size| bytes of |buffer| in place; |buffer| must have
+  // room for the padding.
+  bool DoEncryptInPlace(const std::string &key,
+                        std::span<uint8_t> buffer,
+                        size_t size,
+                        size_t *written);
+
+  bool DoDecryptInPlace(const std::string &key,
+                        std::span<uint8_t> buffer,
+                        size_t *written);
+
+  // ECB over many messages at once, each under its own key. Blocks of all
+  // jobs are interleaved through the multi-key bitsliced kernels, so a
+  // batch of one or two block messages still fills the SIMD lanes.
+  // Padding is the same as DoEncrypt()/DoDecrypt() per message. |results|
+  // must have one entry per job; returns how many jobs succeeded. Fails
+  // every job outside ECB mode.
+  size_t EncryptBatch(std::span<const Job> jobs, std::span<JobResult> results);
+
+  size_t DecryptBatch(std::span<const Job> jobs, std::span<JobResult> results);
+
+  KeyCache<TripleDesKeySchedule> &key_cache() { return key_cache_; }
+private:
+  size_t CryptBatch(bool encrypt,
+                    std::span<const Job> jobs,
+                    std::span<JobResult> results);
+
+  Padding padding_;
+  ChainMode mode_;
+  uint32_t block_size_;
+  bool initialized_;
+  KeyCache<TripleDesKeySchedule> key_cache_;
+};
+
+// Backend policy for BlockCipher (block_cipher.h) on des_engine.h.
+class SoftDesBackend {
+public:
+  typedef KeyCache<TripleDesKeySchedule>::Entry Key;
+
+  static constexpr size_t BLOCK_SIZE = DES_BLOCK_SIZE;
+
+  explicit SoftDesBackend(
+      size_t key_cache_capacity = DEFAULT_KEY_CACHE_CAPACITY)
+      : key_cache_(key_cache_capacity) {}
+
+  bool Initialize(ChainMode) { return true; }
+
+  Key GetKey(std::string_view key) {
+    return GetTripleDesKeySchedule(&key_cache_, key);
+  }
+
+  // |key| is a Key, or a plain schedule pointer from FixedKeyDesBackend.
+  template <ChainMode Mode, typename Schedule>
+  bool Encrypt(const Schedule &key,
+               uint8_t *iv,
+               const uint8_t *in,
+               uint8_t *out,
+               size_t size) {
+    if constexpr (Mode == ECB)
+      TripleDesEncryptBlocks(*key, in, out, size / BLOCK_SIZE);
+    else if constexpr (Mode == CBC)
+      TripleDesCbcEncrypt(*key, iv, in, out, size / BLOCK_SIZE);
+    else
+      TripleDesCtrCrypt(*key, iv, in, out, size);
+    return true;
+  }
+
+  template <ChainMode Mode, typename Schedule>
+  bool Decrypt(const Schedule &key,
+               uint8_t *iv,
+               const uint8_t *in,
+               uint8_t *out,
+               size_t size) {
+    if constexpr (Mode == ECB)
+      TripleDesDecryptBlocks(*key, in, out, size / BLOCK_SIZE);
+    else if constexpr (Mode == CBC)
+      TripleDesCbcDecrypt(*key, iv, in, out, size / BLOCK_SIZE);
+    else
+      TripleDesCtrCrypt(*key, iv, in, out, size);
+    return true;
+  }
+
+  KeyCache<TripleDesKeySchedule> &key_cache() { return key_cache_; }
+private:
+  KeyCache<TripleDesKeySchedule> key_cache_;
+};
+
+// Backend for BlockCipher bound to the single key |FixedKey|, whose
+// schedule is expanded during compilation and read from .rodata: GetKey()
+// is a string compare, with no cache and no expansion at run time. Any
+// other key fails.
+//
+//   BlockCipher<FixedKeyDesBackend<"12345678">, ECB, PKCS5> cipher;
+template <FixedDesKey FixedKey>
+class FixedKeyDesBackend : public SoftDesBackend {
+public:
+  typedef const TripleDesKeySchedule *Key;
+
+  FixedKeyDesBackend() : SoftDesBackend(0) {}
+
+  Key GetKey(std::string_view key) {
+    if (key != std::string_view(FixedKey.chars, FixedKey.size()))
+      return nullptr;
+    return &FixedTripleDesKeySchedule<FixedKey>();
+  }
+};
+} //crypto
+
+#endif  //DES_SOFT_H_
\ No newline at end of file
@@ -0,0 +1,282 @@
+﻿#include "des_stream.h"
+#include <string.h>
+#include <algorithm>
+#include "parallel_ecb.h"
+
+namespace crypto {
+
+namespace {
+
+void CryptBulk(ParallelEcb *parallel,
+               const uint8_t (*round_keys)[8],
+               const uint8_t *in,
+               uint8_t *out,
+               size_t blocks) {
+  if (parallel)
+    parallel->CryptBlocks(round_keys, in, out, blocks);
+  else
+    TripleDesCryptBlocks(round_keys, in, out, blocks);
+}
+
+}  // namespace
+
+// A zero-capacity cache never keeps anything, so each Initialize() expands
+// the key afresh and the schedule dies with the object.
+Encryptor::Encryptor(Padding padding, KeyCache<TripleDesKeySchedule> *key_cache)
+    : padding_(padding),
+      parallel_(nullptr),
+      key_cache_(key_cache ? key_cache : &local_cache_),
+      local_cache_(0),
+      pending_size_(0) {}
+
+Encryptor::~Encryptor() {
+  SecureZero(pending_, sizeof(pending_));
+}
+
+bool Encryptor::Initialize(const std::string &key) {
+  SecureZero(pending_, sizeof(pending_));
+  pending_size_ = 0;
+  schedule_ = GetTripleDesKeySchedule(key_cache_, key);
+  return schedule_ != nullptr;
+}
+
+size_t Encryptor::UpdateOutputSize(size_t input_size) const {
+  return (pending_size_ + input_size) / DES_BLOCK_SIZE * DES_BLOCK_SIZE;
+}
+
+bool Encryptor::Update(std::span<const uint8_t> input,
+                       std::span<uint8_t> output,
+                       size_t *written) {
+  *written = 0;
+  if (!schedule_ || output.size() < UpdateOutputSize(input.size()))
+    return false;
+
+  const uint8_t *in = input.data();
+  size_t size = input.size();
+  uint8_t *out = output.data();
+  if (pending_size_ > 0) {
+    size_t take = std::min(size, DES_BLOCK_SIZE - pending_size_);
+    memcpy(pending_ + pending_size_, in, take);
+    pending_size_ += take;
+    in += take;
+    size -= take;
+    if (pending_size_ < DES_BLOCK_SIZE)
+      return true;
+    TripleDesEncryptBlocks(*schedule_, pending_, out, 1);
+    pending_size_ = 0;
+    out += DES_BLOCK_SIZE;
+  }
+
+  size_t blocks = size / DES_BLOCK_SIZE;
+  CryptBulk(parallel_, schedule_->encrypt, in, out, blocks);
+  out += blocks * DES_BLOCK_SIZE;
+  pending_size_ = size - blocks * DES_BLOCK_SIZE;
+  if (pending_size_ > 0)
+    memcpy(pending_, in + blocks * DES_BLOCK_SIZE, pending_size_);
+  *written = out - output.data();
+  return true;
+}
+
+bool Encryptor::Final(std::span<uint8_t> output, size_t *written) {
+  *written = 0;
+  if (!schedule_)
+    return false;
+
+  size_t padded_size = PaddedSize(padding_, pending_size_, DES_BLOCK_SIZE);
+  if (output.size() < padded_size)
+    return false;
+  if (padded_size > 0) {
+    ApplyPadding(padding_, pending_, pending_size_, padded_size);
+    TripleDesEncryptBlocks(*schedule_, pending_, output.data(), 1);
+  }
+  SecureZero(pending_, sizeof(pending_));
+  pending_size_ = 0;
+  schedule_.reset();
+  *written = padded_size;
+  return true;
+}
+
+Decryptor::Decryptor(Padding padding, KeyCache<TripleDesKeySchedule> *key_cache)
+    : padding_(padding),
+      parallel_(nullptr),
+      key_cache_(key_cache ? key_cache : &local_cache_),
+      local_cache_(0),
+      pending_size_(0),
+      zero_run_(0),
+      emitted_(false),
+      owed_zeros_(0),
+      held_offset_(0) {}
+
+Decryptor::~Decryptor() {
+  SecureZero(pending_, sizeof(pending_));
+  ClearBuffered();
+}
+
+bool Decryptor::Initialize(const std::string &key) {
+  SecureZero(pending_, sizeof(pending_));
+  pending_size_ = 0;
+  zero_run_ = 0;
+  emitted_ = false;
+  ClearBuffered();
+  schedule_ = GetTripleDesKeySchedule(key_cache_, key);
+  return schedule_ != nullptr;
+}
+
+// PKCS5 always leaves between 1 and 8 bytes in |pending_|. NOPKCS gets
+// one block more, so that a short run of zeros ending in this call still
+// goes out with the data behind it.
+size_t Decryptor::UpdateOutputSize(size_t input_size) const {
+  size_t available = pending_size_ + input_size;
+  if (padding_ == PKCS5)
+    return available == 0 ? 0 : (available - 1) / DES_BLOCK_SIZE * DES_BLOCK_SIZE;
+  return available / DES_BLOCK_SIZE * DES_BLOCK_SIZE + DES_BLOCK_SIZE;
+}
+
+bool Decryptor::Update(std::span<const uint8_t> input,
+                       std::span<uint8_t> output,
+                       size_t *written) {
+  *written = 0;
+  if (!schedule_ || buffered_size() > 0 ||
+      output.size() < UpdateOutputSize(input.size()))
+    return false;
+
+  size_t available = pending_size_ + input.size();
+  size_t blocks = available / DES_BLOCK_SIZE;
+  if (padding_ == PKCS5 && blocks * DES_BLOCK_SIZE == available && blocks > 0)
+    --blocks;
+
+  const uint8_t *in = input.data();
+  size_t consumed = 0;
+  if (blocks > 0) {
+    consumed = blocks * DES_BLOCK_SIZE - pending_size_;
+    DecryptBlocks(in, blocks, output.data());
+  }
+
+  size_t rest = input.size() - consumed;
+  memcpy(pending_ + pending_size_, in + consumed, rest);
+  pending_size_ += rest;
+
+  size_t size = blocks * DES_BLOCK_SIZE;
+  *written = padding_ == PKCS5
+      ? size
+      : EmitStripped(output.data(), size, UpdateOutputSize(input.size()));
+  return true;
+}
+
+bool Decryptor::Flush(std::span<uint8_t> output, size_t *written) {
+  *written = 0;
+  if (!schedule_)
+    return false;
+  *written = WriteBuffered(output.data(), output.size());
+  return true;
+}
+
+bool Decryptor::Final(std::span<uint8_t> output, size_t *written) {
+  *written = 0;
+  if (!schedule_ || buffered_size() > 0)
+    return false;
+
+  bool result = true;
+  if (padding_ == PKCS5) {
+    if (pending_size_ == DES_BLOCK_SIZE) {
+      uint8_t last[DES_BLOCK_SIZE];
+      TripleDesDecryptBlocks(*schedule_, pending_, last, 1);
+      size_t size = DES_BLOCK_SIZE - PaddingLength(padding_, last, DES_BLOCK_SIZE);
+      if (output.size() >= size) {
+        memcpy(output.data(), last, size);
+        *written = size;
+      } else {
+        result = false;
+      }
+      SecureZero(last, sizeof(last));
+    } else if (pending_size_ != 0) {
+      result = false;
+    }
+  } else {
+    if (pending_size_ != 0) {
+      result = false;
+    } else if (!emitted_ && zero_run_ > 0) {
+      // An all-zero message keeps its first byte.
+      if (output.empty()) {
+        result = false;
+      } else {
+        output[0] = 0;
+        *written = 1;
+      }
+    }
+  }
+
+  SecureZero(pending_, sizeof(pending_));
+  pending_size_ = 0;
+  zero_run_ = 0;
+  emitted_ = false;
+  schedule_.reset();
+  return result;
+}
+
+void Decryptor::DecryptBlocks(const uint8_t *input, size_t blocks, uint8_t *out) {
+  if (pending_size_ > 0) {
+    size_t take = DES_BLOCK_SIZE - pending_size_;
+    memcpy(pending_ + pending_size_, input, take);
+    TripleDesDecryptBlocks(*schedule_, pending_, out, 1);
+    input += take;
+    out += DES_BLOCK_SIZE;
+    --blocks;
+    pending_size_ = 0;
+  }
+  CryptBulk(parallel_, schedule_->decrypt, input, out, blocks);
+}
+
+size_t Decryptor::EmitStripped(uint8_t *out, size_t size, size_t capacity) {
+  size_t last = size;
+  while (last > 0 && out[last - 1] == 0)
+    --last;
+  if (last == 0) {
+    zero_run_ += size;
+    return 0;
+  }
+
+  size_t zeros = zero_run_;
+  zero_run_ = size - last;
+  emitted_ = true;
+  if (zeros <= capacity - last) {
+    if (zeros > 0) {
+      memmove(out + zeros, out, last);
+      memset(out, 0, zeros);
+    }
+    return zeros + last;
+  }
+
+  // The zeros do not fit in front of the data: keep the data until
+  // Flush() has written them.
+  owed_zeros_ = zeros;
+  held_.assign(out, out + last);
+  held_offset_ = 0;
+  SecureZero(out, last);
+  return WriteBuffered(out, capacity);
+}
+
+size_t Decryptor::WriteBuffered(uint8_t *out, size_t capacity) {
+  size_t zeros = std::min(owed_zeros_, capacity);
+  memset(out, 0, zeros);
+  owed_zeros_ -= zeros;
+
+  size_t size = std::min(held_.size() - held_offset_, capacity - zeros);
+  if (size > 0) {
+    memcpy(out + zeros, held_.data() + held_offset_, size);
+    held_offset_ += size;
+  }
+  if (owed_zeros_ == 0 && held_offset_ == held_.size())
+    ClearBuffered();
+  return zeros + size;
+}
+
+void Decryptor::ClearBuffered() {
+  if (!held_.empty())
+    SecureZero(held_.data(), held_.size());
+  held_.clear();
+  held_offset_ = 0;
+  owed_zeros_ = 0;
+}
+
+} //crypto
\ No newline at end of file
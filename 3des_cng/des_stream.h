@@ -0,0 +1,131 @@
+﻿#ifndef DES_STREAM_H_
+#define DES_STREAM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <span>
+#include <string>
+#include <vector>
+#include "des_engine.h"
+#include "key_cache.h"
+#include "padding.h"
+
+namespace crypto {
+
+class ParallelEcb;
+
+// Incremental 3DES ECB encryption. Update() consumes any amount of input
+// and emits the whole blocks it can, carrying a partial block over to the
+// next call; Final() pads and emits the last block. The concatenated
+// output equals Crypto3DesSoft::DoEncrypt() of the concatenated input, and
+// memory use does not depend on the message size.
+class Encryptor {
+public:
+  // Schedules are looked up in |key_cache| when given, otherwise expanded
+  // for this object alone.
+  explicit Encryptor(Padding padding,
+                     KeyCache<TripleDesKeySchedule> *key_cache = nullptr);
+
+  virtual ~Encryptor();
+
+  // Starts a new message; may be called again to reuse the object.
+  bool Initialize(const std::string &key);
+
+  // Upper bound of what Update(|input_size| bytes) writes.
+  size_t UpdateOutputSize(size_t input_size) const;
+
+  bool Update(std::span<const uint8_t> input,
+              std::span<uint8_t> output,
+              size_t *written);
+
+  // |output| must hold DES_BLOCK_SIZE bytes. Ends the message.
+  bool Final(std::span<uint8_t> output, size_t *written);
+
+  // Runs the whole blocks of each Update() on |parallel|'s threads.
+  void set_parallel(ParallelEcb *parallel) { parallel_ = parallel; }
+private:
+  Padding padding_;
+  ParallelEcb *parallel_;
+  KeyCache<TripleDesKeySchedule> *key_cache_;
+  KeyCache<TripleDesKeySchedule> local_cache_;
+  KeyCache<TripleDesKeySchedule>::Entry schedule_;
+  uint8_t pending_[DES_BLOCK_SIZE];
+  size_t pending_size_;
+};
+
+// Incremental counterpart of Crypto3DesSoft::DoDecrypt(). With PKCS5 the
+// last ciphertext block is held back until Final() so the padding can be
+// stripped. With NOPKCS trailing zero bytes are only counted, not
+// buffered, and written out once non-zero data follows them. Update()
+// never writes more than UpdateOutputSize(), so when a long run of zeros
+// ends, what does not fit is kept back: the zeros as a count, the data
+// after them (at most one Update()'s worth) as bytes. Call Flush() until
+// buffered_size() is 0 before the next Update() or Final(). Zeros still
+// counted at Final() are padding and dropped.
+//
+// A PKCS5 pad byte larger than the block size leaves the last block
+// untouched; the one-shot API would strip that many bytes across blocks,
+// which no valid padding produces.
+class Decryptor {
+public:
+  explicit Decryptor(Padding padding,
+                     KeyCache<TripleDesKeySchedule> *key_cache = nullptr);
+
+  virtual ~Decryptor();
+
+  bool Initialize(const std::string &key);
+
+  size_t UpdateOutputSize(size_t input_size) const;
+
+  // Fails while buffered_size() is not 0.
+  bool Update(std::span<const uint8_t> input,
+              std::span<uint8_t> output,
+              size_t *written);
+
+  // Plaintext Update() produced but could not write yet; NOPKCS only.
+  size_t buffered_size() const {
+    return owed_zeros_ + held_.size() - held_offset_;
+  }
+
+  // Writes as much of the buffered plaintext as fits in |output|.
+  bool Flush(std::span<uint8_t> output, size_t *written);
+
+  // |output| must hold DES_BLOCK_SIZE bytes. Fails if the ciphertext was
+  // not a whole number of blocks, or while buffered_size() is not 0.
+  bool Final(std::span<uint8_t> output, size_t *written);
+
+  void set_parallel(ParallelEcb *parallel) { parallel_ = parallel; }
+private:
+  // Decrypts |blocks| blocks, the first |pending_size_| bytes of which come
+  // from |pending_|, into |out|.
+  void DecryptBlocks(const uint8_t *input, size_t blocks, uint8_t *out);
+
+  // Applies the NOPKCS zero-run tracking to |size| freshly decrypted bytes
+  // at |out|, which has room for |capacity| bytes in all.
+  size_t EmitStripped(uint8_t *out, size_t size, size_t capacity);
+
+  // Writes up to |capacity| bytes of owed zeros, then held data, to |out|.
+  size_t WriteBuffered(uint8_t *out, size_t capacity);
+
+  void ClearBuffered();
+
+  Padding padding_;
+  ParallelEcb *parallel_;
+  KeyCache<TripleDesKeySchedule> *key_cache_;
+  KeyCache<TripleDesKeySchedule> local_cache_;
+  KeyCache<TripleDesKeySchedule>::Entry schedule_;
+  uint8_t pending_[DES_BLOCK_SIZE];
+  size_t pending_size_;
+  // NOPKCS: trailing decrypted zero bytes not yet written, and whether
+  // anything was.
+  size_t zero_run_;
+  bool emitted_;
+  // NOPKCS: zeros known to be followed by data, and that data, waiting
+  // for Flush().
+  size_t owed_zeros_;
+  std::vector<uint8_t> held_;
+  size_t held_offset_;
+};
+} //crypto
+
+#endif  //DES_STREAM_H_
\ No newline at end of file
@@ -0,0 +1,109 @@
+﻿// Checks that streaming Decryptor output matches Crypto3DesSoft::DoDecrypt()
+// and that NOPKCS output buffers stay bounded by the input chunk across
+// long runs of zeros. Exits non-zero on the first mismatch.
+//
+// Linux:
+//   g++ -std=c++20 -O2 -pthread des_stream_test.cc des_engine.cc des_soft.cc
+//       des_stream.cc des_bitslice.cc des_bitslice_sse2.cc
+//       des_bitslice_avx2.cc des_bitslice_avx512.cc chain_mode.cc
+//       cpu_features.cc padding.cc parallel_ecb.cc -o des_stream_test
+
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <span>
+#include <string>
+#include <vector>
+#include "des_soft.h"
+#include "des_stream.h"
+
+namespace {
+
+using crypto::Crypto3DesSoft;
+using crypto::Decryptor;
+using crypto::DES_BLOCK_SIZE;
+using crypto::Padding;
+
+const char KEY[] = "0123456789abcdefghijklmn";
+const size_t CHUNK_SIZE = 64 * 1024;
+
+bool Check(bool condition, const char *what) {
+  if (!condition)
+    fprintf(stderr, "FAILED: %s\n", what);
+  return condition;
+}
+
+// Decrypts |ciphertext| CHUNK_SIZE bytes at a time into buffers of
+// UpdateOutputSize() + DES_BLOCK_SIZE bytes, flushing into CHUNK_SIZE
+// buffers, and records the largest buffer it needed.
+bool StreamDecrypt(Padding padding,
+                   const std::string &ciphertext,
+                   std::string *plaintext,
+                   size_t *max_buffer) {
+  Decryptor stream(padding);
+  if (!stream.Initialize(KEY))
+    return false;
+  plaintext->clear();
+  *max_buffer = 0;
+  std::vector<uint8_t> buffer;
+  size_t written = 0;
+  for (size_t offset = 0; offset < ciphertext.size(); offset += CHUNK_SIZE) {
+    size_t size = std::min(CHUNK_SIZE, ciphertext.size() - offset);
+    buffer.resize(stream.UpdateOutputSize(size));
+    *max_buffer = std::max(*max_buffer, buffer.size());
+    std::span<const uint8_t> in(
+        reinterpret_cast<const uint8_t *>(ciphertext.data()) + offset, size);
+    if (!stream.Update(in, std::span<uint8_t>(buffer), &written))
+      return false;
+    plaintext->append(reinterpret_cast<char *>(buffer.data()), written);
+    while (stream.buffered_size() > 0) {
+      buffer.resize(CHUNK_SIZE);
+      if (!stream.Flush(std::span<uint8_t>(buffer), &written) || written == 0)
+        return false;
+      plaintext->append(reinterpret_cast<char *>(buffer.data()), written);
+    }
+  }
+  buffer.resize(DES_BLOCK_SIZE);
+  if (!stream.Final(std::span<uint8_t>(buffer), &written))
+    return false;
+  plaintext->append(reinterpret_cast<char *>(buffer.data()), written);
+  return true;
+}
+
+bool RunCase(Padding padding, const char *name, const std::string &message) {
+  Crypto3DesSoft cipher(padding);
+  std::string ciphertext, expected, actual;
+  if (!Check(cipher.Initialize() &&
+                 cipher.DoEncrypt(KEY, message, &ciphertext) &&
+                 cipher.DoDecrypt(KEY, ciphertext, &expected),
+             name))
+    return false;
+
+  size_t max_buffer = 0;
+  bool ok = Check(StreamDecrypt(padding, ciphertext, &actual, &max_buffer),
+                  name) &&
+            Check(actual == expected, name) &&
+            Check(max_buffer <= CHUNK_SIZE + DES_BLOCK_SIZE, name);
+  printf("%-28s %10zu bytes, largest update buffer %zu\n", name,
+         message.size(), max_buffer);
+  return ok;
+}
+
+}  // namespace
+
+int main() {
+  const size_t RUN = 64 * 1024 * 1024;
+  std::string zeros(RUN, '\0');
+  std::string data = "leading data";
+
+  bool ok = true;
+  ok &= RunCase(crypto::NOPKCS, "nopkcs zeros then data", zeros + data);
+  ok &= RunCase(crypto::NOPKCS, "nopkcs data, zeros, data",
+                data + zeros + data + zeros);
+  ok &= RunCase(crypto::NOPKCS, "nopkcs all zeros", zeros);
+  ok &= RunCase(crypto::NOPKCS, "nopkcs short zero runs",
+                data + std::string(13, '\0') + data + std::string(5, '\0'));
+  ok &= RunCase(crypto::PKCS5, "pkcs5 zeros then data", zeros + data);
+  printf("%s\n", ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
\ No newline at end of file
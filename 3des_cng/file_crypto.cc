@@ -0,0 +1,367 @@
+﻿#include "file_crypto.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "des_stream.h"
+#include "mapped_file.h"
+#if defined(_WIN32)
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace crypto {
+
+namespace {
+
+const char STANDARD_STREAM[] = "-";
+
+#if defined(_WIN32)
+int OpenInput(const std::string &path) {
+  if (path == STANDARD_STREAM) {
+    _setmode(_fileno(stdin), _O_BINARY);
+    return _fileno(stdin);
+  }
+  return _open(path.c_str(), _O_RDONLY | _O_BINARY);
+}
+
+int OpenOutput(const std::string &path) {
+  if (path == STANDARD_STREAM) {
+    _setmode(_fileno(stdout), _O_BINARY);
+    return _fileno(stdout);
+  }
+  return _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY,
+               _S_IREAD | _S_IWRITE);
+}
+
+int ReadSome(int fd, uint8_t *data, size_t size) {
+  return _read(fd, data, static_cast<unsigned int>(size));
+}
+
+int WriteSome(int fd, const uint8_t *data, size_t size) {
+  return _write(fd, data, static_cast<unsigned int>(size));
+}
+
+void CloseFile(int fd) {
+  _close(fd);
+}
+
+bool GetFileId(const std::string &path, BY_HANDLE_FILE_INFORMATION *info) {
+  HANDLE file = CreateFileA(path.c_str(), 0,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                            nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+  bool result = GetFileInformationByHandle(file, info) != 0;
+  CloseHandle(file);
+  return result;
+}
+
+bool SameFile(const std::string &a, const std::string &b) {
+  BY_HANDLE_FILE_INFORMATION info_a, info_b;
+  return GetFileId(a, &info_a) && GetFileId(b, &info_b) &&
+         info_a.dwVolumeSerialNumber == info_b.dwVolumeSerialNumber &&
+         info_a.nFileIndexHigh == info_b.nFileIndexHigh &&
+         info_a.nFileIndexLow == info_b.nFileIndexLow;
+}
+#else
+int OpenInput(const std::string &path) {
+  if (path == STANDARD_STREAM)
+    return STDIN_FILENO;
+  return open(path.c_str(), O_RDONLY);
+}
+
+int OpenOutput(const std::string &path) {
+  if (path == STANDARD_STREAM)
+    return STDOUT_FILENO;
+  return open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+}
+
+ssize_t ReadSome(int fd, uint8_t *data, size_t size) {
+  return read(fd, data, size);
+}
+
+ssize_t WriteSome(int fd, const uint8_t *data, size_t size) {
+  return write(fd, data, size);
+}
+
+void CloseFile(int fd) {
+  close(fd);
+}
+
+bool SameFile(const std::string &a, const std::string &b) {
+  struct stat st_a, st_b;
+  return stat(a.c_str(), &st_a) == 0 && stat(b.c_str(), &st_b) == 0 &&
+         st_a.st_dev == st_b.st_dev && st_a.st_ino == st_b.st_ino;
+}
+#endif
+
+// Fills |size| bytes unless the input ends first; pipes return short reads.
+bool ReadFully(int fd, uint8_t *data, size_t size, size_t *read) {
+  *read = 0;
+  while (*read < size) {
+    auto result = ReadSome(fd, data + *read, size - *read);
+    if (result < 0 && errno == EINTR)
+      continue;
+    if (result < 0)
+      return false;
+    if (result == 0)
+      break;
+    *read += static_cast<size_t>(result);
+  }
+  return true;
+}
+
+bool WriteFully(int fd, const uint8_t *data, size_t size) {
+  while (size > 0) {
+    auto result = WriteSome(fd, data, size);
+    if (result < 0 && errno == EINTR)
+      continue;
+    if (result <= 0)
+      return false;
+    data += result;
+    size -= static_cast<size_t>(result);
+  }
+  return true;
+}
+
+struct Chunk {
+  std::vector<uint8_t> data;
+  size_t size;
+  bool last;
+  bool ok;
+};
+
+// Hands chunks from one pipeline stage to the next.
+class ChunkQueue {
+public:
+  void Push(Chunk *chunk) {
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      chunks_.push_back(chunk);
+    }
+    ready_.notify_one();
+  }
+
+  Chunk *Pop() {
+    std::unique_lock<std::mutex> lock(lock_);
+    ready_.wait(lock, [this] { return !chunks_.empty(); });
+    Chunk *chunk = chunks_.front();
+    chunks_.pop_front();
+    return chunk;
+  }
+private:
+  std::mutex lock_;
+  std::condition_variable ready_;
+  std::deque<Chunk *> chunks_;
+};
+
+// Two input and two output chunks circulate: while the calling thread
+// encrypts chunk n, the reader fills chunk n + 1 and the writer drains
+// chunk n - 1.
+template <typename Stream>
+bool RunPipeline(Stream *stream, int in, int out, size_t chunk_size) {
+  const int BUFFERS = 2;
+  Chunk inputs[BUFFERS], outputs[BUFFERS];
+  ChunkQueue free_inputs, full_inputs, free_outputs, full_outputs;
+  for (int i = 0; i < BUFFERS; i++) {
+    inputs[i].data.resize(chunk_size);
+    free_inputs.Push(&inputs[i]);
+    free_outputs.Push(&outputs[i]);
+  }
+
+  std::thread reader([&] {
+    for (;;) {
+      Chunk *chunk = free_inputs.Pop();
+      chunk->ok = ReadFully(in, chunk->data.data(), chunk_size, &chunk->size);
+      chunk->last = !chunk->ok || chunk->size < chunk_size;
+      full_inputs.Push(chunk);
+      if (chunk->last)
+        break;
+    }
+  });
+
+  bool write_ok = true;
+  std::thread writer([&] {
+    for (;;) {
+      Chunk *chunk = full_outputs.Pop();
+      if (write_ok && chunk->size > 0)
+        write_ok = WriteFully(out, chunk->data.data(), chunk->size);
+      bool last = chunk->last;
+      free_outputs.Push(chunk);
+      if (last)
+        break;
+    }
+  });
+
+  bool result = true;
+  for (;;) {
+    Chunk *input = full_inputs.Pop();
+    Chunk *output = free_outputs.Pop();
+    // Room for this chunk's blocks plus whatever Final() adds.
+    output->data.resize(stream->UpdateOutputSize(input->size) + DES_BLOCK_SIZE);
+    output->size = 0;
+    output->last = false;
+
+    size_t written = 0;
+    if (result && input->ok &&
+        stream->Update(std::span<const uint8_t>(input->data.data(), input->size),
+                       std::span<uint8_t>(output->data), &written)) {
+      output->size = written;
+      // Plaintext a decryptor held back behind a long run of zeros goes
+      // out in further chunks of at most |chunk_size| bytes.
+      if constexpr (std::is_same_v<Stream, Decryptor>) {
+        while (result && stream->buffered_size() > 0) {
+          full_outputs.Push(output);
+          output = free_outputs.Pop();
+          output->data.resize(chunk_size + DES_BLOCK_SIZE);
+          output->last = false;
+          result = stream->Flush(
+              std::span<uint8_t>(output->data.data(), chunk_size), &written);
+          output->size = written;
+        }
+      }
+      if (result && input->last) {
+        result = stream->Final(std::span<uint8_t>(output->data).subspan(output->size),
+                               &written);
+        output->size += written;
+      }
+    } else {
+      result = false;
+    }
+
+    bool last = input->last;
+    output->last = last;
+    full_outputs.Push(output);
+    free_inputs.Push(input);
+    if (last)
+      break;
+  }
+
+  reader.join();
+  writer.join();
+  return result && write_ok;
+}
+
+}  // namespace
+
+FileCrypto::FileCrypto(Padding padding, size_t threads, size_t chunk_size)
+    : padding_(padding),
+      chunk_size_(chunk_size / DES_BLOCK_SIZE * DES_BLOCK_SIZE),
+      cipher_(padding, threads) {
+  if (chunk_size_ == 0)
+    chunk_size_ = DEFAULT_FILE_CHUNK_SIZE;
+}
+
+FileCrypto::~FileCrypto() {
+}
+
+bool FileCrypto::Initialize() {
+  return cipher_.Initialize();
+}
+
+bool FileCrypto::EncryptFile(const std::string &key,
+                             const std::string &input_path,
+                             const std::string &output_path) {
+  return CryptFile(true, key, input_path, output_path);
+}
+
+bool FileCrypto::DecryptFile(const std::string &key,
+                             const std::string &input_path,
+                             const std::string &output_path) {
+  return CryptFile(false, key, input_path, output_path);
+}
+
+// Mapping needs a regular file on both sides; an output that does not
+// exist yet will be one.
+bool FileCrypto::CryptFile(bool encrypt,
+                           const std::string &key,
+                           const std::string &input_path,
+                           const std::string &output_path) {
+  // Opening the output truncates it, which would destroy an input that is
+  // the same file under another path, a symlink or a hard link; compared
+  // by identity before either is opened.
+  if (input_path != STANDARD_STREAM && output_path != STANDARD_STREAM &&
+      (input_path == output_path || SameFile(input_path, output_path)))
+    return false;
+
+  bool mappable = input_path != STANDARD_STREAM &&
+                  output_path != STANDARD_STREAM &&
+                  MappedFile::IsRegularFile(input_path);
+  if (mappable) {
+    FILE *existing = fopen(output_path.c_str(), "rb");
+    if (existing) {
+      fclose(existing);
+      mappable = MappedFile::IsRegularFile(output_path);
+    }
+  }
+  if (mappable)
+    return CryptMapped(encrypt, key, input_path, output_path);
+  return CryptStream(encrypt, key, input_path, output_path);
+}
+
+bool FileCrypto::CryptMapped(bool encrypt,
+                             const std::string &key,
+                             const std::string &input_path,
+                             const std::string &output_path) {
+  MappedFile input;
+  if (!input.OpenForRead(input_path))
+    return false;
+
+  size_t output_size = encrypt ? cipher_.RequiredOutputSize(input.size())
+                               : input.size();
+  MappedFile output;
+  if (!output.CreateForWrite(output_path, output_size))
+    return false;
+
+  std::span<const uint8_t> in(input.data(), input.size());
+  std::span<uint8_t> out(output.data(), output_size);
+  size_t written = 0;
+  bool result = encrypt ? cipher_.DoEncrypt(key, in, out, &written)
+                        : cipher_.DoDecrypt(key, in, out, &written);
+  return output.Close(written) && result;
+}
+
+bool FileCrypto::CryptStream(bool encrypt,
+                             const std::string &key,
+                             const std::string &input_path,
+                             const std::string &output_path) {
+  int in = OpenInput(input_path);
+  if (in < 0)
+    return false;
+  int out = OpenOutput(output_path);
+  if (out < 0) {
+    if (input_path != STANDARD_STREAM)
+      CloseFile(in);
+    return false;
+  }
+
+  bool result;
+  if (encrypt) {
+    Encryptor stream(padding_, &cipher_.key_cache());
+    stream.set_parallel(&cipher_);
+    result = stream.Initialize(key) && RunPipeline(&stream, in, out, chunk_size_);
+  } else {
+    Decryptor stream(padding_, &cipher_.key_cache());
+    stream.set_parallel(&cipher_);
+    result = stream.Initialize(key) && RunPipeline(&stream, in, out, chunk_size_);
+  }
+
+  if (input_path != STANDARD_STREAM)
+    CloseFile(in);
+  if (output_path != STANDARD_STREAM)
+    CloseFile(out);
+  return result;
+}
+
+} //crypto
\ No newline at end of file
@@ -0,0 +1,58 @@
+﻿#ifndef FILE_CRYPTO_H_
+#define FILE_CRYPTO_H_
+
+#include <stddef.h>
+#include <string>
+#include "padding.h"
+#include "parallel_ecb.h"
+
+namespace crypto {
+
+const size_t DEFAULT_FILE_CHUNK_SIZE = 4 * 1024 * 1024;
+
+// 3DES ECB over whole files. A regular input file is mapped and encrypted
+// straight into a preallocated, mapped output file, with the blocks spread
+// over ParallelEcb's threads. Pipes and "-" (stdin/stdout) go through a
+// double-buffered pipeline instead: one thread reads the next chunk and
+// another writes the previous one while the current chunk is encrypted.
+// Either way the output equals DoEncrypt()/DoDecrypt() of the whole file.
+class FileCrypto {
+public:
+  explicit FileCrypto(Padding padding,
+                      size_t threads = 0,
+                      size_t chunk_size = DEFAULT_FILE_CHUNK_SIZE);
+
+  virtual ~FileCrypto();
+
+  bool Initialize();
+
+  bool EncryptFile(const std::string &key,
+                   const std::string &input_path,
+                   const std::string &output_path);
+
+  bool DecryptFile(const std::string &key,
+                   const std::string &input_path,
+                   const std::string &output_path);
+private:
+  bool CryptFile(bool encrypt,
+                 const std::string &key,
+                 const std::string &input_path,
+                 const std::string &output_path);
+
+  bool CryptMapped(bool encrypt,
+                   const std::string &key,
+                   const std::string &input_path,
+                   const std::string &output_path);
+
+  bool CryptStream(bool encrypt,
+                   const std::string &key,
+                   const std::string &input_path,
+                   const std::string &output_path);
+
+  Padding padding_;
+  size_t chunk_size_;
+  ParallelEcb cipher_;
+};
+} //crypto
+
+#endif  //FILE_CRYPTO_H_
\ No newline at end of file
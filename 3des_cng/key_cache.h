@@ -0,0 +1,149 @@
+﻿#ifndef KEY_CACHE_H_
+#define KEY_CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace crypto {
+
+const size_t DEFAULT_KEY_CACHE_CAPACITY = 512;
+
+// memset() that the optimizer is not allowed to drop: called through a
+// volatile pointer, so it cannot be proven dead, yet still runs at memset
+// speed on the large key scratch buffers.
+inline void SecureZero(void *data, size_t size) {
+  static void *(*const volatile secure_memset)(void *, int, size_t) = memset;
+  secure_memset(data, 0, size);
+}
+
+// Bounded, thread-safe LRU of expanded keys (schedules or backend key
+// handles) indexed by the padded key bytes. Entries are handed out as
+// shared_ptr so an evicted key stays valid for callers still using it; the
+// deleter given by the factory is responsible for wiping or destroying it.
+// The cached copy of the key bytes is zeroed when the entry goes away.
+template <typename T>
+class KeyCache {
+public:
+  typedef std::shared_ptr<T> Entry;
+
+  explicit KeyCache(size_t capacity = DEFAULT_KEY_CACHE_CAPACITY)
+      : capacity_(capacity), hits_(0), misses_(0), evictions_(0) {}
+
+  ~KeyCache() {
+    Clear();
+  }
+
+  // Returns the entry for |key|, calling |create(key)| on a miss. |create|
+  // runs without the lock held and may return null to signal failure.
+  // A hit neither allocates nor copies |key|.
+  template <typename Factory>
+  Entry Get(std::string_view key, Factory create) {
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      Entry entry = FindLocked(key);
+      if (entry) {
+        ++hits_;
+        return entry;
+      }
+      ++misses_;
+    }
+
+    Entry entry = create(key);
+    if (!entry)
+      return entry;
+
+    std::lock_guard<std::mutex> lock(lock_);
+    Entry raced = FindLocked(key);
+    if (raced)
+      return raced;
+    if (capacity_ == 0)
+      return entry;
+    lru_.push_front(Node());
+    lru_.front().key = key;
+    lru_.front().value = entry;
+    index_[lru_.front().key] = lru_.begin();
+    TrimLocked(capacity_);
+    return entry;
+  }
+
+  void SetCapacity(size_t capacity) {
+    std::lock_guard<std::mutex> lock(lock_);
+    capacity_ = capacity;
+    TrimLocked(capacity_);
+  }
+
+  void Clear() {
+    std::lock_guard<std::mutex> lock(lock_);
+    TrimLocked(0);
+  }
+
+  size_t capacity() const {
+    std::lock_guard<std::mutex> lock(lock_);
+    return capacity_;
+  }
+
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(lock_);
+    return lru_.size();
+  }
+
+  uint64_t hits() const {
+    std::lock_guard<std::mutex> lock(lock_);
+    return hits_;
+  }
+
+  uint64_t misses() const {
+    std::lock_guard<std::mutex> lock(lock_);
+    return misses_;
+  }
+
+  uint64_t evictions() const {
+    std::lock_guard<std::mutex> lock(lock_);
+    return evictions_;
+  }
+
+private:
+  struct Node {
+    std::string key;
+    Entry value;
+  };
+  typedef typename std::list<Node>::iterator Iterator;
+
+  Entry FindLocked(std::string_view key) {
+    auto it = index_.find(key);
+    if (it == index_.end())
+      return Entry();
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->value;
+  }
+
+  void TrimLocked(size_t capacity) {
+    while (lru_.size() > capacity) {
+      Node &node = lru_.back();
+      index_.erase(node.key);
+      SecureZero(&node.key[0], node.key.size());
+      lru_.pop_back();
+      ++evictions_;
+    }
+  }
+
+  mutable std::mutex lock_;
+  size_t capacity_;
+  std::list<Node> lru_;
+  // Views into the list nodes, so each key is stored only once.
+  std::unordered_map<std::string_view, Iterator> index_;
+  uint64_t hits_;
+  uint64_t misses_;
+  uint64_t evictions_;
+};
+} //crypto
+
+#endif  //KEY_CACHE_H_
\ No newline at end of file
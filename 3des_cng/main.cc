@@ -1,11 +1,71 @@
-﻿#include "des.h"
+﻿#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include "file_crypto.h"
+
+namespace {
+
+void Usage(const char *program) {
+  fprintf(stderr,
+          "usage: %s (-e | -d) -k KEY [-p pkcs5|nopkcs] [-t THREADS] INPUT OUTPUT\n"
+          "  3DES ECB encrypts (-e) or decrypts (-d) INPUT into OUTPUT.\n"
+          "  Either may be - for stdin/stdout. Regular files are memory\n"
+          "  mapped; pipes are streamed. THREADS defaults to all cores.\n",
+          program);
+}
+
+}  // namespace
 
 int main(int argc, char *argv[]) {
-  crypto::Crypto3DesCNG des(crypto::PKCS5);
-  des.Initialize();
-  std::string plaintext = "this is a test!";
-  std::string ciphertext;
-  des.DoEncrypt("12345678", plaintext, &ciphertext);
-  des.DoDecrypt("12345678", ciphertext, &plaintext);
+  int mode = 0;
+  std::string key;
+  crypto::Padding padding = crypto::PKCS5;
+  size_t threads = 0;
+  const char *paths[2] = {nullptr, nullptr};
+  int path_count = 0;
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    if (strcmp(arg, "-e") == 0 || strcmp(arg, "-d") == 0) {
+      mode = arg[1];
+    } else if (strcmp(arg, "-k") == 0 && i + 1 < argc) {
+      key = argv[++i];
+    } else if (strcmp(arg, "-p") == 0 && i + 1 < argc) {
+      const char *name = argv[++i];
+      if (strcmp(name, "pkcs5") == 0) {
+        padding = crypto::PKCS5;
+      } else if (strcmp(name, "nopkcs") == 0) {
+        padding = crypto::NOPKCS;
+      } else {
+        Usage(argv[0]);
+        return 2;
+      }
+    } else if (strcmp(arg, "-t") == 0 && i + 1 < argc) {
+      threads = strtoul(argv[++i], nullptr, 10);
+    } else if (path_count < 2 && (arg[0] != '-' || arg[1] == '\0')) {
+      paths[path_count++] = arg;
+    } else {
+      Usage(argv[0]);
+      return 2;
+    }
+  }
+  if (mode == 0 || key.empty() || path_count != 2) {
+    Usage(argv[0]);
+    return 2;
+  }
+
+  crypto::FileCrypto file_crypto(padding, threads);
+  if (!file_crypto.Initialize()) {
+    fprintf(stderr, "failed to start worker threads\n");
+    return 1;
+  }
+  bool result = mode == 'e'
+      ? file_crypto.EncryptFile(key, paths[0], paths[1])
+      : file_crypto.DecryptFile(key, paths[0], paths[1]);
+  if (!result) {
+    fprintf(stderr, "%s failed\n", mode == 'e' ? "encryption" : "decryption");
+    return 1;
+  }
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,171 @@
+﻿#include "mapped_file.h"
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace crypto {
+
+#if defined(_WIN32)
+
+MappedFile::MappedFile()
+    : data_(nullptr),
+      size_(0),
+      writable_(false),
+      file_(INVALID_HANDLE_VALUE),
+      mapping_(nullptr) {}
+
+bool MappedFile::IsRegularFile(const std::string &path) {
+  DWORD attributes = GetFileAttributesA(path.c_str());
+  return attributes != INVALID_FILE_ATTRIBUTES &&
+         !(attributes & FILE_ATTRIBUTE_DIRECTORY);
+}
+
+bool MappedFile::OpenForRead(const std::string &path) {
+  file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                      OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file_ == INVALID_HANDLE_VALUE || GetFileType(file_) != FILE_TYPE_DISK)
+    return false;
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file_, &size))
+    return false;
+  size_ = static_cast<size_t>(size.QuadPart);
+  return Map(false);
+}
+
+bool MappedFile::CreateForWrite(const std::string &path, size_t size) {
+  file_ = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+                      CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file_ == INVALID_HANDLE_VALUE)
+    return false;
+  LARGE_INTEGER end;
+  end.QuadPart = static_cast<LONGLONG>(size);
+  if (!SetFilePointerEx(file_, end, nullptr, FILE_BEGIN) || !SetEndOfFile(file_))
+    return false;
+  size_ = size;
+  return Map(true);
+}
+
+bool MappedFile::Map(bool writable) {
+  writable_ = writable;
+  if (size_ == 0)
+    return true;
+  mapping_ = CreateFileMappingA(file_, nullptr,
+                                writable ? PAGE_READWRITE : PAGE_READONLY,
+                                0, 0, nullptr);
+  if (!mapping_)
+    return false;
+  data_ = static_cast<uint8_t *>(MapViewOfFile(
+      mapping_, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0));
+  return data_ != nullptr;
+}
+
+bool MappedFile::Close(size_t final_size) {
+  bool result = true;
+  if (data_) {
+    UnmapViewOfFile(data_);
+    data_ = nullptr;
+  }
+  if (mapping_) {
+    CloseHandle(mapping_);
+    mapping_ = nullptr;
+  }
+  if (file_ != INVALID_HANDLE_VALUE) {
+    if (writable_) {
+      LARGE_INTEGER end;
+      end.QuadPart = static_cast<LONGLONG>(final_size);
+      result = SetFilePointerEx(file_, end, nullptr, FILE_BEGIN) &&
+               SetEndOfFile(file_);
+    }
+    CloseHandle(file_);
+    file_ = INVALID_HANDLE_VALUE;
+  }
+  size_ = 0;
+  return result;
+}
+
+#else
+
+MappedFile::MappedFile()
+    : data_(nullptr),
+      size_(0),
+      writable_(false),
+      fd_(-1) {}
+
+bool MappedFile::IsRegularFile(const std::string &path) {
+  struct stat st;
+  return stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+}
+
+bool MappedFile::OpenForRead(const std::string &path) {
+  fd_ = open(path.c_str(), O_RDONLY);
+  if (fd_ < 0)
+    return false;
+  struct stat st;
+  if (fstat(fd_, &st) != 0 || !S_ISREG(st.st_mode))
+    return false;
+  size_ = static_cast<size_t>(st.st_size);
+  if (!Map(false))
+    return false;
+  if (data_)
+    madvise(data_, size_, MADV_SEQUENTIAL);
+  return true;
+}
+
+bool MappedFile::CreateForWrite(const std::string &path, size_t size) {
+  fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0)
+    return false;
+  // Reserve the blocks up front so the writes through the mapping never
+  // hit ENOSPC as SIGBUS; fall back to a sparse file where unsupported.
+#if defined(__linux__)
+  if (size > 0 && posix_fallocate(fd_, 0, static_cast<off_t>(size)) != 0 &&
+      ftruncate(fd_, static_cast<off_t>(size)) != 0)
+    return false;
+#else
+  if (ftruncate(fd_, static_cast<off_t>(size)) != 0)
+    return false;
+#endif
+  size_ = size;
+  return Map(true);
+}
+
+bool MappedFile::Map(bool writable) {
+  writable_ = writable;
+  if (size_ == 0)
+    return true;
+  void *data = mmap(nullptr, size_,
+                    writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                    MAP_SHARED, fd_, 0);
+  if (data == MAP_FAILED)
+    return false;
+  data_ = static_cast<uint8_t *>(data);
+  return true;
+}
+
+bool MappedFile::Close(size_t final_size) {
+  bool result = true;
+  if (data_) {
+    munmap(data_, size_);
+    data_ = nullptr;
+  }
+  if (fd_ >= 0) {
+    if (writable_ && ftruncate(fd_, static_cast<off_t>(final_size)) != 0)
+      result = false;
+    if (close(fd_) != 0)
+      result = false;
+    fd_ = -1;
+  }
+  size_ = 0;
+  return result;
+}
+
+#endif
+
+MappedFile::~MappedFile() {
+  Close(size_);
+}
+
+} //crypto
\ No newline at end of file
@@ -0,0 +1,52 @@
+﻿#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+namespace crypto {
+
+// A whole file mapped into memory, read-only or as preallocated output.
+class MappedFile {
+public:
+  MappedFile();
+
+  virtual ~MappedFile();
+
+  // Maps an existing file read-only. Fails for anything that is not a
+  // regular file (pipes, terminals), which callers then stream instead.
+  bool OpenForRead(const std::string &path);
+
+  // Creates or truncates |path|, reserves |size| bytes on disk and maps
+  // them writable.
+  bool CreateForWrite(const std::string &path, size_t size);
+
+  // Unmaps and, for output files, cuts the file to |final_size| bytes.
+  bool Close(size_t final_size);
+
+  uint8_t *data() const { return data_; }
+
+  size_t size() const { return size_; }
+
+  // Whether |path| names a regular file that OpenForRead() can map.
+  static bool IsRegularFile(const std::string &path);
+private:
+  bool Map(bool writable);
+
+  uint8_t *data_;
+  size_t size_;
+  bool writable_;
+#if defined(_WIN32)
+  HANDLE file_;
+  HANDLE mapping_;
+#else
+  int fd_;
+#endif
+};
+} //crypto
+
+#endif  //MAPPED_FILE_H_
\ No newline at end of file
@@ -0,0 +1,44 @@
+﻿#include "padding.h"
+#include <string.h>
+
+namespace crypto {
+
+size_t PaddedSize(Padding padding, size_t size, size_t block_size) {
+  size_t pad = size % block_size;
+  if (padding == PKCS5 || pad > 0) {
+    size += (block_size - pad);
+  }
+  return size;
+}
+
+void ApplyPadding(Padding padding,
+                  uint8_t *buffer,
+                  size_t size,
+                  size_t padded_size) {
+  uint8_t value = 0;
+  if (padding == PKCS5)
+    value = static_cast<uint8_t>(padded_size - size);
+  memset(buffer + size, value, padded_size - size);
+}
+
+size_t PaddingLength(Padding padding, const uint8_t *data, size_t size) {
+  if (size == 0)
+    return 0;
+
+  size_t unpad = 0;
+  if (padding == PKCS5) {
+    unpad = data[size - 1];
+    if (unpad > size)
+      unpad = 0;
+  } else {
+    // Byte 0 is never stripped, as in the original loop.
+    for (size_t i = size - 1; i > 0; i--) {
+      if (data[i] > 0)
+        break;
+      ++unpad;
+    }
+  }
+  return unpad;
+}
+
+} //crypto
\ No newline at end of file
@@ -0,0 +1,64 @@
+﻿#ifndef PADDING_H_
+#define PADDING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace crypto {
+enum Padding {
+  NOPKCS,
+  PKCS5
+};
+
+// Size of the buffer that holds |size| bytes of plaintext once padded.
+// NOPKCS zero-fills up to the next block boundary, PKCS5 always adds
+// between 1 and |block_size| bytes.
+size_t PaddedSize(Padding padding, size_t size, size_t block_size);
+
+// Fills buffer[size, padded_size) with the padding bytes.
+void ApplyPadding(Padding padding,
+                  uint8_t *buffer,
+                  size_t size,
+                  size_t padded_size);
+
+// Number of trailing bytes of the decrypted |data| that are padding.
+size_t PaddingLength(Padding padding, const uint8_t *data, size_t size);
+
+// The same three operations with the padding and block size fixed at
+// compile time, for BlockCipher (block_cipher.h): no branch on either is
+// left in the per-call path.
+template <Padding P, size_t BlockSize>
+struct StaticPadding {
+  static_assert(BlockSize > 0 && BlockSize < 256, "PKCS5 pads with one byte");
+
+  static constexpr size_t PaddedSize(size_t size) {
+    if constexpr (P == PKCS5)
+      return size - size % BlockSize + BlockSize;
+    else
+      return (size + BlockSize - 1) / BlockSize * BlockSize;
+  }
+
+  // Fills |block|[size, BlockSize); |size| is less than BlockSize.
+  static void Apply(uint8_t *block, size_t size) {
+    uint8_t value = P == PKCS5 ? static_cast<uint8_t>(BlockSize - size) : 0;
+    memset(block + size, value, BlockSize - size);
+  }
+
+  static constexpr size_t Length(const uint8_t *data, size_t size) {
+    if (size == 0)
+      return 0;
+    if constexpr (P == PKCS5) {
+      size_t unpad = data[size - 1];
+      return unpad > size ? 0 : unpad;
+    } else {
+      size_t unpad = 0;
+      for (size_t i = size - 1; i > 0 && data[i] == 0; i--)
+        ++unpad;
+      return unpad;
+    }
+  }
+};
+} //crypto
+
+#endif  //PADDING_H_
\ No newline at end of file
@@ -0,0 +1,236 @@
+﻿#include "parallel_ecb.h"
+#include <string.h>
+#include <algorithm>
+
+namespace crypto {
+
+namespace {
+
+// Chunks are whole AVX-512 bitslice batches so no worker falls back to the
+// narrower kernels in the middle of the input, and at least 64 KB so the
+// atomics stay off the profile.
+const size_t CHUNK_ALIGN_BLOCKS = 512;
+const size_t MIN_CHUNK_BLOCKS = 64 * 1024 / DES_BLOCK_SIZE;
+// Chunks per thread; a few more than one evens out uneven scheduling.
+const size_t CHUNKS_PER_THREAD = 4;
+
+}  // namespace
+
+ParallelEcb::ParallelEcb(Padding padding,
+                         size_t threads,
+                         size_t min_parallel_size)
+    : padding_(padding),
+      block_size_(DES_BLOCK_SIZE),
+      thread_count_(threads),
+      min_parallel_size_(min_parallel_size),
+      initialized_(false),
+      job_(nullptr),
+      active_(0),
+      generation_(0),
+      quit_(false) {
+  if (thread_count_ == 0)
+    thread_count_ = std::max(1u, std::thread::hardware_concurrency());
+}
+
+ParallelEcb::~ParallelEcb() {
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    quit_ = true;
+  }
+  job_ready_.notify_all();
+  for (std::thread &worker : workers_)
+    worker.join();
+}
+
+bool ParallelEcb::Initialize() {
+  if (initialized_)
+    return true;
+  for (size_t i = 1; i < thread_count_; i++)
+    workers_.emplace_back(&ParallelEcb::WorkerMain, this);
+  initialized_ = true;
+  return true;
+}
+
+size_t ParallelEcb::RequiredOutputSize(size_t plaintext_size) const {
+  return PaddedSize(padding_, plaintext_size, block_size_);
+}
+
+bool ParallelEcb::DoEncrypt(const std::string &key,
+                            const std::string &plaintext,
+                            std::string *ciphertext) {
+  ciphertext->resize(RequiredOutputSize(plaintext.size()));
+  size_t size = 0;
+  bool result = DoEncrypt(
+      key,
+      std::span<const uint8_t>(
+          reinterpret_cast<const uint8_t *>(plaintext.data()), plaintext.size()),
+      std::span<uint8_t>(reinterpret_cast<uint8_t *>(ciphertext->data()),
+                         ciphertext->size()),
+      &size);
+  ciphertext->resize(size);
+  return result;
+}
+
+bool ParallelEcb::DoDecrypt(const std::string &key,
+                            const std::string &ciphertext,
+                            std::string *plaintext) {
+  plaintext->resize(ciphertext.size());
+  size_t size = 0;
+  bool result = DoDecrypt(
+      key,
+      std::span<const uint8_t>(
+          reinterpret_cast<const uint8_t *>(ciphertext.data()), ciphertext.size()),
+      std::span<uint8_t>(reinterpret_cast<uint8_t *>(plaintext->data()),
+                         plaintext->size()),
+      &size);
+  plaintext->resize(size);
+  return result;
+}
+
+// The whole blocks are encrypted straight from |plaintext|; only the final
+// partial (or, for PKCS5, extra) block is assembled and padded on the stack.
+bool ParallelEcb::DoEncrypt(const std::string &key,
+                            std::span<const uint8_t> plaintext,
+                            std::span<uint8_t> ciphertext,
+                            size_t *written) {
+  *written = 0;
+  if (!initialized_)
+    return false;
+
+  size_t buffer_size = RequiredOutputSize(plaintext.size());
+  if (ciphertext.size() < buffer_size)
+    return false;
+
+  KeyCache<TripleDesKeySchedule>::Entry schedule =
+      GetTripleDesKeySchedule(&key_cache_, key);
+  if (!schedule)
+    return false;
+
+  size_t full_blocks = plaintext.size() / block_size_;
+  size_t full_size = full_blocks * block_size_;
+  CryptBlocks(schedule->encrypt, plaintext.data(), ciphertext.data(), full_blocks);
+
+  if (buffer_size > full_size) {
+    uint8_t last[DES_BLOCK_SIZE];
+    size_t tail = plaintext.size() - full_size;
+    if (tail > 0)
+      memcpy(last, plaintext.data() + full_size, tail);
+    ApplyPadding(padding_, last, tail, block_size_);
+    TripleDesCryptBlocks(schedule->encrypt, last, ciphertext.data() + full_size, 1);
+    SecureZero(last, sizeof(last));
+  }
+  *written = buffer_size;
+  return true;
+}
+
+bool ParallelEcb::DoDecrypt(const std::string &key,
+                            std::span<const uint8_t> ciphertext,
+                            std::span<uint8_t> plaintext,
+                            size_t *written) {
+  *written = 0;
+  if (!initialized_)
+    return false;
+
+  size_t cipher_size = ciphertext.size();
+  if (cipher_size % block_size_ || plaintext.size() < cipher_size)
+    return false;
+
+  KeyCache<TripleDesKeySchedule>::Entry schedule =
+      GetTripleDesKeySchedule(&key_cache_, key);
+  if (!schedule)
+    return false;
+
+  if (cipher_size == 0)
+    return true;
+  uint8_t *output = plaintext.data();
+  CryptBlocks(schedule->decrypt, ciphertext.data(), output,
+              cipher_size / block_size_);
+
+  *written = cipher_size - PaddingLength(padding_, output, cipher_size);
+  return true;
+}
+
+void ParallelEcb::CryptBlocks(const uint8_t (*round_keys)[8],
+                              const uint8_t *in,
+                              uint8_t *out,
+                              size_t blocks) {
+  if (workers_.empty() || blocks * block_size_ < min_parallel_size_ ||
+      blocks < 2 * MIN_CHUNK_BLOCKS) {
+    TripleDesCryptBlocks(round_keys, in, out, blocks);
+    return;
+  }
+
+  size_t chunk_blocks = blocks / (threads() * CHUNKS_PER_THREAD);
+  chunk_blocks = std::max(chunk_blocks, MIN_CHUNK_BLOCKS);
+  chunk_blocks = (chunk_blocks + CHUNK_ALIGN_BLOCKS - 1) /
+                 CHUNK_ALIGN_BLOCKS * CHUNK_ALIGN_BLOCKS;
+
+  std::lock_guard<std::mutex> run(run_lock_);
+  Job job;
+  job.round_keys = round_keys;
+  job.in = in;
+  job.out = out;
+  job.blocks = blocks;
+  job.chunk_blocks = chunk_blocks;
+  job.chunks = (blocks + chunk_blocks - 1) / chunk_blocks;
+  job.next_chunk = 0;
+  job.done_chunks = 0;
+
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    job_ = &job;
+    ++generation_;
+  }
+  job_ready_.notify_all();
+
+  RunChunks(&job);
+
+  std::unique_lock<std::mutex> lock(lock_);
+  job_done_.wait(lock, [&] {
+    return job.done_chunks.load() == job.chunks && active_ == 0;
+  });
+  job_ = nullptr;
+}
+
+void ParallelEcb::RunChunks(Job *job) {
+  for (;;) {
+    size_t chunk = job->next_chunk.fetch_add(1);
+    if (chunk >= job->chunks)
+      break;
+    size_t first = chunk * job->chunk_blocks;
+    size_t count = std::min(job->chunk_blocks, job->blocks - first);
+    TripleDesCryptBlocks(job->round_keys,
+                         job->in + first * block_size_,
+                         job->out + first * block_size_,
+                         count);
+    job->done_chunks.fetch_add(1);
+  }
+}
+
+void ParallelEcb::WorkerMain() {
+  uint64_t seen = 0;
+  for (;;) {
+    Job *job;
+    {
+      std::unique_lock<std::mutex> lock(lock_);
+      job_ready_.wait(lock, [&] {
+        return quit_ || (job_ != nullptr && generation_ != seen);
+      });
+      if (quit_)
+        return;
+      seen = generation_;
+      job = job_;
+      ++active_;
+    }
+
+    RunChunks(job);
+
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      --active_;
+    }
+    job_done_.notify_all();
+  }
+}
+
+} //crypto
\ No newline at end of file
@@ -0,0 +1,109 @@
+﻿#ifndef PARALLEL_ECB_H_
+#define PARALLEL_ECB_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+#include "des_engine.h"
+#include "key_cache.h"
+#include "padding.h"
+
+namespace crypto {
+
+const size_t DEFAULT_PARALLEL_MIN_SIZE = 256 * 1024;
+
+// 3DES ECB front end that splits large inputs into block-aligned chunks
+// and runs them on a set of worker threads plus the calling thread. Output
+// is byte-identical to Crypto3DesSoft; inputs smaller than
+// |min_parallel_size| run inline on the caller.
+class ParallelEcb {
+public:
+  // |threads| counts the calling thread; 0 uses every hardware thread.
+  explicit ParallelEcb(Padding padding,
+                       size_t threads = 0,
+                       size_t min_parallel_size = DEFAULT_PARALLEL_MIN_SIZE);
+
+  virtual ~ParallelEcb();
+
+  // Starts the worker threads.
+  bool Initialize();
+
+  bool DoEncrypt(const std::string &key,
+                 const std::string &plaintext,
+                 std::string *ciphertext);
+
+  bool DoDecrypt(const std::string &key,
+                 const std::string &ciphertext,
+                 std::string *plaintext);
+
+  size_t RequiredOutputSize(size_t plaintext_size) const;
+
+  // Same contract as the Crypto3DesSoft span overloads.
+  bool DoEncrypt(const std::string &key,
+                 std::span<const uint8_t> plaintext,
+                 std::span<uint8_t> ciphertext,
+                 size_t *written);
+
+  bool DoDecrypt(const std::string &key,
+                 std::span<const uint8_t> ciphertext,
+                 std::span<uint8_t> plaintext,
+                 size_t *written);
+
+  // Raw ECB over whole blocks with the encrypt or decrypt half of a
+  // schedule, parallel above the size threshold.
+  void CryptBlocks(const uint8_t (*round_keys)[8],
+                   const uint8_t *in,
+                   uint8_t *out,
+                   size_t blocks);
+
+  void set_min_parallel_size(size_t size) { min_parallel_size_ = size; }
+
+  size_t threads() const { return workers_.size() + 1; }
+
+  KeyCache<TripleDesKeySchedule> &key_cache() { return key_cache_; }
+private:
+  struct Job {
+    const uint8_t (*round_keys)[8];
+    const uint8_t *in;
+    uint8_t *out;
+    size_t blocks;
+    size_t chunk_blocks;
+    size_t chunks;
+    std::atomic<size_t> next_chunk;
+    std::atomic<size_t> done_chunks;
+  };
+
+  void WorkerMain();
+
+  // Claims chunks of |job| until none are left.
+  void RunChunks(Job *job);
+
+  Padding padding_;
+  uint32_t block_size_;
+  size_t thread_count_;
+  size_t min_parallel_size_;
+  bool initialized_;
+  KeyCache<TripleDesKeySchedule> key_cache_;
+
+  // One parallel job at a time; small inputs never take |run_lock_|.
+  std::mutex run_lock_;
+  std::mutex lock_;
+  std::condition_variable job_ready_;
+  std::condition_variable job_done_;
+  Job *job_;
+  // Workers currently inside RunChunks(job_); the caller's Job lives on its
+  // stack, so it may not return before this drops back to zero.
+  size_t active_;
+  uint64_t generation_;
+  bool quit_;
+  std::vector<std::thread> workers_;
+};
+} //crypto
+
+#endif  //PARALLEL_ECB_H_
\ No newline at end of file
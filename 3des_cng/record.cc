@@ -0,0 +1,202 @@
+﻿#include "record.h"
+#include <string.h>
+
+namespace crypto {
+
+namespace {
+
+void PutUint32(uint32_t value, uint8_t *out) {
+  out[0] = static_cast<uint8_t>(value >> 24);
+  out[1] = static_cast<uint8_t>(value >> 16);
+  out[2] = static_cast<uint8_t>(value >> 8);
+  out[3] = static_cast<uint8_t>(value);
+}
+
+uint32_t GetUint32(const uint8_t *in) {
+  return (static_cast<uint32_t>(in[0]) << 24) |
+         (static_cast<uint32_t>(in[1]) << 16) |
+         (static_cast<uint32_t>(in[2]) << 8) |
+         static_cast<uint32_t>(in[3]);
+}
+
+}  // namespace
+
+bool MakeRecordHeader(uint32_t key_id,
+                      ChainMode mode,
+                      Padding padding,
+                      std::span<const uint8_t> iv,
+                      size_t ciphertext_size,
+                      RecordHeader *header) {
+  if (iv.size() > RECORD_MAX_IV_SIZE || ciphertext_size > UINT32_MAX)
+    return false;
+  header->length = static_cast<uint32_t>(ciphertext_size);
+  header->key_id = key_id;
+  header->mode = mode;
+  header->padding = padding;
+  header->iv_size = static_cast<uint8_t>(iv.size());
+  memset(header->iv, 0, sizeof(header->iv));
+  if (!iv.empty())
+    memcpy(header->iv, iv.data(), iv.size());
+  return true;
+}
+
+void WriteRecordHeader(const RecordHeader &header, uint8_t *out) {
+  PutUint32(header.length, out);
+  out[4] = RECORD_VERSION;
+  out[5] = static_cast<uint8_t>(header.mode);
+  out[6] = static_cast<uint8_t>(header.padding);
+  out[7] = header.iv_size;
+  PutUint32(header.key_id, out + 8);
+  memcpy(out + 12, header.iv, RECORD_MAX_IV_SIZE);
+}
+
+bool ReadRecordHeader(const uint8_t *in, RecordHeader *header) {
+  if (in[4] != RECORD_VERSION || in[5] > CTR || in[6] > PKCS5 ||
+      in[7] > RECORD_MAX_IV_SIZE)
+    return false;
+  header->length = GetUint32(in);
+  header->mode = static_cast<ChainMode>(in[5]);
+  header->padding = static_cast<Padding>(in[6]);
+  header->iv_size = in[7];
+  header->key_id = GetUint32(in + 8);
+  memcpy(header->iv, in + 12, RECORD_MAX_IV_SIZE);
+  return true;
+}
+
+RecordEncoder::RecordEncoder()
+    : first_(0),
+      pending_bytes_(0) {}
+
+RecordEncoder::~RecordEncoder() {}
+
+bool RecordEncoder::Add(uint32_t key_id,
+                        ChainMode mode,
+                        Padding padding,
+                        std::span<const uint8_t> iv,
+                        std::span<const uint8_t> ciphertext) {
+  RecordHeader header;
+  if (!MakeRecordHeader(key_id, mode, padding, iv, ciphertext.size(),
+                        &header))
+    return false;
+  headers_.emplace_back();
+  WriteRecordHeader(header, headers_.back().data());
+  Push(headers_.back().data(), RECORD_HEADER_SIZE);
+  Push(ciphertext.data(), ciphertext.size());
+  return true;
+}
+
+bool RecordEncoder::Add(uint32_t key_id,
+                        ChainMode mode,
+                        Padding padding,
+                        std::span<const uint8_t> iv,
+                        std::string &&ciphertext) {
+  owned_.push_back(std::move(ciphertext));
+  const std::string &kept = owned_.back();
+  if (!Add(key_id, mode, padding, iv,
+           std::span<const uint8_t>(
+               reinterpret_cast<const uint8_t *>(kept.data()), kept.size()))) {
+    owned_.pop_back();
+    return false;
+  }
+  return true;
+}
+
+int RecordEncoder::iovcnt() const {
+  size_t count = iov_.size() - first_;
+  return count < static_cast<size_t>(RECORD_MAX_IOV)
+      ? static_cast<int>(count) : RECORD_MAX_IOV;
+}
+
+void RecordEncoder::Consume(size_t written) {
+  pending_bytes_ -= written < pending_bytes_ ? written : pending_bytes_;
+  while (written > 0 && first_ < iov_.size()) {
+    IoVec &vec = iov_[first_];
+    if (written < vec.iov_len) {
+      vec.iov_base = static_cast<uint8_t *>(vec.iov_base) + written;
+      vec.iov_len -= written;
+      return;
+    }
+    written -= vec.iov_len;
+    ++first_;
+  }
+  if (first_ == iov_.size())
+    Clear();
+}
+
+void RecordEncoder::Clear() {
+  headers_.clear();
+  owned_.clear();
+  iov_.clear();
+  first_ = 0;
+  pending_bytes_ = 0;
+}
+
+void RecordEncoder::Push(const void *data, size_t size) {
+  // An empty ciphertext needs no iovec of its own.
+  if (size == 0)
+    return;
+  IoVec vec;
+  vec.iov_base = const_cast<void *>(data);
+  vec.iov_len = size;
+  iov_.push_back(vec);
+  pending_bytes_ += size;
+}
+
+RecordDecoder::RecordDecoder(size_t capacity)
+    : buffer_(capacity > RECORD_HEADER_SIZE ? capacity
+                                            : RECORD_HEADER_SIZE + 1),
+      read_(0),
+      write_(0),
+      failed_(false) {}
+
+RecordDecoder::~RecordDecoder() {}
+
+std::span<uint8_t> RecordDecoder::WriteSpace() {
+  if (failed_)
+    return std::span<uint8_t>();
+  if (read_ == write_) {
+    // Nothing buffered: start over at the front for free.
+    read_ = 0;
+    write_ = 0;
+  } else if (read_ > 0) {
+    // Bytes the unfinished record still needs, when its header is in.
+    size_t needed = buffer_.size() - read_;
+    if (write_ - read_ >= RECORD_HEADER_SIZE) {
+      RecordHeader header;
+      if (ReadRecordHeader(&buffer_[read_], &header))
+        needed = RECORD_HEADER_SIZE + header.length;
+    }
+    if (write_ == buffer_.size() || read_ + needed > buffer_.size()) {
+      memmove(buffer_.data(), &buffer_[read_], write_ - read_);
+      write_ -= read_;
+      read_ = 0;
+    }
+  }
+  return std::span<uint8_t>(buffer_.data() + write_, buffer_.size() - write_);
+}
+
+void RecordDecoder::Commit(size_t size) {
+  write_ += size;
+}
+
+RecordDecoder::Result RecordDecoder::Next(RecordHeader *header,
+                                          std::span<uint8_t> *payload) {
+  if (failed_)
+    return BAD_RECORD;
+  size_t available = write_ - read_;
+  if (available < RECORD_HEADER_SIZE)
+    return NEED_MORE;
+  if (!ReadRecordHeader(&buffer_[read_], header) ||
+      header->length > buffer_.size() - RECORD_HEADER_SIZE) {
+    failed_ = true;
+    return BAD_RECORD;
+  }
+  size_t total = RECORD_HEADER_SIZE + header->length;
+  if (available < total)
+    return NEED_MORE;
+  *payload = std::span<uint8_t>(&buffer_[read_ + RECORD_HEADER_SIZE],
+                                header->length);
+  read_ += total;
+  return RECORD;
+}
+} //crypto
\ No newline at end of file
@@ -0,0 +1,195 @@
+﻿#ifndef RECORD_H_
+#define RECORD_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <array>
+#include <deque>
+#include <span>
+#include <string>
+#include <vector>
+#if !defined(_WIN32)
+#include <sys/uio.h>
+#endif
+#include "chain_mode.h"
+#include "padding.h"
+
+namespace crypto {
+
+// Wire format of one record, all integers big-endian:
+//
+//   0  uint32 length   ciphertext bytes following the header
+//   4  uint8  version  RECORD_VERSION
+//   5  uint8  mode     ChainMode
+//   6  uint8  padding  Padding
+//   7  uint8  iv_size  bytes of |iv| in use, 0 for ECB
+//   8  uint32 key_id   chosen by the application
+//  12  uint8  iv[16]   zero-filled past |iv_size|
+//  28  ciphertext
+const size_t RECORD_HEADER_SIZE = 28;
+const size_t RECORD_MAX_IV_SIZE = 16;
+const uint8_t RECORD_VERSION = 1;
+
+const size_t DEFAULT_RECORD_BUFFER_SIZE = 256 * 1024;
+
+// Most iovecs handed to one writev() (IOV_MAX on Linux).
+const int RECORD_MAX_IOV = 1024;
+
+#if defined(_WIN32)
+// Laid out like POSIX struct iovec; copy into WSABUFs for WSASend().
+struct IoVec {
+  void *iov_base;
+  size_t iov_len;
+};
+#else
+typedef struct iovec IoVec;
+#endif
+
+struct RecordHeader {
+  uint32_t length;
+  uint32_t key_id;
+  ChainMode mode;
+  Padding padding;
+  uint8_t iv_size;
+  uint8_t iv[RECORD_MAX_IV_SIZE];
+};
+
+// Fills |header| for a record of |ciphertext_size| bytes. False if the IV
+// is too long or the size does not fit the length field.
+bool MakeRecordHeader(uint32_t key_id,
+                      ChainMode mode,
+                      Padding padding,
+                      std::span<const uint8_t> iv,
+                      size_t ciphertext_size,
+                      RecordHeader *header);
+
+// |out| must hold RECORD_HEADER_SIZE bytes.
+void WriteRecordHeader(const RecordHeader &header, uint8_t *out);
+
+// Parses RECORD_HEADER_SIZE bytes; false for an unknown version, mode or
+// padding or an oversized IV.
+bool ReadRecordHeader(const uint8_t *in, RecordHeader *header);
+
+// Queues records for writev() without copying their ciphertext: each
+// record adds two iovecs, one for its serialized header (kept here) and
+// one for the ciphertext itself.
+//
+//   encoder.Add(key_id, CBC, PKCS5, iv, std::move(ciphertext));
+//   while (encoder.iovcnt() > 0) {
+//     ssize_t n = writev(fd, encoder.iov(), encoder.iovcnt());
+//     ...
+//     encoder.Consume(n);
+//   }
+class RecordEncoder {
+public:
+  RecordEncoder();
+
+  virtual ~RecordEncoder();
+
+  // Queues a record of |ciphertext|, which is referenced, not copied, and
+  // must stay unchanged until it has been written.
+  bool Add(uint32_t key_id,
+           ChainMode mode,
+           Padding padding,
+           std::span<const uint8_t> iv,
+           std::span<const uint8_t> ciphertext);
+
+  // The same, keeping |ciphertext| (e.g. DoEncrypt() output) alive here.
+  bool Add(uint32_t key_id,
+           ChainMode mode,
+           Padding padding,
+           std::span<const uint8_t> iv,
+           std::string &&ciphertext);
+
+  // The unwritten part of the queue, at most RECORD_MAX_IOV entries at a
+  // time.
+  const IoVec *iov() const { return iov_.data() + first_; }
+
+  int iovcnt() const;
+
+  // Drops the first |written| bytes after a possibly short writev(). Once
+  // everything is written the queue is cleared for reuse.
+  void Consume(size_t written);
+
+  size_t pending_bytes() const { return pending_bytes_; }
+
+  void Clear();
+private:
+  void Push(const void *data, size_t size);
+
+  // Deques keep their elements in place as they grow, so the iovecs can
+  // point into them.
+  std::deque<std::array<uint8_t, RECORD_HEADER_SIZE>> headers_;
+  std::deque<std::string> owned_;
+  std::vector<IoVec> iov_;
+  size_t first_;
+  size_t pending_bytes_;
+};
+
+// Splits a received byte stream into records and decrypts each in place.
+// Bytes are received straight into WriteSpace(); a record that arrives in
+// pieces stays put until its last byte is in.
+//
+// The buffer is used as a ring whose records never wrap: when the free
+// space at the end cannot hold the rest of the unfinished record, that
+// record's bytes are moved back to the start, so nothing but the one
+// partial record is ever copied. A record (header included) must fit in
+// |capacity|.
+class RecordDecoder {
+public:
+  enum Result {
+    RECORD,
+    NEED_MORE,
+    // Malformed header, oversized record or failed decryption. The stream
+    // cannot be resynchronized; every later call fails too.
+    BAD_RECORD
+  };
+
+  explicit RecordDecoder(size_t capacity = DEFAULT_RECORD_BUFFER_SIZE);
+
+  virtual ~RecordDecoder();
+
+  // Contiguous free space to receive into. Invalidates the spans returned
+  // by earlier Next() calls. Empty only after BAD_RECORD.
+  std::span<uint8_t> WriteSpace();
+
+  // |size| bytes were received into WriteSpace().
+  void Commit(size_t size);
+
+  // Takes the next complete record off the buffer. |payload| points at its
+  // ciphertext inside the buffer and stays valid until WriteSpace().
+  Result Next(RecordHeader *header, std::span<uint8_t> *payload);
+
+  // Next() followed by |decrypt|(header, ciphertext, &plaintext_size),
+  // which decrypts the ciphertext in place, e.g. through an in-place span
+  // overload of DoDecrypt(). |plaintext| is then the decrypted prefix.
+  template <typename Decrypt>
+  Result NextDecrypted(Decrypt &&decrypt,
+                       RecordHeader *header,
+                       std::span<uint8_t> *plaintext) {
+    std::span<uint8_t> payload;
+    Result result = Next(header, &payload);
+    if (result != RECORD)
+      return result;
+    size_t size = 0;
+    if (!decrypt(static_cast<const RecordHeader &>(*header), payload, &size) ||
+        size > payload.size()) {
+      failed_ = true;
+      return BAD_RECORD;
+    }
+    *plaintext = payload.first(size);
+    return RECORD;
+  }
+
+  // Received bytes not yet returned as records.
+  size_t buffered() const { return write_ - read_; }
+private:
+  std::vector<uint8_t> buffer_;
+  // Unconsumed data is [read_, write_).
+  size_t read_;
+  size_t write_;
+  bool failed_;
+};
+} //crypto
+
+#endif  //RECORD_H_
\ No newline at end of file
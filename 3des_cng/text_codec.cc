@@ -0,0 +1,287 @@
+﻿#include "text_codec.h"
+#include "cpu_features.h"
+
+namespace crypto {
+
+// text_codec_ssse3.cc and text_codec_avx2.cc; stubs off x86. Each runs
+// over as much of its input as fills whole vectors and returns how much
+// it consumed (bytes when encoding, characters when decoding). The
+// decoders stop in front of the first vector holding an invalid
+// character and leave it to the table path to reject.
+size_t Base64EncodeSsse3(const uint8_t *in, size_t size, char *out);
+size_t Base64DecodeSsse3(const char *in, size_t size, uint8_t *out);
+size_t HexEncodeSsse3(const uint8_t *in, size_t size, char *out);
+size_t HexDecodeSsse3(const char *in, size_t size, uint8_t *out);
+size_t Base64EncodeAvx2(const uint8_t *in, size_t size, char *out);
+size_t Base64DecodeAvx2(const char *in, size_t size, uint8_t *out);
+size_t HexEncodeAvx2(const uint8_t *in, size_t size, char *out);
+size_t HexDecodeAvx2(const char *in, size_t size, uint8_t *out);
+
+namespace {
+
+const char kBase64Alphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+const char kHexDigits[] = "0123456789abcdef";
+
+// Character to value, or INVALID_CHAR.
+const uint8_t INVALID_CHAR = 0xff;
+
+struct DecodeTable {
+  uint8_t values[256];
+};
+
+constexpr DecodeTable MakeBase64DecodeTable() {
+  DecodeTable table = {};
+  for (int c = 0; c < 256; c++)
+    table.values[c] = INVALID_CHAR;
+  for (int i = 0; i < 64; i++)
+    table.values[static_cast<uint8_t>(kBase64Alphabet[i])] = i;
+  return table;
+}
+
+constexpr DecodeTable MakeHexDecodeTable() {
+  DecodeTable table = {};
+  for (int c = 0; c < 256; c++)
+    table.values[c] = INVALID_CHAR;
+  for (int i = 0; i < 16; i++) {
+    table.values[static_cast<uint8_t>(kHexDigits[i])] = i;
+    table.values[static_cast<uint8_t>("0123456789ABCDEF"[i])] = i;
+  }
+  return table;
+}
+
+constexpr DecodeTable kBase64Decode = MakeBase64DecodeTable();
+constexpr DecodeTable kHexDecode = MakeHexDecodeTable();
+
+enum class CodecIsa {
+  SCALAR,
+  SSSE3,
+  AVX2
+};
+
+CodecIsa BestCodecIsa() {
+  static const CodecIsa isa = [] {
+    const CpuFeatures &features = GetCpuFeatures();
+    if (features.avx2)
+      return CodecIsa::AVX2;
+    if (features.ssse3)
+      return CodecIsa::SSSE3;
+    return CodecIsa::SCALAR;
+  }();
+  return isa;
+}
+
+uint8_t Base64Value(char c) {
+  return kBase64Decode.values[static_cast<uint8_t>(c)];
+}
+
+// Four characters without padding into three bytes.
+bool DecodeBase64Quads(const char *in, size_t quads, uint8_t *out) {
+  for (size_t i = 0; i < quads; i++) {
+    uint32_t a = Base64Value(in[0]);
+    uint32_t b = Base64Value(in[1]);
+    uint32_t c = Base64Value(in[2]);
+    uint32_t d = Base64Value(in[3]);
+    if ((a | b | c | d) & 0x80)
+      return false;
+    uint32_t v = (a << 18) | (b << 12) | (c << 6) | d;
+    out[0] = static_cast<uint8_t>(v >> 16);
+    out[1] = static_cast<uint8_t>(v >> 8);
+    out[2] = static_cast<uint8_t>(v);
+    in += 4;
+    out += 3;
+  }
+  return true;
+}
+
+}  // namespace
+
+bool Base64DecodedSize(std::string_view text, size_t *size) {
+  *size = 0;
+  if (text.size() % 4)
+    return false;
+  size_t pad = 0;
+  if (!text.empty() && text.back() == '=')
+    pad = text[text.size() - 2] == '=' ? 2 : 1;
+  *size = text.size() / 4 * 3 - pad;
+  return true;
+}
+
+void Base64Encode(std::span<const uint8_t> in, char *out) {
+  const uint8_t *p = in.data();
+  size_t size = in.size();
+  size_t done = 0;
+  switch (BestCodecIsa()) {
+    case CodecIsa::AVX2:
+      done = Base64EncodeAvx2(p, size, out);
+      break;
+    case CodecIsa::SSSE3:
+      done = Base64EncodeSsse3(p, size, out);
+      break;
+    case CodecIsa::SCALAR:
+      break;
+  }
+  p += done;
+  out += done / 3 * 4;
+  size -= done;
+
+  for (; size >= 3; size -= 3) {
+    uint32_t v = (p[0] << 16) | (p[1] << 8) | p[2];
+    out[0] = kBase64Alphabet[v >> 18];
+    out[1] = kBase64Alphabet[(v >> 12) & 0x3f];
+    out[2] = kBase64Alphabet[(v >> 6) & 0x3f];
+    out[3] = kBase64Alphabet[v & 0x3f];
+    p += 3;
+    out += 4;
+  }
+  if (size > 0) {
+    uint32_t v = (p[0] << 16) | (size == 2 ? p[1] << 8 : 0);
+    out[0] = kBase64Alphabet[v >> 18];
+    out[1] = kBase64Alphabet[(v >> 12) & 0x3f];
+    out[2] = size == 2 ? kBase64Alphabet[(v >> 6) & 0x3f] : '=';
+    out[3] = '=';
+  }
+}
+
+bool Base64Decode(std::string_view text, uint8_t *out, size_t *written) {
+  *written = 0;
+  size_t size = 0;
+  if (!Base64DecodedSize(text, &size))
+    return false;
+  if (text.empty())
+    return true;
+
+  // All but the last four characters, which may hold padding.
+  const char *in = text.data();
+  size_t body = text.size() - 4;
+  size_t done = 0;
+  switch (BestCodecIsa()) {
+    case CodecIsa::AVX2:
+      done = Base64DecodeAvx2(in, body, out);
+      break;
+    case CodecIsa::SSSE3:
+      done = Base64DecodeSsse3(in, body, out);
+      break;
+    case CodecIsa::SCALAR:
+      break;
+  }
+  if (!DecodeBase64Quads(in + done, (body - done) / 4, out + done / 4 * 3))
+    return false;
+  in += body;
+  out += body / 4 * 3;
+
+  size_t pad = text.size() / 4 * 3 - size;
+  if (pad == 0) {
+    if (!DecodeBase64Quads(in, 1, out))
+      return false;
+    *written = size;
+    return true;
+  }
+  uint32_t a = Base64Value(in[0]);
+  uint32_t b = Base64Value(in[1]);
+  uint32_t c = pad == 1 ? Base64Value(in[2]) : 0;
+  if ((a | b | c) & 0x80)
+    return false;
+  uint32_t v = (a << 18) | (b << 12) | (c << 6);
+  // The bits past the last whole byte must be zero.
+  if (v & (pad == 1 ? 0xff : 0xffff))
+    return false;
+  out[0] = static_cast<uint8_t>(v >> 16);
+  if (pad == 1)
+    out[1] = static_cast<uint8_t>(v >> 8);
+  *written = size;
+  return true;
+}
+
+std::string Base64Encode(std::span<const uint8_t> in) {
+  std::string text(Base64EncodedSize(in.size()), '\0');
+  Base64Encode(in, text.data());
+  return text;
+}
+
+bool Base64Decode(std::string_view text, std::string *out) {
+  size_t size = 0;
+  Base64DecodedSize(text, &size);
+  out->resize(size);
+  size_t written = 0;
+  bool result = Base64Decode(text, reinterpret_cast<uint8_t *>(out->data()),
+                             &written);
+  out->resize(written);
+  return result;
+}
+
+void HexEncode(std::span<const uint8_t> in, char *out) {
+  const uint8_t *p = in.data();
+  size_t size = in.size();
+  size_t done = 0;
+  switch (BestCodecIsa()) {
+    case CodecIsa::AVX2:
+      done = HexEncodeAvx2(p, size, out);
+      break;
+    case CodecIsa::SSSE3:
+      done = HexEncodeSsse3(p, size, out);
+      break;
+    case CodecIsa::SCALAR:
+      break;
+  }
+  for (size_t i = done; i < size; i++) {
+    out[2 * i] = kHexDigits[p[i] >> 4];
+    out[2 * i + 1] = kHexDigits[p[i] & 0xf];
+  }
+}
+
+bool HexDecode(std::string_view text, uint8_t *out, size_t *written) {
+  *written = 0;
+  if (text.size() % 2)
+    return false;
+  const char *in = text.data();
+  size_t size = text.size();
+  size_t done = 0;
+  switch (BestCodecIsa()) {
+    case CodecIsa::AVX2:
+      done = HexDecodeAvx2(in, size, out);
+      break;
+    case CodecIsa::SSSE3:
+      done = HexDecodeSsse3(in, size, out);
+      break;
+    case CodecIsa::SCALAR:
+      break;
+  }
+  for (size_t i = done; i < size; i += 2) {
+    uint8_t high = kHexDecode.values[static_cast<uint8_t>(in[i])];
+    uint8_t low = kHexDecode.values[static_cast<uint8_t>(in[i + 1])];
+    if ((high | low) & 0x80)
+      return false;
+    out[i / 2] = static_cast<uint8_t>((high << 4) | low);
+  }
+  *written = size / 2;
+  return true;
+}
+
+std::string HexEncode(std::span<const uint8_t> in) {
+  std::string text(HexEncodedSize(in.size()), '\0');
+  HexEncode(in, text.data());
+  return text;
+}
+
+bool HexDecode(std::string_view text, std::string *out) {
+  out->resize(text.size() / 2);
+  size_t written = 0;
+  bool result = HexDecode(text, reinterpret_cast<uint8_t *>(out->data()),
+                          &written);
+  out->resize(written);
+  return result;
+}
+
+#if !defined(_M_X64) && !defined(_M_IX86) && !defined(__x86_64__) && !defined(__i386__)
+size_t Base64EncodeSsse3(const uint8_t *, size_t, char *) { return 0; }
+size_t Base64DecodeSsse3(const char *, size_t, uint8_t *) { return 0; }
+size_t HexEncodeSsse3(const uint8_t *, size_t, char *) { return 0; }
+size_t HexDecodeSsse3(const char *, size_t, uint8_t *) { return 0; }
+size_t Base64EncodeAvx2(const uint8_t *, size_t, char *) { return 0; }
+size_t Base64DecodeAvx2(const char *, size_t, uint8_t *) { return 0; }
+size_t HexEncodeAvx2(const uint8_t *, size_t, char *) { return 0; }
+size_t HexDecodeAvx2(const char *, size_t, uint8_t *) { return 0; }
+#endif
+
+} //crypto
\ No newline at end of file
@@ -0,0 +1,100 @@
+﻿#ifndef TEXT_CODEC_H_
+#define TEXT_CODEC_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace crypto {
+
+// Base64 (RFC 4648 section 4: standard alphabet, '=' padding, no line
+// breaks) and hex, for ciphertext that travels in JSON or HTTP headers.
+// Long inputs go through SSSE3 or AVX2 kernels picked at run time; the
+// last few bytes, and everything on other CPUs, take the table path. The
+// output is the same either way.
+//
+// Decoding is strict: whitespace, a misplaced '=', a wrong length or
+// non-zero bits left over in the last Base64 character all fail.
+
+inline constexpr size_t Base64EncodedSize(size_t size) {
+  return (size + 2) / 3 * 4;
+}
+
+// Bytes |text| decodes to. False if its length or padding rules it out;
+// the characters themselves are only checked by Base64Decode().
+bool Base64DecodedSize(std::string_view text, size_t *size);
+
+// Writes Base64EncodedSize(in.size()) characters to |out|.
+void Base64Encode(std::span<const uint8_t> in, char *out);
+
+// |out| must hold the Base64DecodedSize() of |text|. |out| is left
+// partly written on failure.
+bool Base64Decode(std::string_view text, uint8_t *out, size_t *written);
+
+std::string Base64Encode(std::span<const uint8_t> in);
+
+bool Base64Decode(std::string_view text, std::string *out);
+
+inline constexpr size_t HexEncodedSize(size_t size) {
+  return size * 2;
+}
+
+// Writes lowercase digits, HexEncodedSize(in.size()) of them, to |out|.
+void HexEncode(std::span<const uint8_t> in, char *out);
+
+// Takes either case. |out| must hold text.size() / 2 bytes; an odd length
+// fails.
+bool HexDecode(std::string_view text, uint8_t *out, size_t *written);
+
+std::string HexEncode(std::span<const uint8_t> in);
+
+bool HexDecode(std::string_view text, std::string *out);
+
+// Ciphertext that BlockCipher::EncryptToText() encrypts and encodes in
+// one go: well inside L1 together with its text.
+const size_t TEXT_CHUNK_BYTES = 3 * 1024;
+
+// The two codecs as types, for BlockCipher::EncryptToText() and
+// DecryptFromText(): a group of BYTES bytes is always CHARS characters,
+// so text cut at a multiple of CHARS decodes piece by piece.
+struct Base64Codec {
+  static constexpr size_t BYTES = 3;
+  static constexpr size_t CHARS = 4;
+
+  static constexpr size_t EncodedSize(size_t size) {
+    return Base64EncodedSize(size);
+  }
+  static bool DecodedSize(std::string_view text, size_t *size) {
+    return Base64DecodedSize(text, size);
+  }
+  static void Encode(std::span<const uint8_t> in, char *out) {
+    Base64Encode(in, out);
+  }
+  static bool Decode(std::string_view text, uint8_t *out, size_t *written) {
+    return Base64Decode(text, out, written);
+  }
+};
+
+struct HexCodec {
+  static constexpr size_t BYTES = 1;
+  static constexpr size_t CHARS = 2;
+
+  static constexpr size_t EncodedSize(size_t size) {
+    return HexEncodedSize(size);
+  }
+  static bool DecodedSize(std::string_view text, size_t *size) {
+    *size = text.size() / 2;
+    return text.size() % 2 == 0;
+  }
+  static void Encode(std::span<const uint8_t> in, char *out) {
+    HexEncode(in, out);
+  }
+  static bool Decode(std::string_view text, uint8_t *out, size_t *written) {
+    return HexDecode(text, out, written);
+  }
+};
+} //crypto
+
+#endif  //TEXT_CODEC_H_
\ No newline at end of file
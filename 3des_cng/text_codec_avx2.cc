@@ -0,0 +1,190 @@
+﻿#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+namespace crypto {
+namespace {
+
+// The same steps as text_codec_ssse3.cc on both 128-bit lanes, whose
+// shuffles cannot cross between lanes.
+
+inline __m256i Load(const void *p) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+}
+
+inline void Store(void *p, __m256i v) {
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v);
+}
+
+inline __m256i Base64Indices(__m256i in) {
+  in = _mm256_shuffle_epi8(in, _mm256_setr_epi8(
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+  __m256i ac = _mm256_mulhi_epu16(
+      _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)),
+      _mm256_set1_epi32(0x04000040));
+  __m256i bd = _mm256_mullo_epi16(
+      _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)),
+      _mm256_set1_epi32(0x01000010));
+  return _mm256_or_si256(ac, bd);
+}
+
+inline __m256i Base64Chars(__m256i indices) {
+  const __m256i offsets = _mm256_setr_epi8(
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+      '/' - 63, 'A', 0, 0,
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+      '/' - 63, 'A', 0, 0);
+  __m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+  __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+  range = _mm256_or_si256(range, _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+  return _mm256_add_epi8(indices, _mm256_shuffle_epi8(offsets, range));
+}
+
+inline __m256i Base64Values(__m256i in, __m256i *invalid) {
+  const __m256i low_bits = _mm256_setr_epi8(
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+      0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+      0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+  const __m256i high_bits = _mm256_setr_epi8(
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m256i offsets = _mm256_setr_epi8(
+      0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+      0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m256i nibble = _mm256_set1_epi8(0x0f);
+  __m256i high = _mm256_and_si256(_mm256_srli_epi32(in, 4), nibble);
+  __m256i low = _mm256_and_si256(in, nibble);
+  *invalid = _mm256_and_si256(_mm256_shuffle_epi8(low_bits, low),
+                              _mm256_shuffle_epi8(high_bits, high));
+  __m256i slash = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('/'));
+  return _mm256_add_epi8(
+      in, _mm256_shuffle_epi8(offsets, _mm256_add_epi8(high, slash)));
+}
+
+// Thirty-two 6-bit values into 24 bytes at the bottom of the vector.
+inline __m256i Base64Pack(__m256i values) {
+  __m256i pairs = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+  __m256i quads = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+  quads = _mm256_shuffle_epi8(quads, _mm256_setr_epi8(
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+  return _mm256_permutevar8x32_epi32(quads,
+                                     _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+}
+
+inline __m256i HexChars(__m256i nibbles) {
+  const __m256i digits = _mm256_setr_epi8(
+      '0', '1', '2', '3', '4', '5', '6', '7',
+      '8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
+      '0', '1', '2', '3', '4', '5', '6', '7',
+      '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+  return _mm256_shuffle_epi8(digits, nibbles);
+}
+
+inline __m256i HexValues(__m256i in, __m256i *valid) {
+  __m256i digit = _mm256_sub_epi8(in, _mm256_set1_epi8('0'));
+  __m256i is_digit =
+      _mm256_cmpeq_epi8(_mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit);
+  __m256i letter = _mm256_sub_epi8(_mm256_or_si256(in, _mm256_set1_epi8(0x20)),
+                                   _mm256_set1_epi8('a'));
+  __m256i is_letter =
+      _mm256_cmpeq_epi8(_mm256_min_epu8(letter, _mm256_set1_epi8(5)), letter);
+  *valid = _mm256_or_si256(is_digit, is_letter);
+  return _mm256_or_si256(
+      _mm256_and_si256(is_digit, digit),
+      _mm256_and_si256(is_letter,
+                       _mm256_add_epi8(letter, _mm256_set1_epi8(10))));
+}
+
+}  // namespace
+
+// Reads 12 bytes into each lane, 28 bytes in all, to use 24.
+size_t Base64EncodeAvx2(const uint8_t *in, size_t size, char *out) {
+  size_t done = 0;
+  for (; size - done >= 28; done += 24) {
+    __m256i v = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + done))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + done + 12)), 1);
+    Store(out, Base64Chars(Base64Indices(v)));
+    out += 32;
+  }
+  return done;
+}
+
+size_t Base64DecodeAvx2(const char *in, size_t size, uint8_t *out) {
+  size_t done = 0;
+  for (; size - done >= 32; done += 32) {
+    __m256i invalid;
+    __m256i values = Base64Values(Load(in + done), &invalid);
+    if (!_mm256_testz_si256(invalid, invalid))
+      break;
+    __m256i bytes = Base64Pack(values);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out),
+                     _mm256_castsi256_si128(bytes));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(out + 16),
+                     _mm256_extracti128_si256(bytes, 1));
+    out += 24;
+  }
+  return done;
+}
+
+size_t HexEncodeAvx2(const uint8_t *in, size_t size, char *out) {
+  const __m256i nibble = _mm256_set1_epi8(0x0f);
+  size_t done = 0;
+  for (; size - done >= 32; done += 32) {
+    __m256i v = Load(in + done);
+    __m256i high = HexChars(_mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+    __m256i low = HexChars(_mm256_and_si256(v, nibble));
+    // Interleaving works per lane: bytes 0-7 and 16-23, then 8-15 and 24-31.
+    __m256i first = _mm256_unpacklo_epi8(high, low);
+    __m256i second = _mm256_unpackhi_epi8(high, low);
+    Store(out, _mm256_permute2x128_si256(first, second, 0x20));
+    Store(out + 32, _mm256_permute2x128_si256(first, second, 0x31));
+    out += 64;
+  }
+  return done;
+}
+
+size_t HexDecodeAvx2(const char *in, size_t size, uint8_t *out) {
+  const __m256i weights = _mm256_set1_epi16(0x0110);
+  size_t done = 0;
+  for (; size - done >= 64; done += 64) {
+    __m256i valid0, valid1;
+    __m256i v0 = HexValues(Load(in + done), &valid0);
+    __m256i v1 = HexValues(Load(in + done + 32), &valid1);
+    if (_mm256_movemask_epi8(_mm256_and_si256(valid0, valid1)) != -1)
+      break;
+    // Packing also works per lane, leaving the quarters in 0, 2, 1, 3 order.
+    __m256i bytes = _mm256_packus_epi16(_mm256_maddubs_epi16(v0, weights),
+                                        _mm256_maddubs_epi16(v1, weights));
+    Store(out, _mm256_permute4x64_epi64(bytes, 0xd8));
+    out += 32;
+  }
+  return done;
+}
+
+} //crypto
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif
\ No newline at end of file
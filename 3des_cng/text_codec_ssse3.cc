@@ -0,0 +1,174 @@
+﻿#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("ssse3"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("ssse3")
+#endif
+
+namespace crypto {
+namespace {
+
+inline __m128i Load(const void *p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+
+inline void Store(void *p, __m128i v) {
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v);
+}
+
+// Twelve bytes, spread over the sixteen lanes as bytes 1,0,2,1 of each
+// group of three, into one 6-bit index per lane (Mula and Lemire).
+inline __m128i Base64Indices(__m128i in) {
+  in = _mm_shuffle_epi8(in, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4,
+                                          7, 6, 8, 7, 10, 9, 11, 10));
+  __m128i ac = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)),
+                               _mm_set1_epi32(0x04000040));
+  __m128i bd = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)),
+                               _mm_set1_epi32(0x01000010));
+  return _mm_or_si128(ac, bd);
+}
+
+// Index to character: the index range picks an offset, 0..25 'A', 26..51
+// 'a' - 26, 52..61 '0' - 52, then '+' and '/'.
+inline __m128i Base64Chars(__m128i indices) {
+  const __m128i offsets = _mm_setr_epi8(
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+      '/' - 63, 'A', 0, 0);
+  // 0..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12; then 0..25 -> 13.
+  __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+  __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+  range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+  return _mm_add_epi8(indices, _mm_shuffle_epi8(offsets, range));
+}
+
+// Characters to 6-bit values. |invalid| gets a non-zero lane for every
+// character outside the alphabet. Each high nibble has a bit in
+// |high_bits|; |low_bits| has that bit set for the low nibbles that are
+// not in the alphabet under that high nibble.
+inline __m128i Base64Values(__m128i in, __m128i *invalid) {
+  const __m128i low_bits = _mm_setr_epi8(
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+      0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+  const __m128i high_bits = _mm_setr_epi8(
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m128i offsets = _mm_setr_epi8(
+      0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m128i nibble = _mm_set1_epi8(0x0f);
+  __m128i high = _mm_and_si128(_mm_srli_epi32(in, 4), nibble);
+  __m128i low = _mm_and_si128(in, nibble);
+  *invalid = _mm_and_si128(_mm_shuffle_epi8(low_bits, low),
+                           _mm_shuffle_epi8(high_bits, high));
+  // '/' shares its high nibble with '+' and takes the otherwise unused
+  // offset at index 1.
+  __m128i slash = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+  return _mm_add_epi8(in, _mm_shuffle_epi8(offsets, _mm_add_epi8(high, slash)));
+}
+
+// Sixteen 6-bit values into twelve bytes at the bottom of the vector.
+inline __m128i Base64Pack(__m128i values) {
+  __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+  __m128i quads = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+  return _mm_shuffle_epi8(quads, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9,
+                                               8, 14, 13, 12, -1, -1, -1, -1));
+}
+
+inline __m128i HexChars(__m128i nibbles) {
+  const __m128i digits = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+                                       '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+  return _mm_shuffle_epi8(digits, nibbles);
+}
+
+// Characters to nibbles; |valid| gets all ones in the lanes of hex digits.
+inline __m128i HexValues(__m128i in, __m128i *valid) {
+  __m128i digit = _mm_sub_epi8(in, _mm_set1_epi8('0'));
+  __m128i is_digit =
+      _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+  __m128i letter = _mm_sub_epi8(_mm_or_si128(in, _mm_set1_epi8(0x20)),
+                                _mm_set1_epi8('a'));
+  __m128i is_letter =
+      _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(5)), letter);
+  *valid = _mm_or_si128(is_digit, is_letter);
+  return _mm_or_si128(
+      _mm_and_si128(is_digit, digit),
+      _mm_and_si128(is_letter, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+}
+
+}  // namespace
+
+// Reads 16 bytes to use 12.
+size_t Base64EncodeSsse3(const uint8_t *in, size_t size, char *out) {
+  size_t done = 0;
+  for (; size - done >= 16; done += 12) {
+    Store(out, Base64Chars(Base64Indices(Load(in + done))));
+    out += 16;
+  }
+  return done;
+}
+
+size_t Base64DecodeSsse3(const char *in, size_t size, uint8_t *out) {
+  size_t done = 0;
+  for (; size - done >= 16; done += 16) {
+    __m128i invalid;
+    __m128i values = Base64Values(Load(in + done), &invalid);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(invalid, _mm_setzero_si128())) !=
+        0xffff)
+      break;
+    __m128i bytes = Base64Pack(values);
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(out), bytes);
+    uint32_t tail = static_cast<uint32_t>(
+        _mm_cvtsi128_si32(_mm_srli_si128(bytes, 8)));
+    memcpy(out + 8, &tail, 4);
+    out += 12;
+  }
+  return done;
+}
+
+size_t HexEncodeSsse3(const uint8_t *in, size_t size, char *out) {
+  const __m128i nibble = _mm_set1_epi8(0x0f);
+  size_t done = 0;
+  for (; size - done >= 16; done += 16) {
+    __m128i v = Load(in + done);
+    __m128i high = HexChars(_mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+    __m128i low = HexChars(_mm_and_si128(v, nibble));
+    Store(out, _mm_unpacklo_epi8(high, low));
+    Store(out + 16, _mm_unpackhi_epi8(high, low));
+    out += 32;
+  }
+  return done;
+}
+
+size_t HexDecodeSsse3(const char *in, size_t size, uint8_t *out) {
+  // High nibble times 16 plus low nibble, per pair of characters.
+  const __m128i weights = _mm_set1_epi16(0x0110);
+  size_t done = 0;
+  for (; size - done >= 32; done += 32) {
+    __m128i valid0, valid1;
+    __m128i v0 = HexValues(Load(in + done), &valid0);
+    __m128i v1 = HexValues(Load(in + done + 16), &valid1);
+    if (_mm_movemask_epi8(_mm_and_si128(valid0, valid1)) != 0xffff)
+      break;
+    Store(out, _mm_packus_epi16(_mm_maddubs_epi16(v0, weights),
+                                _mm_maddubs_epi16(v1, weights)));
+    out += 16;
+  }
+  return done;
+}
+
+} //crypto
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif
\ No newline at end of file
@@ -7,9 +7,10 @@ namespace crypto {
 
 const int DES_BLOCK_SIZE = 8;
 
-bool SetBuffer(const char *data, size_t size,
-               ABI::Windows::Storage::Streams::IBufferFactory *factory,
-               ABI::Windows::Storage::Streams::IBuffer **out_buffer) {
+bool CreateBuffer(size_t size,
+                  ABI::Windows::Storage::Streams::IBufferFactory *factory,
+                  ABI::Windows::Storage::Streams::IBuffer **out_buffer,
+                  byte **out_bytes) {
   Microsoft::WRL::ComPtr<ABI::Windows::Storage::Streams::IBuffer> buffer;
   HRESULT hr = factory->Create(size, &buffer);
   if (hr != S_OK)
@@ -24,39 +25,46 @@ bool SetBuffer(const char *data, size_t size,
   if (hr != S_OK)
     return false;
 
-  byte *bytes;
-  hr = buffer_access->Buffer(&bytes);
+  hr = buffer_access->Buffer(out_bytes);
   if (hr != S_OK)
     return false;
 
-  memcpy(bytes, data, size);
   *out_buffer = buffer.Detach();
   return true;
 }
 
-bool GetBuffer(const ComPtr<IBuffer> &buffer,
-               std::string *outbuffer) {
-  UINT32 size;
-  HRESULT hr = buffer->get_Length(&size);
-  if (hr != S_OK)
+bool SetBuffer(const char *data, size_t size,
+               ABI::Windows::Storage::Streams::IBufferFactory *factory,
+               ABI::Windows::Storage::Streams::IBuffer **out_buffer) {
+  byte *bytes;
+  if (!CreateBuffer(size, factory, out_buffer, &bytes))
     return false;
+  memcpy(bytes, data, size);
+  return true;
+}
 
-  ComPtr<Windows::Storage::Streams::IBufferByteAccess> buffer_access;
-  hr = buffer.As(&buffer_access);
+bool GetBufferBytes(const ComPtr<IBuffer> &buffer,
+                    byte **data,
+                    UINT32 *size) {
+  HRESULT hr = buffer->get_Length(size);
   if (hr != S_OK)
     return false;
 
-  byte *data;
-  hr = buffer_access->Buffer(&data);
+  ComPtr<Windows::Storage::Streams::IBufferByteAccess> buffer_access;
+  hr = buffer.As(&buffer_access);
   if (hr != S_OK)
     return false;
 
-  outbuffer->assign(data, data + size);
-  return true;
+  hr = buffer_access->Buffer(data);
+  return hr == S_OK;
 }
 
-CryptoWinRT::CryptoWinRT(Padding padding)
-    : padding_(padding) {}
+CryptoWinRT::CryptoWinRT(Padding padding,
+                         ChainMode mode,
+                         size_t key_cache_capacity)
+    : padding_(padding),
+      mode_(mode),
+      key_cache_(key_cache_capacity) {}
 
 CryptoWinRT::~CryptoWinRT() {
 }
@@ -80,8 +88,9 @@ bool CryptoWinRT::Initialize() {
     if (hr != S_OK)
       return false;
 
-    hr = provide_factory->OpenAlgorithm(HString::MakeReference(L"DES_ECB").Get(),
-                                        &provider_);
+    hr = provide_factory->OpenAlgorithm(
+        HString::MakeReference(mode_ == CBC ? L"DES_CBC" : L"DES_ECB").Get(),
+        &provider_);
     if (hr != S_OK)
       return false;
   }
@@ -94,85 +103,390 @@ bool CryptoWinRT::Initialize() {
   return hr == S_OK;
 }
 
-bool CryptoWinRT::DoCrypto(bool encrypt,
-                           const std::string &key,
-                           const std::string &input,
-                           std::string *output) {
-
-  if (!Initialize())
-    return false;
-
+KeyCache<ICryptographicKey>::Entry CryptoWinRT::CreateKey(std::string_view key) {
   Microsoft::WRL::ComPtr<ABI::Windows::Storage::Streams::IBuffer> key_buffer;
   if (!SetBuffer(key.data(), key.size(), buffer_factory_.Get(), &key_buffer))
-    return false;
+    return nullptr;
 
   ComPtr<ICryptographicKey> cryptographic_key;
   HRESULT hr = provider_->CreateSymmetricKey(key_buffer.Get(), &cryptographic_key);
   if (hr != S_OK)
-    return false;
+    return nullptr;
+  return KeyCache<ICryptographicKey>::Entry(cryptographic_key.Detach(),
+                                            [](ICryptographicKey *p) {
+                                              p->Release();
+                                            });
+}
 
-  Microsoft::WRL::ComPtr<ABI::Windows::Storage::Streams::IBuffer> input_buffer;
-  if (!SetBuffer(input.data(), input.size(), buffer_factory_.Get(), &input_buffer))
+bool CryptoWinRT::DoCrypto(bool encrypt,
+                           const std::string &key,
+                           IBuffer *iv,
+                           IBuffer *input,
+                           ComPtr<IBuffer> *output) {
+  KeyCache<ICryptographicKey>::Entry cryptographic_key = key_cache_.Get(
+      key,
+      [this](std::string_view raw_key) { return CreateKey(raw_key); });
+  if (!cryptographic_key)
     return false;
 
-  ComPtr<IBuffer> result;
+  HRESULT hr;
   if (encrypt) {
-    hr = engine_->Encrypt(cryptographic_key.Get(),
-                          input_buffer.Get(),
-                          nullptr, //ECB，不需要向量
-                          &result);
+    hr = engine_->Encrypt(cryptographic_key.get(),
+                          input,
+                          iv, //ECB时为nullptr
+                          output->ReleaseAndGetAddressOf());
   } else {
-    hr = engine_->Decrypt(cryptographic_key.Get(),
-                          input_buffer.Get(),
-                          nullptr, //ECB，不需要向量
-                          &result);
+    hr = engine_->Decrypt(cryptographic_key.get(),
+                          input,
+                          iv, //ECB时为nullptr
+                          output->ReleaseAndGetAddressOf());
   }
-  if (hr != S_OK)
+  return hr == S_OK;
+}
+
+bool CryptoWinRT::CtrCrypt(const std::string &key,
+                           std::span<const uint8_t> iv,
+                           std::span<const uint8_t> in,
+                           std::span<uint8_t> out) {
+  size_t blocks = (in.size() + DES_BLOCK_SIZE - 1) / DES_BLOCK_SIZE;
+  Microsoft::WRL::ComPtr<ABI::Windows::Storage::Streams::IBuffer> counter_buffer;
+  byte *counters;
+  if (!CreateBuffer(blocks * DES_BLOCK_SIZE, buffer_factory_.Get(),
+                    &counter_buffer, &counters))
+    return false;
+  uint8_t counter[DES_BLOCK_SIZE];
+  memcpy(counter, iv.data(), DES_BLOCK_SIZE);
+  FillCounterBlocks(counter, DES_BLOCK_SIZE, counters, blocks);
+
+  ComPtr<IBuffer> result;
+  if (!DoCrypto(true, key, nullptr, counter_buffer.Get(), &result))
+    return false;
+
+  byte *keystream;
+  UINT32 size;
+  if (!GetBufferBytes(result, &keystream, &size) || size < in.size())
     return false;
-  return GetBuffer(result, output);
+  XorBytes(in.data(), keystream, out.data(), in.size());
+  return true;
+}
+
+size_t CryptoWinRT::RequiredOutputSize(size_t plaintext_size) const {
+  if (mode_ == CTR)
+    return plaintext_size;
+  return PaddedSize(padding_, plaintext_size, DES_BLOCK_SIZE);
 }
 
 bool CryptoWinRT::Encrypt(const std::string &key,
                           const std::string &plaintext,
                           std::string *ciphertext) {
-  int pad = plaintext.size() % DES_BLOCK_SIZE;
-  size_t buffer_size = plaintext.size();
-  if (padding_ == PKCS5 || pad > 0) {
-    buffer_size += (DES_BLOCK_SIZE - pad);
-  }
-  std::string input(plaintext);
-  if (padding_ == PKCS5) {
-    //需要补齐
-    for (int i = plaintext.size(); i < buffer_size; ++i) {
-      input += (pad ? (DES_BLOCK_SIZE - pad) : 0x08);
-    }
-  }
-  return DoCrypto(true, key, input, ciphertext);
+  return Encrypt(key, std::string(), plaintext, ciphertext);
+}
+
+bool CryptoWinRT::Decrypt(const std::string &key,
+                          const std::string &ciphertext,
+                          std::string *plaintext) {
+  return Decrypt(key, std::string(), ciphertext, plaintext);
+}
+
+bool CryptoWinRT::Encrypt(const std::string &key,
+                          const std::string &iv,
+                          const std::string &plaintext,
+                          std::string *ciphertext) {
+  ciphertext->resize(RequiredOutputSize(plaintext.size()));
+  size_t size = 0;
+  bool result = Encrypt(
+      key,
+      std::span<const uint8_t>(reinterpret_cast<const uint8_t *>(iv.data()),
+                               iv.size()),
+      std::span<const uint8_t>(
+          reinterpret_cast<const uint8_t *>(plaintext.data()), plaintext.size()),
+      std::span<uint8_t>(reinterpret_cast<uint8_t *>(ciphertext->data()),
+                         ciphertext->size()),
+      &size);
+  ciphertext->resize(size);
+  return result;
 }
 
 bool CryptoWinRT::Decrypt(const std::string &key,
+                          const std::string &iv,
                           const std::string &ciphertext,
                           std::string *plaintext) {
+  plaintext->resize(ciphertext.size());
+  size_t size = 0;
+  bool result = Decrypt(
+      key,
+      std::span<const uint8_t>(reinterpret_cast<const uint8_t *>(iv.data()),
+                               iv.size()),
+      std::span<const uint8_t>(
+          reinterpret_cast<const uint8_t *>(ciphertext.data()), ciphertext.size()),
+      std::span<uint8_t>(reinterpret_cast<uint8_t *>(plaintext->data()),
+                         plaintext->size()),
+      &size);
+  plaintext->resize(size);
+  return result;
+}
+
+bool CryptoWinRT::Encrypt(const std::string &key,
+                          std::span<const uint8_t> plaintext,
+                          std::span<uint8_t> ciphertext,
+                          size_t *written) {
+  return Encrypt(key, std::span<const uint8_t>(), plaintext, ciphertext,
+                 written);
+}
+
+bool CryptoWinRT::Decrypt(const std::string &key,
+                          std::span<const uint8_t> ciphertext,
+                          std::span<uint8_t> plaintext,
+                          size_t *written) {
+  return Decrypt(key, std::span<const uint8_t>(), ciphertext, plaintext,
+                 written);
+}
+
+bool CryptoWinRT::Encrypt(const std::string &key,
+                          std::span<const uint8_t> iv,
+                          std::span<const uint8_t> plaintext,
+                          std::span<uint8_t> ciphertext,
+                          size_t *written) {
+  *written = 0;
+  if (!IsValidIv(mode_, iv.size(), DES_BLOCK_SIZE) || !Initialize())
+    return false;
+
+  size_t buffer_size = RequiredOutputSize(plaintext.size());
+  if (ciphertext.size() < buffer_size)
+    return false;
+
+  if (mode_ == CTR) {
+    if (!plaintext.empty() && !CtrCrypt(key, iv, plaintext, ciphertext))
+      return false;
+    *written = buffer_size;
+    return true;
+  }
+
+  Microsoft::WRL::ComPtr<ABI::Windows::Storage::Streams::IBuffer> iv_buffer;
+  if (mode_ == CBC &&
+      !SetBuffer(reinterpret_cast<const char *>(iv.data()), iv.size(),
+                 buffer_factory_.Get(), &iv_buffer))
+    return false;
+
+  //直接在IBuffer里补齐，不再经过std::string
+  Microsoft::WRL::ComPtr<ABI::Windows::Storage::Streams::IBuffer> input_buffer;
+  byte *input;
+  if (!CreateBuffer(buffer_size, buffer_factory_.Get(), &input_buffer, &input))
+    return false;
+  if (!plaintext.empty())
+    memcpy(input, plaintext.data(), plaintext.size());
+  ApplyPadding(padding_, input, plaintext.size(), buffer_size);
+
+  ComPtr<IBuffer> result;
+  if (!DoCrypto(true, key, iv_buffer.Get(), input_buffer.Get(), &result))
+    return false;
+
+  byte *data;
+  UINT32 size;
+  if (!GetBufferBytes(result, &data, &size) || size > ciphertext.size())
+    return false;
+  memcpy(ciphertext.data(), data, size);
+  *written = size;
+  return true;
+}
+
+bool CryptoWinRT::Decrypt(const std::string &key,
+                          std::span<const uint8_t> iv,
+                          std::span<const uint8_t> ciphertext,
+                          std::span<uint8_t> plaintext,
+                          size_t *written) {
+  *written = 0;
+  if (!IsValidIv(mode_, iv.size(), DES_BLOCK_SIZE) || !Initialize())
+    return false;
 
   size_t cipher_text_size = ciphertext.size();
-  std::string output;
-  if (!DoCrypto(false, key, ciphertext, &output))
+  if (plaintext.size() < cipher_text_size)
+    return false;
+
+  if (mode_ == CTR) {
+    if (cipher_text_size > 0 && !CtrCrypt(key, iv, ciphertext, plaintext))
+      return false;
+    *written = cipher_text_size;
+    return true;
+  }
+
+  Microsoft::WRL::ComPtr<ABI::Windows::Storage::Streams::IBuffer> iv_buffer;
+  if (mode_ == CBC &&
+      !SetBuffer(reinterpret_cast<const char *>(iv.data()), iv.size(),
+                 buffer_factory_.Get(), &iv_buffer))
+    return false;
+
+  Microsoft::WRL::ComPtr<ABI::Windows::Storage::Streams::IBuffer> input_buffer;
+  if (!SetBuffer(reinterpret_cast<const char *>(ciphertext.data()),
+                 cipher_text_size,
+                 buffer_factory_.Get(),
+                 &input_buffer))
+    return false;
+
+  ComPtr<IBuffer> result;
+  if (!DoCrypto(false, key, iv_buffer.Get(), input_buffer.Get(), &result))
+    return false;
+
+  byte *data;
+  UINT32 size;
+  if (!GetBufferBytes(result, &data, &size) || size > plaintext.size())
+    return false;
+  memcpy(plaintext.data(), data, size);
+  *written = size - PaddingLength(padding_, plaintext.data(), size);
+  return true;
+}
+
+WinRTDesBackend::WinRTDesBackend(size_t key_cache_capacity)
+    : key_cache_(key_cache_capacity) {}
+
+bool WinRTDesBackend::Initialize(ChainMode mode) {
+  HRESULT hr =
+      GetActivationFactory(HString::MakeReference(RuntimeClass_Windows_Security_Cryptography_Core_CryptographicEngine).Get(),
+                           &engine_);
+  if (hr != S_OK)
+    return false;
+
+  ComPtr<ISymmetricKeyAlgorithmProviderStatics> provide_factory;
+  hr = GetActivationFactory(HString::MakeReference(
+      RuntimeClass_Windows_Security_Cryptography_Core_SymmetricKeyAlgorithmProvider).Get(),
+                            &provide_factory);
+  if (hr != S_OK)
     return false;
 
-  uint8_t unpad = 0;
-  if (padding_ == PKCS5) {
-    unpad = output[cipher_text_size - 1];
-    if (unpad > cipher_text_size)
-      unpad = 0;
+  hr = provide_factory->OpenAlgorithm(
+      HString::MakeReference(mode == CBC ? L"DES_CBC" : L"DES_ECB").Get(),
+      &provider_);
+  if (hr != S_OK)
+    return false;
+
+  hr =
+      Windows::Foundation::GetActivationFactory(HString::MakeReference(RuntimeClass_Windows_Storage_Streams_Buffer).Get(),
+                                                &buffer_factory_);
+  return hr == S_OK;
+}
+
+WinRTDesBackend::Key WinRTDesBackend::GetKey(std::string_view key) {
+  return key_cache_.Get(key, [this](std::string_view raw_key) -> Key {
+    Microsoft::WRL::ComPtr<ABI::Windows::Storage::Streams::IBuffer> key_buffer;
+    if (!SetBuffer(raw_key.data(), raw_key.size(), buffer_factory_.Get(),
+                   &key_buffer))
+      return nullptr;
+
+    ComPtr<ICryptographicKey> cryptographic_key;
+    HRESULT hr = provider_->CreateSymmetricKey(key_buffer.Get(),
+                                               &cryptographic_key);
+    if (hr != S_OK)
+      return nullptr;
+    return Key(cryptographic_key.Detach(), [](ICryptographicKey *p) {
+      p->Release();
+    });
+  });
+}
+
+bool WinRTDesBackend::Crypt(bool encrypt,
+                            const Key &key,
+                            uint8_t *iv,
+                            const uint8_t *in,
+                            uint8_t *out,
+                            size_t size) {
+  Microsoft::WRL::ComPtr<ABI::Windows::Storage::Streams::IBuffer> iv_buffer;
+  if (iv && !SetBuffer(reinterpret_cast<const char *>(iv), BLOCK_SIZE,
+                       buffer_factory_.Get(), &iv_buffer))
+    return false;
+
+  Microsoft::WRL::ComPtr<ABI::Windows::Storage::Streams::IBuffer> input_buffer;
+  if (!SetBuffer(reinterpret_cast<const char *>(in), size,
+                 buffer_factory_.Get(), &input_buffer))
+    return false;
+
+  // Taken before |out| may overwrite |in|.
+  uint8_t next_iv[BLOCK_SIZE];
+  if (iv && !encrypt)
+    memcpy(next_iv, in + size - BLOCK_SIZE, BLOCK_SIZE);
+
+  ComPtr<IBuffer> result;
+  HRESULT hr;
+  if (encrypt) {
+    hr = engine_->Encrypt(key.get(), input_buffer.Get(), iv_buffer.Get(),
+                          result.ReleaseAndGetAddressOf());
   } else {
-    for (int i = cipher_text_size - 1; i > 0; i--) {
-      if (output[i] > 0)
-        break;
-      ++unpad;
-    }
+    hr = engine_->Decrypt(key.get(), input_buffer.Get(), iv_buffer.Get(),
+                          result.ReleaseAndGetAddressOf());
   }
-  plaintext->clear();
-  plaintext->append(output.data(), output.data() + cipher_text_size - unpad);
+  if (hr != S_OK)
+    return false;
+
+  byte *data;
+  UINT32 length;
+  if (!GetBufferBytes(result, &data, &length) || length != size)
+    return false;
+  memcpy(out, data, size);
+  if (iv)
+    memcpy(iv, encrypt ? out + size - BLOCK_SIZE : next_iv, BLOCK_SIZE);
   return true;
 }
+
+bool WinRTDesBackend::CtrCrypt(const Key &key,
+                               uint8_t *counter,
+                               const uint8_t *in,
+                               uint8_t *out,
+                               size_t size) {
+  size_t blocks = (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  Microsoft::WRL::ComPtr<ABI::Windows::Storage::Streams::IBuffer> counter_buffer;
+  byte *counters;
+  if (!CreateBuffer(blocks * BLOCK_SIZE, buffer_factory_.Get(),
+                    &counter_buffer, &counters))
+    return false;
+  FillCounterBlocks(counter, BLOCK_SIZE, counters, blocks);
+
+  ComPtr<IBuffer> result;
+  HRESULT hr = engine_->Encrypt(key.get(), counter_buffer.Get(), nullptr,
+                                result.ReleaseAndGetAddressOf());
+  if (hr != S_OK)
+    return false;
+
+  byte *keystream;
+  UINT32 length;
+  if (!GetBufferBytes(result, &keystream, &length) || length < size)
+    return false;
+  XorBytes(in, keystream, out, size);
+  return true;
+}
+
+template <ChainMode Mode>
+bool WinRTDesBackend::Encrypt(const Key &key,
+                              uint8_t *iv,
+                              const uint8_t *in,
+                              uint8_t *out,
+                              size_t size) {
+  if constexpr (Mode == CTR)
+    return CtrCrypt(key, iv, in, out, size);
+  else
+    return Crypt(true, key, iv, in, out, size);
+}
+
+template <ChainMode Mode>
+bool WinRTDesBackend::Decrypt(const Key &key,
+                              uint8_t *iv,
+                              const uint8_t *in,
+                              uint8_t *out,
+                              size_t size) {
+  if constexpr (Mode == CTR)
+    return CtrCrypt(key, iv, in, out, size);
+  else
+    return Crypt(false, key, iv, in, out, size);
+}
+
+template bool WinRTDesBackend::Encrypt<ECB>(const Key &, uint8_t *,
+                                            const uint8_t *, uint8_t *, size_t);
+template bool WinRTDesBackend::Encrypt<CBC>(const Key &, uint8_t *,
+                                            const uint8_t *, uint8_t *, size_t);
+template bool WinRTDesBackend::Encrypt<CTR>(const Key &, uint8_t *,
+                                            const uint8_t *, uint8_t *, size_t);
+template bool WinRTDesBackend::Decrypt<ECB>(const Key &, uint8_t *,
+                                            const uint8_t *, uint8_t *, size_t);
+template bool WinRTDesBackend::Decrypt<CBC>(const Key &, uint8_t *,
+                                            const uint8_t *, uint8_t *, size_t);
+template bool WinRTDesBackend::Decrypt<CTR>(const Key &, uint8_t *,
+                                            const uint8_t *, uint8_t *, size_t);
 } //cryto
\ No newline at end of file
@@ -1,7 +1,9 @@
 ﻿#ifndef DES_H_
 #define DES_H_
 
+#include <span>
 #include <string>
+#include <string_view>
 #include <windows.security.cryptography.h>
 #include <windows.security.cryptography.core.h>
 #include <windows.security.cryptography.certificates.h>
@@ -12,6 +14,9 @@
 #include <stdio.h>
 #include <Objbase.h>
 #include <robuffer.h>
+#include "../3des_cng/chain_mode.h"
+#include "../3des_cng/key_cache.h"
+#include "../3des_cng/padding.h"
 
 using namespace ABI::Windows::Foundation;
 using namespace Microsoft::WRL;
@@ -22,14 +27,13 @@ using namespace ABI::Windows::Security::Cryptography::Core;
 using namespace ABI::Windows::Storage::Streams;
 
 namespace crypto {
-enum Padding {
-  NOPKCS,
-  PKCS5
-};
 
 class CryptoWinRT {
 public:
-  explicit CryptoWinRT(Padding padding);
+  // CBC opens "DES_CBC"; CTR encrypts counter blocks with "DES_ECB".
+  explicit CryptoWinRT(Padding padding,
+                       ChainMode mode = ECB,
+                       size_t key_cache_capacity = DEFAULT_KEY_CACHE_CAPACITY);
 
   virtual ~CryptoWinRT();
 
@@ -40,13 +44,67 @@ public:
   bool Decrypt(const std::string &key,
                const std::string &ciphertext,
                std::string *plaintext);
+
+  // CBC and CTR take an 8-byte |iv|; the overloads without one only work
+  // in ECB mode.
+  bool Encrypt(const std::string &key,
+               const std::string &iv,
+               const std::string &plaintext,
+               std::string *ciphertext);
+
+  bool Decrypt(const std::string &key,
+               const std::string &iv,
+               const std::string &ciphertext,
+               std::string *plaintext);
+
+  // Ciphertext size for |plaintext_size| bytes of input.
+  size_t RequiredOutputSize(size_t plaintext_size) const;
+
+  // Span variants: the padded plaintext is written straight into the
+  // IBuffer handed to the engine and the result is copied once into the
+  // caller's buffer. |ciphertext| must hold RequiredOutputSize() bytes and
+  // |plaintext| must hold ciphertext.size() bytes.
+  bool Encrypt(const std::string &key,
+               std::span<const uint8_t> plaintext,
+               std::span<uint8_t> ciphertext,
+               size_t *written);
+
+  bool Decrypt(const std::string &key,
+               std::span<const uint8_t> ciphertext,
+               std::span<uint8_t> plaintext,
+               size_t *written);
+
+  bool Encrypt(const std::string &key,
+               std::span<const uint8_t> iv,
+               std::span<const uint8_t> plaintext,
+               std::span<uint8_t> ciphertext,
+               size_t *written);
+
+  bool Decrypt(const std::string &key,
+               std::span<const uint8_t> iv,
+               std::span<const uint8_t> ciphertext,
+               std::span<uint8_t> plaintext,
+               size_t *written);
+
+  KeyCache<ICryptographicKey> &key_cache() { return key_cache_; }
 private:
   bool Initialize();
 
+  KeyCache<ICryptographicKey>::Entry CreateKey(std::string_view key);
+
+  // |iv| is null for ECB.
   bool DoCrypto(bool encrypt,
                 const std::string &key,
-                const std::string &input,
-                std::string *output);
+                IBuffer *iv,
+                IBuffer *input,
+                ComPtr<IBuffer> *output);
+
+  // Encrypts the counter blocks starting at |iv| in one call and XORs the
+  // keystream over |in|.
+  bool CtrCrypt(const std::string &key,
+                std::span<const uint8_t> iv,
+                std::span<const uint8_t> in,
+                std::span<uint8_t> out);
 
   ComPtr<ICryptographicEngineStatics> engine_;
 
@@ -55,6 +113,65 @@ private:
   Microsoft::WRL::ComPtr<ABI::Windows::Storage::Streams::IBufferFactory> buffer_factory_;
 
   Padding padding_;
+
+  ChainMode mode_;
+
+  KeyCache<ICryptographicKey> key_cache_;
+};
+
+// Backend policy for BlockCipher (3des_cng/block_cipher.h) on the WinRT
+// engine, with the same algorithms and key handling as CryptoWinRT.
+class WinRTDesBackend {
+public:
+  typedef KeyCache<ICryptographicKey>::Entry Key;
+
+  static constexpr size_t BLOCK_SIZE = 8;
+
+  explicit WinRTDesBackend(
+      size_t key_cache_capacity = DEFAULT_KEY_CACHE_CAPACITY);
+
+  bool Initialize(ChainMode mode);
+
+  Key GetKey(std::string_view key);
+
+  template <ChainMode Mode>
+  bool Encrypt(const Key &key,
+               uint8_t *iv,
+               const uint8_t *in,
+               uint8_t *out,
+               size_t size);
+
+  template <ChainMode Mode>
+  bool Decrypt(const Key &key,
+               uint8_t *iv,
+               const uint8_t *in,
+               uint8_t *out,
+               size_t size);
+
+  KeyCache<ICryptographicKey> &key_cache() { return key_cache_; }
+private:
+  // One engine call over whole blocks; |iv| is null for ECB and is set to
+  // the last ciphertext block for CBC, which the engine does not return.
+  bool Crypt(bool encrypt,
+             const Key &key,
+             uint8_t *iv,
+             const uint8_t *in,
+             uint8_t *out,
+             size_t size);
+
+  bool CtrCrypt(const Key &key,
+                uint8_t *counter,
+                const uint8_t *in,
+                uint8_t *out,
+                size_t size);
+
+  ComPtr<ICryptographicEngineStatics> engine_;
+
+  ComPtr<ISymmetricKeyAlgorithmProvider> provider_;
+
+  Microsoft::WRL::ComPtr<ABI::Windows::Storage::Streams::IBufferFactory> buffer_factory_;
+
+  KeyCache<ICryptographicKey> key_cache_;
 };
 } //crypto
 
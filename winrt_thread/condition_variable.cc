@@ -0,0 +1,43 @@
+﻿#include "condition_variable.h"
+#include "futex.h"
+#if defined(_WIN32)
+#include "pch.h"
+#endif
+
+namespace base {
+
+void ConditionVariable::Wait() {
+  // Registered before the sequence is read: a Signal() that comes after
+  // either sees the waiter or changes the value it is about to sleep on.
+  waiters_.fetch_add(1, std::memory_order_seq_cst);
+  int32_t sequence = sequence_.load(std::memory_order_seq_cst);
+  user_lock_->Release();
+  FutexWait(&sequence_, sequence);
+  waiters_.fetch_sub(1, std::memory_order_relaxed);
+  user_lock_->AcquireAfterWait();
+}
+
+bool ConditionVariable::TimedWait(std::chrono::nanoseconds max_time) {
+  waiters_.fetch_add(1, std::memory_order_seq_cst);
+  int32_t sequence = sequence_.load(std::memory_order_seq_cst);
+  user_lock_->Release();
+  FutexWaitFor(&sequence_, sequence, max_time);
+  bool woken = sequence_.load(std::memory_order_relaxed) != sequence;
+  waiters_.fetch_sub(1, std::memory_order_relaxed);
+  user_lock_->AcquireAfterWait();
+  return woken;
+}
+
+void ConditionVariable::Signal() {
+  sequence_.fetch_add(1, std::memory_order_seq_cst);
+  if (waiters_.load(std::memory_order_seq_cst) > 0)
+    FutexWakeOne(&sequence_);
+}
+
+void ConditionVariable::Broadcast() {
+  sequence_.fetch_add(1, std::memory_order_seq_cst);
+  if (waiters_.load(std::memory_order_seq_cst) > 0)
+    FutexWakeAll(&sequence_);
+}
+
+}  // namespace base
\ No newline at end of file
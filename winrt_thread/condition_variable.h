@@ -0,0 +1,44 @@
+﻿#ifndef CONDITION_VARIABLE_H_
+#define CONDITION_VARIABLE_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+
+#include "lock.h"
+
+namespace base {
+
+// Condition variable over a Lock, as a futex sequence number: waiters
+// sleep on the value they saw, Signal() and Broadcast() bump it. Neither
+// enters the kernel while nobody waits.
+//
+// Wakeups can be spurious, so wait in a loop on the actual condition.
+class ConditionVariable {
+public:
+  explicit ConditionVariable(Lock *user_lock)
+      : user_lock_(user_lock), sequence_(0), waiters_(0) {}
+
+  ConditionVariable(const ConditionVariable &) = delete;
+  ConditionVariable &operator=(const ConditionVariable &) = delete;
+
+  // Called with the lock held; releases it while blocked and holds it
+  // again on return.
+  void Wait();
+
+  // As Wait(); false once |max_time| has passed without a wakeup.
+  bool TimedWait(std::chrono::nanoseconds max_time);
+
+  void Signal();
+  void Broadcast();
+
+private:
+  Lock *const user_lock_;
+  std::atomic<int32_t> sequence_;
+  std::atomic<int32_t> waiters_;
+};
+
+}  // namespace base
+
+#endif  // CONDITION_VARIABLE_H_
\ No newline at end of file
@@ -0,0 +1,288 @@
+﻿#include "cpu_topology.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <thread>
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#if defined(_WIN32)
+#include "pch.h"
+#endif
+
+namespace base {
+
+namespace {
+
+const size_t kDefaultL2CacheSize = 256 * 1024;
+
+#if defined(__linux__)
+// From <linux/mempolicy.h>; spelled out to avoid depending on libnuma.
+const int kMpolPreferred = 1;
+const int kMaxNodes = 1024;
+const int kBitsPerWord = 8 * sizeof(unsigned long);
+
+// Parses a sysfs list such as "0-3,8-11". Empty if |path| is missing.
+std::vector<int> ReadCpuList(const char *path) {
+  std::vector<int> cpus;
+  FILE *file = fopen(path, "r");
+  if (!file)
+    return cpus;
+  int first, last;
+  while (fscanf(file, "%d", &first) == 1) {
+    last = first;
+    int c = fgetc(file);
+    if (c == '-') {
+      if (fscanf(file, "%d", &last) != 1)
+        break;
+      c = fgetc(file);
+    }
+    for (int cpu = first; cpu <= last; cpu++)
+      cpus.push_back(cpu);
+    if (c != ',')
+      break;
+  }
+  fclose(file);
+  return cpus;
+}
+
+// Position of |cpu| among the hardware threads of its core.
+int SiblingRank(int cpu) {
+  char path[128];
+  snprintf(path, sizeof(path),
+           "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+  std::vector<int> siblings = ReadCpuList(path);
+  std::vector<int>::iterator it =
+      std::find(siblings.begin(), siblings.end(), cpu);
+  return it == siblings.end() ? 0 : static_cast<int>(it - siblings.begin());
+}
+
+void SortByCore(std::vector<int> *cpus) {
+  std::vector<std::pair<int, int>> ranked;
+  for (int cpu : *cpus)
+    ranked.push_back(std::make_pair(SiblingRank(cpu), cpu));
+  std::sort(ranked.begin(), ranked.end());
+  for (size_t i = 0; i < ranked.size(); i++)
+    (*cpus)[i] = ranked[i].second;
+}
+
+// Size of cpu0's level 2 data or unified cache, or 0.
+size_t ReadL2CacheSize() {
+  for (int index = 0; index < 16; index++) {
+    char path[96];
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu0/cache/index%d/level", index);
+    FILE *file = fopen(path, "r");
+    if (!file)
+      break;
+    int level = 0;
+    bool parsed = fscanf(file, "%d", &level) == 1;
+    fclose(file);
+    if (!parsed || level != 2)
+      continue;
+
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu0/cache/index%d/type", index);
+    file = fopen(path, "r");
+    char type[32] = {};
+    if (file) {
+      parsed = fscanf(file, "%31s", type) == 1;
+      fclose(file);
+    }
+    if (strcmp(type, "Instruction") == 0)
+      continue;
+
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu0/cache/index%d/size", index);
+    file = fopen(path, "r");
+    if (!file)
+      continue;
+    unsigned long size = 0;
+    char unit = 0;
+    int fields = fscanf(file, "%lu%c", &size, &unit);
+    fclose(file);
+    if (fields < 1)
+      continue;
+    if (unit == 'K')
+      size *= 1024;
+    else if (unit == 'M')
+      size *= 1024 * 1024;
+    return size;
+  }
+  return 0;
+}
+
+bool SetNodeMask(int node, unsigned long *mask) {
+  if (node < 0 || node >= kMaxNodes)
+    return false;
+  std::fill(mask, mask + kMaxNodes / kBitsPerWord, 0UL);
+  mask[node / kBitsPerWord] |= 1UL << (node % kBitsPerWord);
+  return true;
+}
+#elif defined(_WIN32)
+size_t ReadL2CacheSize() {
+  DWORD bytes = 0;
+  GetLogicalProcessorInformation(nullptr, &bytes);
+  std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> info(
+      bytes / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+  if (info.empty() || !GetLogicalProcessorInformation(info.data(), &bytes))
+    return 0;
+  for (const SYSTEM_LOGICAL_PROCESSOR_INFORMATION &entry : info) {
+    if (entry.Relationship == RelationCache && entry.Cache.Level == 2 &&
+        entry.Cache.Type != CacheInstruction)
+      return entry.Cache.Size;
+  }
+  return 0;
+}
+#else
+size_t ReadL2CacheSize() {
+  return 0;
+}
+#endif
+
+}  // namespace
+
+// static
+const CpuTopology &CpuTopology::Get() {
+  static const CpuTopology topology;
+  return topology;
+}
+
+CpuTopology::CpuTopology() : l2_cache_size_(ReadL2CacheSize()) {
+  if (l2_cache_size_ == 0)
+    l2_cache_size_ = kDefaultL2CacheSize;
+#if defined(__linux__)
+  cpu_set_t allowed;
+  bool have_allowed = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+  for (int id = 0; id < kMaxNodes; id++) {
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist",
+             id);
+    std::vector<int> cpus = ReadCpuList(path);
+    if (cpus.empty())
+      continue;
+    Node node;
+    node.id = id;
+    for (int cpu : cpus) {
+      if (!have_allowed || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)))
+        node.cpus.push_back(cpu);
+    }
+    if (node.cpus.empty())
+      continue;
+    SortByCore(&node.cpus);
+    nodes_.push_back(node);
+  }
+#endif
+  if (nodes_.empty()) {
+    // No NUMA information: one node with every CPU.
+    Node node;
+    node.id = 0;
+    int count = static_cast<int>(std::thread::hardware_concurrency());
+    for (int cpu = 0; cpu < std::max(count, 1); cpu++)
+      node.cpus.push_back(cpu);
+    nodes_.push_back(node);
+  }
+}
+
+int CpuTopology::num_cpus() const {
+  int count = 0;
+  for (const Node &node : nodes_)
+    count += static_cast<int>(node.cpus.size());
+  return count;
+}
+
+const CpuTopology::Node *CpuTopology::FindNode(int id) const {
+  for (const Node &node : nodes_) {
+    if (node.id == id)
+      return &node;
+  }
+  return nullptr;
+}
+
+std::vector<ThreadOptions> PlanThreadPlacement(int count,
+                                               ThreadPlacement placement,
+                                               bool pin_to_cpu,
+                                               ThreadPriority priority) {
+  std::vector<ThreadOptions> plan(count > 0 ? count : 0);
+  for (ThreadOptions &options : plan)
+    options.priority = priority;
+  if (placement == ThreadPlacement::NONE)
+    return plan;
+
+  const std::vector<CpuTopology::Node> &nodes = CpuTopology::Get().nodes();
+  int node_count = static_cast<int>(nodes.size());
+  int total = CpuTopology::Get().num_cpus();
+  for (int i = 0; i < count; i++) {
+    const CpuTopology::Node *node;
+    int cpu_index;
+    if (placement == ThreadPlacement::SPREAD) {
+      node = &nodes[i % node_count];
+      cpu_index = (i / node_count) % static_cast<int>(node->cpus.size());
+    } else {
+      // Position in the nodes' CPU lists laid end to end.
+      cpu_index = i % total;
+      int n = 0;
+      while (cpu_index >= static_cast<int>(nodes[n].cpus.size())) {
+        cpu_index -= static_cast<int>(nodes[n].cpus.size());
+        n++;
+      }
+      node = &nodes[n];
+    }
+    plan[i].numa_node = node->id;
+    if (pin_to_cpu)
+      plan[i].cpus.push_back(node->cpus[cpu_index]);
+    else
+      plan[i].cpus = node->cpus;
+  }
+  return plan;
+}
+
+bool SetCurrentThreadPreferredNode(int node) {
+#if defined(__linux__)
+  unsigned long mask[kMaxNodes / kBitsPerWord];
+  if (!SetNodeMask(node, mask))
+    return false;
+  // The kernel reads one bit less than |maxnode|.
+  return syscall(SYS_set_mempolicy, kMpolPreferred, mask,
+                 static_cast<unsigned long>(kMaxNodes + 1)) == 0;
+#else
+  return false;
+#endif
+}
+
+void *AllocateNodeLocal(size_t size, int node) {
+  if (size == 0)
+    return nullptr;
+#if defined(__linux__)
+  void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED)
+    return nullptr;
+  unsigned long mask[kMaxNodes / kBitsPerWord];
+  // Before first touch, so every page is placed by the policy. A failure
+  // leaves ordinary first-touch placement.
+  if (SetNodeMask(node, mask)) {
+    syscall(SYS_mbind, memory, size, kMpolPreferred, mask,
+            static_cast<unsigned long>(kMaxNodes + 1), 0);
+  }
+  return memory;
+#else
+  return malloc(size);
+#endif
+}
+
+void FreeNodeLocal(void *memory, size_t size) {
+  if (!memory)
+    return;
+#if defined(__linux__)
+  munmap(memory, size);
+#else
+  free(memory);
+#endif
+}
+
+}  // namespace base
\ No newline at end of file
@@ -0,0 +1,79 @@
+﻿#ifndef CPU_TOPOLOGY_H_
+#define CPU_TOPOLOGY_H_
+
+#include <stddef.h>
+
+#include <vector>
+
+#include "platform_thread.h"
+
+namespace base {
+
+// The logical CPUs this process may run on, grouped by NUMA node, and the
+// L2 cache size. Read once from sysfs on Linux, honouring the process
+// affinity mask; elsewhere a single node 0 holding hardware_concurrency()
+// CPUs.
+class CpuTopology {
+public:
+  struct Node {
+    // The kernel's node number, as used by ThreadOptions::numa_node.
+    int id;
+    // One hardware thread of every core first, then their siblings, so a
+    // prefix of the list never puts two threads on one core.
+    std::vector<int> cpus;
+  };
+
+  static const CpuTopology &Get();
+
+  // Only nodes with at least one usable CPU; never empty.
+  const std::vector<Node> &nodes() const { return nodes_; }
+
+  int num_cpus() const;
+
+  // Null for a node without usable CPUs.
+  const Node *FindNode(int id) const;
+
+  // Per-core data or unified L2 cache of the first CPU, in bytes; 256 KB
+  // when the OS does not say.
+  size_t l2_cache_size() const { return l2_cache_size_; }
+
+private:
+  CpuTopology();
+
+  std::vector<Node> nodes_;
+  size_t l2_cache_size_;
+};
+
+enum class ThreadPlacement : int {
+  // Threads are left to the scheduler.
+  NONE,
+  // Round robin over the nodes, then over the cores of each node: spreads
+  // memory bandwidth and cache over all sockets.
+  SPREAD,
+  // Fills the cores of one node before using the next: keeps cooperating
+  // threads on a shared L3.
+  COMPACT,
+};
+
+// Options for |count| threads placed by |placement|. Each thread is bound
+// to its node's CPUs and prefers its node's memory; with |pin_to_cpu| it
+// is bound to a single CPU instead.
+std::vector<ThreadOptions> PlanThreadPlacement(int count,
+                                               ThreadPlacement placement,
+                                               bool pin_to_cpu,
+                                               ThreadPriority priority);
+
+// Makes |node| the preferred source of the calling thread's new pages.
+// False where NUMA policies are not supported.
+bool SetCurrentThreadPreferredNode(int node);
+
+// |size| bytes whose pages come from |node| when it has memory to spare,
+// or from anywhere for a negative |node| or without NUMA support. Release
+// with FreeNodeLocal() and the same size.
+void *AllocateNodeLocal(size_t size, int node);
+
+void FreeNodeLocal(void *memory, size_t size);
+
+}  // namespace base
+
+#endif  // CPU_TOPOLOGY_H_
\ No newline at end of file
@@ -0,0 +1,194 @@
+﻿#include "delayed_task_scheduler.h"
+#if defined(_WIN32)
+#include "pch.h"
+#endif
+
+namespace base {
+
+DelayedTaskScheduler::DelayedTaskScheduler(std::chrono::microseconds tick,
+                                           ThreadPriority priority)
+    : tick_(std::chrono::duration_cast<Clock::duration>(
+          tick.count() > 0 ? tick : std::chrono::microseconds(1))),
+      origin_(Clock::now()),
+      priority_(priority),
+      wake_(&lock_),
+      wheel_(0),
+      next_id_(1),
+      wake_tick_(TimerWheel::NO_EVENT),
+      running_(false),
+      stopping_(false),
+      thread_() {
+}
+
+DelayedTaskScheduler::~DelayedTaskScheduler() {
+  Stop();
+}
+
+bool DelayedTaskScheduler::Start() {
+  AutoLock lock(lock_);
+  if (running_)
+    return true;
+  stopping_ = false;
+  running_ = PlatformThread::CreateWithPriority(this, &thread_, priority_);
+  return running_;
+}
+
+void DelayedTaskScheduler::Stop() {
+  {
+    AutoLock lock(lock_);
+    if (!running_)
+      return;
+    stopping_ = true;
+  }
+  wake_.Signal();
+  PlatformThread::Join(thread_);
+
+  AutoLock lock(lock_);
+  for (auto &entry : entries_)
+    wheel_.Cancel(entry.second.get());
+  entries_.clear();
+  running_ = false;
+}
+
+DelayedTaskScheduler::TaskId DelayedTaskScheduler::PostDelayedTask(
+    Task task,
+    std::chrono::microseconds delay) {
+  return Post(std::move(task), delay, false);
+}
+
+DelayedTaskScheduler::TaskId DelayedTaskScheduler::PostRepeatingTask(
+    Task task,
+    std::chrono::microseconds interval) {
+  return Post(std::move(task), interval, true);
+}
+
+DelayedTaskScheduler::TaskId DelayedTaskScheduler::Post(
+    Task task,
+    std::chrono::microseconds delay,
+    bool repeating) {
+  if (delay.count() < 0)
+    delay = std::chrono::microseconds(0);
+  uint64_t expiry = ToTickRoundUp(Clock::now() + delay);
+
+  std::unique_ptr<Entry> entry(new Entry);
+  entry->interval = 0;
+  if (repeating) {
+    uint64_t ticks = ToTickRoundUp(origin_ + delay);
+    entry->interval = ticks > 0 ? ticks : 1;
+  }
+  entry->task = std::move(task);
+  entry->running = false;
+  entry->ran = false;
+  entry->cancelled = false;
+
+  bool wake;
+  TaskId id;
+  {
+    AutoLock lock(lock_);
+    id = next_id_++;
+    entry->id = id;
+    wheel_.Schedule(entry.get(), expiry);
+    wake = entry->expiry() < wake_tick_;
+    entries_[id] = std::move(entry);
+  }
+  if (wake)
+    wake_.Signal();
+  return id;
+}
+
+bool DelayedTaskScheduler::Cancel(TaskId id) {
+  AutoLock lock(lock_);
+  auto it = entries_.find(id);
+  if (it == entries_.end() || it->second->cancelled)
+    return false;
+  Entry *entry = it->second.get();
+  if (entry->running) {
+    // The timer thread frees it once its batch has run.
+    entry->cancelled = true;
+    return entry->interval != 0 || !entry->ran;
+  }
+  wheel_.Cancel(entry);
+  entries_.erase(it);
+  return true;
+}
+
+size_t DelayedTaskScheduler::pending_tasks() const {
+  AutoLock lock(lock_);
+  return wheel_.size();
+}
+
+uint64_t DelayedTaskScheduler::ToTick(Clock::time_point time) const {
+  if (time <= origin_)
+    return 0;
+  return static_cast<uint64_t>((time - origin_) / tick_);
+}
+
+uint64_t DelayedTaskScheduler::ToTickRoundUp(Clock::time_point time) const {
+  if (time <= origin_)
+    return 0;
+  return static_cast<uint64_t>((time - origin_ + tick_ - Clock::duration(1)) /
+                               tick_);
+}
+
+DelayedTaskScheduler::Clock::time_point DelayedTaskScheduler::ToTime(
+    uint64_t tick) const {
+  return origin_ + tick_ * static_cast<Clock::rep>(tick);
+}
+
+void DelayedTaskScheduler::ThreadMain() {
+  std::vector<TimerWheel::Timer *> expired;
+  AutoLock lock(lock_);
+  while (!stopping_) {
+    wheel_.Advance(ToTick(Clock::now()), &expired);
+    if (!expired.empty()) {
+      RunExpired(&expired);
+      continue;
+    }
+
+    wake_tick_ = wheel_.NextEventTick();
+    if (wake_tick_ == TimerWheel::NO_EVENT) {
+      wake_.Wait();
+    } else {
+      Clock::duration delay = ToTime(wake_tick_) - Clock::now();
+      if (delay > Clock::duration::zero())
+        wake_.TimedWait(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(delay));
+    }
+    wake_tick_ = TimerWheel::NO_EVENT;
+  }
+}
+
+void DelayedTaskScheduler::RunExpired(
+    std::vector<TimerWheel::Timer *> *expired) {
+  // Claimed first so that Cancel() flags rather than frees them, which
+  // also lets a task cancel a later one of the same batch.
+  for (TimerWheel::Timer *timer : *expired)
+    static_cast<Entry *>(timer)->running = true;
+
+  for (TimerWheel::Timer *timer : *expired) {
+    Entry *entry = static_cast<Entry *>(timer);
+    if (entry->cancelled)
+      continue;
+    entry->ran = true;
+    AutoUnlock unlock(lock_);
+    entry->task();
+  }
+
+  for (TimerWheel::Timer *timer : *expired) {
+    Entry *entry = static_cast<Entry *>(timer);
+    entry->running = false;
+    if (entry->interval == 0 || entry->cancelled) {
+      entries_.erase(entry->id);
+      continue;
+    }
+    uint64_t next = entry->expiry() + entry->interval;
+    uint64_t now = wheel_.now();
+    if (next <= now)
+      next += (now - next) / entry->interval * entry->interval +
+              entry->interval;
+    wheel_.Schedule(entry, next);
+  }
+  expired->clear();
+}
+
+}  // namespace base
\ No newline at end of file
@@ -0,0 +1,107 @@
+﻿#ifndef DELAYED_TASK_SCHEDULER_H_
+#define DELAYED_TASK_SCHEDULER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "condition_variable.h"
+#include "lock.h"
+#include "platform_thread.h"
+#include "timer_wheel.h"
+
+namespace base {
+
+// Runs tasks after a delay, once or repeatedly, all from a single timer
+// thread waiting on a TimerWheel. Thousands of pending timeouts cost one
+// thread and one list node each. Time is kept on the steady clock in
+// ticks of |tick| (100 us by default); a task never runs before its delay
+// has passed and normally runs within a tick of it.
+//
+// Tasks run on the timer thread and hold up every later task while they
+// run, so anything long should be handed on, e.g. to a WorkStealingPool.
+class DelayedTaskScheduler : public PlatformThread::Delegate {
+public:
+  typedef std::function<void()> Task;
+  // Zero is never a valid id.
+  typedef uint64_t TaskId;
+
+  explicit DelayedTaskScheduler(
+      std::chrono::microseconds tick = std::chrono::microseconds(100),
+      ThreadPriority priority = ThreadPriority::NORMAL);
+
+  ~DelayedTaskScheduler() override;
+
+  bool Start();
+
+  // Joins the timer thread; tasks still pending are dropped without
+  // running. Must not be called from a task.
+  void Stop();
+
+  // Runs |task| once, |delay| from now.
+  TaskId PostDelayedTask(Task task, std::chrono::microseconds delay);
+
+  // Runs |task| every |interval|, the first time |interval| from now, until
+  // cancelled. Runs keep to the original schedule; ones missed because
+  // the thread was busy are skipped rather than bunched up.
+  TaskId PostRepeatingTask(Task task, std::chrono::microseconds interval);
+
+  // Stops |id| from running again. Returns false if it already ran (for a
+  // one-shot task) or was cancelled. A run already in progress on the
+  // timer thread is not waited for.
+  bool Cancel(TaskId id);
+
+  size_t pending_tasks() const;
+
+  // Overridden from PlatformThread::Delegate:
+  void ThreadMain() override;
+
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Entry : public TimerWheel::Timer {
+    TaskId id;
+    uint64_t interval;
+    Task task;
+    // Taken off the wheel and waiting to run, or running.
+    bool running;
+    bool ran;
+    bool cancelled;
+  };
+
+  TaskId Post(Task task, std::chrono::microseconds delay, bool repeating);
+
+  // Ticks since |origin_|, rounded down or up.
+  uint64_t ToTick(Clock::time_point time) const;
+  uint64_t ToTickRoundUp(Clock::time_point time) const;
+  Clock::time_point ToTime(uint64_t tick) const;
+
+  // Runs |expired| with |lock_| released, then reschedules or frees them.
+  // Called with |lock_| held.
+  void RunExpired(std::vector<TimerWheel::Timer *> *expired);
+
+  const Clock::duration tick_;
+  const Clock::time_point origin_;
+  const ThreadPriority priority_;
+
+  mutable Lock lock_;
+  ConditionVariable wake_;
+  TimerWheel wheel_;
+  std::unordered_map<TaskId, std::unique_ptr<Entry>> entries_;
+  TaskId next_id_;
+  // Tick the timer thread is sleeping until, so that posts only wake it
+  // when they are due earlier.
+  uint64_t wake_tick_;
+  bool running_;
+  bool stopping_;
+  PlatformThreadHandle thread_;
+};
+
+}  // namespace base
+
+#endif  // DELAYED_TASK_SCHEDULER_H_
\ No newline at end of file
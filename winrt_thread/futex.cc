@@ -0,0 +1,120 @@
+﻿#include "futex.h"
+#include <thread>
+#if defined(_WIN32)
+#include <windows.h>
+#include "pch.h"
+#pragma comment(lib, "Synchronization.lib")
+#elif defined(__linux__)
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#endif
+
+namespace base {
+
+static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t),
+              "futex words are plain 32-bit integers");
+
+#if !defined(_WIN32) && !defined(__linux__)
+namespace {
+
+// Waiters on addresses that hash alike share a bucket, so a wake notifies
+// the whole bucket and the others see a spurious wakeup. Checking the
+// word under the bucket's mutex, which wakers also take, means a wake
+// between the check and the wait cannot be lost.
+struct alignas(64) WaitBucket {
+  std::mutex mutex;
+  std::condition_variable cv;
+};
+
+const size_t kWaitBuckets = 64;
+
+WaitBucket &BucketFor(const std::atomic<int32_t> *address) {
+  // Never destroyed: threads may still wake or wait during exit.
+  static WaitBucket *buckets = new WaitBucket[kWaitBuckets];
+  uintptr_t key = reinterpret_cast<uintptr_t>(address);
+  return buckets[(key >> 2) * 0x9E3779B97F4A7C15ull >> 58];
+}
+
+}  // namespace
+#endif
+
+void FutexWait(std::atomic<int32_t> *address, int32_t expected) {
+#if defined(_WIN32)
+  WaitOnAddress(address, &expected, sizeof(expected), INFINITE);
+#elif defined(__linux__)
+  syscall(SYS_futex, reinterpret_cast<int32_t *>(address),
+          FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+  WaitBucket &bucket = BucketFor(address);
+  std::unique_lock<std::mutex> lock(bucket.mutex);
+  if (address->load(std::memory_order_relaxed) == expected)
+    bucket.cv.wait(lock);
+#endif
+}
+
+void FutexWaitFor(std::atomic<int32_t> *address,
+                  int32_t expected,
+                  std::chrono::nanoseconds timeout) {
+  if (timeout <= std::chrono::nanoseconds::zero())
+    return;
+#if defined(_WIN32)
+  // Rounded up, so that a short wait does not turn into a poll; INFINITE
+  // is one past the longest finite wait.
+  int64_t ms = (timeout.count() + 999999) / 1000000;
+  DWORD wait = ms >= INFINITE ? INFINITE - 1 : static_cast<DWORD>(ms);
+  WaitOnAddress(address, &expected, sizeof(expected), wait);
+#elif defined(__linux__)
+  // Relative, on the monotonic clock.
+  timespec relative;
+  relative.tv_sec = static_cast<time_t>(timeout.count() / 1000000000);
+  relative.tv_nsec = static_cast<long>(timeout.count() % 1000000000);
+  syscall(SYS_futex, reinterpret_cast<int32_t *>(address),
+          FUTEX_WAIT_PRIVATE, expected, &relative, nullptr, 0);
+#else
+  WaitBucket &bucket = BucketFor(address);
+  std::unique_lock<std::mutex> lock(bucket.mutex);
+  if (address->load(std::memory_order_relaxed) == expected)
+    bucket.cv.wait_for(lock, timeout);
+#endif
+}
+
+void FutexWakeOne(std::atomic<int32_t> *address) {
+#if defined(_WIN32)
+  WakeByAddressSingle(address);
+#elif defined(__linux__)
+  syscall(SYS_futex, reinterpret_cast<int32_t *>(address),
+          FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+  // The bucket may be shared, so waking just one could pick a waiter on
+  // another address.
+  FutexWakeAll(address);
+#endif
+}
+
+void FutexWakeAll(std::atomic<int32_t> *address) {
+#if defined(_WIN32)
+  WakeByAddressAll(address);
+#elif defined(__linux__)
+  syscall(SYS_futex, reinterpret_cast<int32_t *>(address),
+          FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#else
+  WaitBucket &bucket = BucketFor(address);
+  {
+    std::lock_guard<std::mutex> lock(bucket.mutex);
+  }
+  bucket.cv.notify_all();
+#endif
+}
+
+int MaxSpinCount() {
+  static const int count = std::thread::hardware_concurrency() > 1 ? 100 : 0;
+  return count;
+}
+
+}  // namespace base
\ No newline at end of file
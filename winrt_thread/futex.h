@@ -0,0 +1,48 @@
+﻿#ifndef FUTEX_H_
+#define FUTEX_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#endif
+
+namespace base {
+
+// Blocks while |*address| == |expected|. May return early for no reason,
+// so callers re-check their condition in a loop. Linux futex(2) and
+// Windows WaitOnAddress; elsewhere a table of mutex and condition
+// variable pairs picked by address.
+void FutexWait(std::atomic<int32_t> *address, int32_t expected);
+
+// FutexWait() that also returns once |timeout| has passed.
+void FutexWaitFor(std::atomic<int32_t> *address,
+                  int32_t expected,
+                  std::chrono::nanoseconds timeout);
+
+// Wakes one or every thread blocked in FutexWait() on |address|.
+void FutexWakeOne(std::atomic<int32_t> *address);
+void FutexWakeAll(std::atomic<int32_t> *address);
+
+// How many times a waiter should poll before parking: spinning only pays
+// when the thread it waits for can run at the same time, so 0 on a
+// single-CPU machine.
+int MaxSpinCount();
+
+// Inside a polling loop: lets the other hyperthread run and saves power.
+inline void SpinPause() {
+#if defined(_M_X64) || defined(_M_IX86)
+  _mm_pause();
+#elif defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+  __asm__ __volatile__("yield");
+#endif
+}
+
+}  // namespace base
+
+#endif  // FUTEX_H_
\ No newline at end of file
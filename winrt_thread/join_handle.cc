@@ -0,0 +1,27 @@
+﻿#include "join_handle.h"
+#include "futex.h"
+#if defined(_WIN32)
+#include "pch.h"
+#endif
+
+namespace base {
+
+void JoinHandle::MarkDone() {
+  std::atomic<int32_t> *address = &state_;
+  if (state_.exchange(DONE, std::memory_order_acq_rel) == JOINING)
+    FutexWakeAll(address);
+}
+
+void JoinHandle::Join() {
+  for (int spins = MaxSpinCount(); spins > 0; spins--) {
+    if (IsDone())
+      return;
+    SpinPause();
+  }
+  int32_t state = RUNNING;
+  state_.compare_exchange_strong(state, JOINING, std::memory_order_acquire);
+  while (state_.load(std::memory_order_acquire) != DONE)
+    FutexWait(&state_, JOINING);
+}
+
+}  // namespace base
\ No newline at end of file
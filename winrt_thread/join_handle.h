@@ -0,0 +1,44 @@
+﻿#ifndef JOIN_HANDLE_H_
+#define JOIN_HANDLE_H_
+
+#include <stdint.h>
+
+#include <atomic>
+
+namespace base {
+
+// One-shot completion flag between a thread and the one joining it, in a
+// futex word instead of an event handle. The thread calls MarkDone() as
+// the last thing it does with the handle; Join() returns after that.
+class JoinHandle {
+public:
+  JoinHandle() : state_(RUNNING) {}
+
+  JoinHandle(const JoinHandle &) = delete;
+  JoinHandle &operator=(const JoinHandle &) = delete;
+
+  // Once, from the finishing thread. The handle may be destroyed by the
+  // joiner as soon as this has published the state; the wake that follows
+  // only uses the address, which the futex calls tolerate.
+  void MarkDone();
+
+  bool IsDone() const {
+    return state_.load(std::memory_order_acquire) == DONE;
+  }
+
+  void Join();
+
+private:
+  enum : int32_t {
+    RUNNING = 0,
+    // RUNNING, with a joiner parked.
+    JOINING = 1,
+    DONE = 2
+  };
+
+  std::atomic<int32_t> state_;
+};
+
+}  // namespace base
+
+#endif  // JOIN_HANDLE_H_
\ No newline at end of file
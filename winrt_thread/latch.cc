@@ -0,0 +1,35 @@
+﻿#include "latch.h"
+#include "futex.h"
+#if defined(_WIN32)
+#include "pch.h"
+#endif
+
+namespace base {
+
+void Latch::CountDown(int32_t n) {
+  // A waiter may return and destroy the latch once the count is zero, so
+  // only the address is used after that.
+  std::atomic<int32_t> *address = &count_;
+  int32_t old = count_.fetch_sub(n, std::memory_order_acq_rel);
+  if ((old & COUNT_MASK) == n && (old & WAITERS))
+    FutexWakeAll(address);
+}
+
+void Latch::Wait() {
+  for (int spins = MaxSpinCount(); spins > 0; spins--) {
+    if (TryWait())
+      return;
+    SpinPause();
+  }
+  int32_t count = count_.load(std::memory_order_acquire);
+  while ((count & COUNT_MASK) != 0) {
+    if (!(count & WAITERS) &&
+        !count_.compare_exchange_weak(count, count | WAITERS,
+                                      std::memory_order_acquire))
+      continue;
+    FutexWait(&count_, count | WAITERS);
+    count = count_.load(std::memory_order_acquire);
+  }
+}
+
+}  // namespace base
\ No newline at end of file
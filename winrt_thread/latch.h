@@ -0,0 +1,46 @@
+﻿#ifndef LATCH_H_
+#define LATCH_H_
+
+#include <stdint.h>
+
+#include <atomic>
+
+namespace base {
+
+// Single-use countdown, like std::latch: Wait() returns once CountDown()
+// has been called |count| times in all. The count is the futex word, with
+// a flag for parked waiters in its top bit, so the last CountDown() reads
+// nothing of the latch after publishing zero and the latch may be
+// destroyed as soon as Wait() returns. |count| must be below 2^30.
+class Latch {
+public:
+  explicit Latch(int32_t count) : count_(count) {}
+
+  Latch(const Latch &) = delete;
+  Latch &operator=(const Latch &) = delete;
+
+  void CountDown(int32_t n = 1);
+
+  bool TryWait() const {
+    return (count_.load(std::memory_order_acquire) & COUNT_MASK) == 0;
+  }
+
+  void Wait();
+
+  void ArriveAndWait(int32_t n = 1) {
+    CountDown(n);
+    Wait();
+  }
+
+private:
+  enum : int32_t {
+    WAITERS = 1 << 30,
+    COUNT_MASK = WAITERS - 1
+  };
+
+  std::atomic<int32_t> count_;
+};
+
+}  // namespace base
+
+#endif  // LATCH_H_
\ No newline at end of file
@@ -0,0 +1,44 @@
+﻿#include "lock.h"
+#include <algorithm>
+#include "futex.h"
+#if defined(_WIN32)
+#include "pch.h"
+#endif
+
+namespace base {
+
+void Lock::AcquireContended() {
+  int max_spins = MaxSpinCount();
+  if (max_spins > 0) {
+    int estimate = spin_estimate_.load(std::memory_order_relaxed);
+    int limit = std::min(max_spins, estimate * 2 + 10);
+    for (int spins = 0; spins < limit; spins++) {
+      SpinPause();
+      int32_t state = state_.load(std::memory_order_relaxed);
+      if (state == FREE &&
+          state_.compare_exchange_weak(state, LOCKED,
+                                       std::memory_order_acquire,
+                                       std::memory_order_relaxed)) {
+        spin_estimate_.store(estimate + (spins - estimate) / 8,
+                             std::memory_order_relaxed);
+        return;
+      }
+    }
+    spin_estimate_.store(estimate + (limit - estimate) / 8,
+                         std::memory_order_relaxed);
+  }
+  // Whoever frees the lock while it is marked contended wakes a waiter.
+  while (state_.exchange(CONTENDED, std::memory_order_acquire) != FREE)
+    FutexWait(&state_, CONTENDED);
+}
+
+void Lock::WakeWaiter() {
+  FutexWakeOne(&state_);
+}
+
+void Lock::AcquireAfterWait() {
+  while (state_.exchange(CONTENDED, std::memory_order_acquire) != FREE)
+    FutexWait(&state_, CONTENDED);
+}
+
+}  // namespace base
\ No newline at end of file
@@ -0,0 +1,96 @@
+﻿#ifndef LOCK_H_
+#define LOCK_H_
+
+#include <stdint.h>
+
+#include <atomic>
+
+namespace base {
+
+// Non-recursive mutex in one futex word, with no kernel object behind it:
+// free -> locked -> locked with waiters (Drepper, "Futexes Are Tricky").
+// An uncontended Acquire()/Release() is one atomic operation each and
+// Release() only enters the kernel when a thread is parked.
+//
+// A contended Acquire() first spins for a while, adapting how long to the
+// time the lock has recently taken to come free, as glibc's adaptive
+// mutexes do, and then parks on the futex.
+class Lock {
+public:
+  Lock() : state_(FREE), spin_estimate_(0) {}
+
+  Lock(const Lock &) = delete;
+  Lock &operator=(const Lock &) = delete;
+
+  void Acquire() {
+    int32_t expected = FREE;
+    if (!state_.compare_exchange_strong(expected, LOCKED,
+                                        std::memory_order_acquire,
+                                        std::memory_order_relaxed))
+      AcquireContended();
+  }
+
+  // Takes the lock only if it is free.
+  bool Try() {
+    int32_t expected = FREE;
+    return state_.compare_exchange_strong(expected, LOCKED,
+                                          std::memory_order_acquire,
+                                          std::memory_order_relaxed);
+  }
+
+  void Release() {
+    if (state_.exchange(FREE, std::memory_order_release) == CONTENDED)
+      WakeWaiter();
+  }
+
+private:
+  friend class ConditionVariable;
+
+  enum : int32_t {
+    FREE = 0,
+    LOCKED = 1,
+    CONTENDED = 2
+  };
+
+  void AcquireContended();
+
+  void WakeWaiter();
+
+  // Acquire() for a thread coming back from a condition variable: there
+  // may be more waiters behind it, so the lock is marked contended.
+  void AcquireAfterWait();
+
+  std::atomic<int32_t> state_;
+  // Recent spin counts, averaged; racy by design.
+  std::atomic<int32_t> spin_estimate_;
+};
+
+// Holds |lock| for the enclosing scope.
+class AutoLock {
+public:
+  explicit AutoLock(Lock &lock) : lock_(lock) { lock_.Acquire(); }
+  ~AutoLock() { lock_.Release(); }
+
+  AutoLock(const AutoLock &) = delete;
+  AutoLock &operator=(const AutoLock &) = delete;
+
+private:
+  Lock &lock_;
+};
+
+// Releases a held |lock| for the enclosing scope.
+class AutoUnlock {
+public:
+  explicit AutoUnlock(Lock &lock) : lock_(lock) { lock_.Release(); }
+  ~AutoUnlock() { lock_.Acquire(); }
+
+  AutoUnlock(const AutoUnlock &) = delete;
+  AutoUnlock &operator=(const AutoUnlock &) = delete;
+
+private:
+  Lock &lock_;
+};
+
+}  // namespace base
+
+#endif  // LOCK_H_
\ No newline at end of file
@@ -0,0 +1,73 @@
+﻿#ifndef MPSC_QUEUE_H_
+#define MPSC_QUEUE_H_
+
+#include <atomic>
+
+namespace base {
+
+// Intrusive multi-producer single-consumer FIFO (Vyukov's non-blocking
+// MPSC queue). Push() is one atomic exchange and never blocks or
+// allocates; items embed an MpscNode and must stay alive until popped.
+class MpscQueue {
+public:
+  struct Node {
+    std::atomic<Node *> next;
+  };
+
+  MpscQueue() : head_(&stub_), tail_(&stub_) {
+    stub_.next.store(nullptr, std::memory_order_relaxed);
+  }
+
+  MpscQueue(const MpscQueue &) = delete;
+  MpscQueue &operator=(const MpscQueue &) = delete;
+
+  // Any thread. The exchange is sequentially consistent so that a producer
+  // that then finds the consumer idle can rely on it having seen the item
+  // or going to see it.
+  void Push(Node *node) {
+    node->next.store(nullptr, std::memory_order_relaxed);
+    Node *prev = head_.exchange(node, std::memory_order_seq_cst);
+    prev->next.store(node, std::memory_order_release);
+  }
+
+  // Consumer only. Null when empty, and also, briefly, while a producer is
+  // between its two steps; Empty() tells the two apart.
+  Node *Pop() {
+    Node *tail = tail_;
+    Node *next = tail->next.load(std::memory_order_acquire);
+    if (tail == &stub_) {
+      if (!next)
+        return nullptr;
+      tail_ = next;
+      tail = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+    if (next) {
+      tail_ = next;
+      return tail;
+    }
+    if (tail != head_.load(std::memory_order_acquire))
+      return nullptr;
+    Push(&stub_);
+    next = tail->next.load(std::memory_order_acquire);
+    if (next) {
+      tail_ = next;
+      return tail;
+    }
+    return nullptr;
+  }
+
+  // Consumer only.
+  bool Empty() const {
+    return tail_ == &stub_ && head_.load(std::memory_order_seq_cst) == &stub_;
+  }
+
+private:
+  std::atomic<Node *> head_;
+  Node *tail_;
+  Node stub_;
+};
+
+}  // namespace base
+
+#endif  // MPSC_QUEUE_H_
\ No newline at end of file
@@ -0,0 +1,141 @@
+﻿#include "parallel_for.h"
+#include <algorithm>
+#include <thread>
+#include "cpu_topology.h"
+#if defined(_WIN32)
+#include "pch.h"
+#endif
+
+namespace base {
+
+namespace {
+
+// Keeps the chunk count within the Latch's range and the counter cheap.
+const size_t kMaxChunks = 1 << 20;
+
+// Chunks per participating thread for an automatic grain.
+const size_t kChunksPerThread = 4;
+
+}  // namespace
+
+WorkStealingPool *DefaultParallelPool() {
+  static WorkStealingPool *pool = [] {
+    unsigned cpus = std::thread::hardware_concurrency();
+    if (cpus < 2)
+      return static_cast<WorkStealingPool *>(nullptr);
+    WorkStealingPool::Options options;
+    options.name_prefix = "parallel_";
+    WorkStealingPool *p =
+        new WorkStealingPool(static_cast<int>(cpus - 1), options);
+    p->Start();
+    return p;
+  }();
+  return pool;
+}
+
+size_t L2Grain(size_t bytes_per_item) {
+  size_t items = CpuTopology::Get().l2_cache_size() / 2 /
+                 std::max<size_t>(bytes_per_item, 1);
+  return std::max<size_t>(items & ~static_cast<size_t>(63), 64);
+}
+
+namespace internal {
+
+void RunParallelFor(size_t begin,
+                    size_t end,
+                    size_t grain,
+                    ChunkFunction function,
+                    const void *context,
+                    WorkStealingPool *pool) {
+  if (begin >= end)
+    return;
+  if (!pool)
+    pool = DefaultParallelPool();
+  size_t count = end - begin;
+  size_t workers = pool ? static_cast<size_t>(pool->num_threads()) : 0;
+  if (grain == 0)
+    grain = std::max<size_t>(count / ((workers + 1) * kChunksPerThread), 1);
+  grain = std::max(grain, (count - 1) / kMaxChunks + 1);
+  size_t chunks = (count - 1) / grain + 1;
+
+  size_t helpers = std::min(workers, chunks - 1);
+  if (helpers == 0) {
+    while (begin < end) {
+      size_t chunk_end = begin + std::min(grain, end - begin);
+      function(context, begin, chunk_end);
+      begin = chunk_end;
+    }
+    return;
+  }
+
+  ParallelForState *state =
+      new ParallelForState(begin, end, grain, chunks, function, context,
+                           static_cast<int>(helpers) + 1);
+  pool->AddWork(state, static_cast<int>(helpers));
+  state->RunChunks();
+  std::exception_ptr exception = state->Wait();
+  state->Release();
+  if (exception)
+    std::rethrow_exception(exception);
+}
+
+ParallelForState::ParallelForState(size_t begin,
+                                   size_t end,
+                                   size_t grain,
+                                   size_t chunks,
+                                   ChunkFunction function,
+                                   const void *context,
+                                   int refs)
+    : begin_(begin),
+      end_(end),
+      grain_(grain),
+      chunks_(chunks),
+      function_(function),
+      context_(context),
+      next_(0),
+      done_(static_cast<int32_t>(chunks)),
+      refs_(refs) {}
+
+void ParallelForState::Run() {
+  RunChunks();
+  Release();
+}
+
+void ParallelForState::RunChunks() {
+  for (;;) {
+    size_t chunk = next_.fetch_add(1, std::memory_order_relaxed);
+    if (chunk >= chunks_)
+      return;
+    size_t b = begin_ + chunk * grain_;
+    size_t e = b + std::min(grain_, end_ - b);
+    try {
+      function_(context_, b, e);
+    } catch (...) {
+      {
+        AutoLock lock(exception_lock_);
+        if (!exception_)
+          exception_ = std::current_exception();
+      }
+      // Claims every chunk nobody has started and counts them as done.
+      size_t claimed = next_.exchange(chunks_, std::memory_order_relaxed);
+      if (claimed < chunks_)
+        done_.CountDown(static_cast<int32_t>(chunks_ - claimed));
+    }
+    done_.CountDown();
+  }
+}
+
+std::exception_ptr ParallelForState::Wait() {
+  done_.Wait();
+  AutoLock lock(exception_lock_);
+  return exception_;
+}
+
+void ParallelForState::Release() {
+  if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    delete this;
+}
+
+}  // namespace internal
+
+}  // namespace base
\ No newline at end of file
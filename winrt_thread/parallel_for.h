@@ -0,0 +1,140 @@
+﻿#ifndef PARALLEL_FOR_H_
+#define PARALLEL_FOR_H_
+
+#include <stddef.h>
+
+#include <atomic>
+#include <exception>
+#include <span>
+#include <type_traits>
+
+#include "latch.h"
+#include "lock.h"
+#include "work_stealing_pool.h"
+
+namespace base {
+
+// Pool used by ParallelFor() and ParallelTransform() when none is given:
+// hardware_concurrency() - 1 workers named "parallel_<n>", started on first
+// use and never destroyed. Null on a single-CPU machine.
+WorkStealingPool *DefaultParallelPool();
+
+// Items per chunk when each item touches |bytes_per_item| bytes: enough to
+// fill half the L2 cache, rounded down to a multiple of 64 and at least 64.
+size_t L2Grain(size_t bytes_per_item);
+
+namespace internal {
+
+typedef void (*ChunkFunction)(const void *context, size_t begin, size_t end);
+
+// Calls |function(context, b, e)| over [begin, end) in chunks of |grain|
+// items, on the calling thread and on helpers posted to |pool|.
+void RunParallelFor(size_t begin,
+                    size_t end,
+                    size_t grain,
+                    ChunkFunction function,
+                    const void *context,
+                    WorkStealingPool *pool);
+
+// One ParallelFor() call, shared by the caller and its helpers. Chunks are
+// handed out through an atomic counter, so a thread that finishes early
+// takes more of them. Reference counted: a helper may only be picked up
+// after the caller has already returned.
+class ParallelForState : public WorkStealingPool::Delegate {
+public:
+  ParallelForState(size_t begin,
+                   size_t end,
+                   size_t grain,
+                   size_t chunks,
+                   ChunkFunction function,
+                   const void *context,
+                   int refs);
+
+  // Helper entry point: runs chunks until none are left, then releases.
+  void Run() override;
+
+  // Runs chunks until none are left.
+  void RunChunks();
+
+  // Blocks until every chunk has finished, or been abandoned after an
+  // exception. Returns that exception, if any.
+  std::exception_ptr Wait();
+
+  void Release();
+
+private:
+  const size_t begin_;
+  const size_t end_;
+  const size_t grain_;
+  const size_t chunks_;
+  const ChunkFunction function_;
+  const void *const context_;
+  std::atomic<size_t> next_;
+  Latch done_;
+  std::atomic<int> refs_;
+
+  Lock exception_lock_;
+  std::exception_ptr exception_;
+};
+
+}  // namespace internal
+
+// Calls |fn(chunk_begin, chunk_end)| over [begin, end) split into chunks of
+// at most |grain| items, dynamically balanced between the calling thread
+// and up to |pool->num_threads()| of |pool|'s workers; returns when all of
+// them are done. Without a pool, DefaultParallelPool() is used. A |grain|
+// of 0 aims at a few chunks per thread; pass L2Grain() when the size of
+// the data per item is known.
+//
+// |fn| runs concurrently on several threads. The first exception it throws
+// stops the chunks not yet started and is rethrown here once the running
+// ones have finished.
+//
+// Callable from inside a pool worker: the caller keeps running chunks
+// itself, so nesting does not deadlock even when every worker is busy.
+template <typename Fn>
+void ParallelFor(size_t begin,
+                 size_t end,
+                 size_t grain,
+                 const Fn &fn,
+                 WorkStealingPool *pool = nullptr) {
+  internal::RunParallelFor(
+      begin, end, grain,
+      [](const void *context, size_t b, size_t e) {
+        (*static_cast<const Fn *>(context))(b, e);
+      },
+      &fn, pool);
+}
+
+// ParallelFor() over |in|, writing |out[i] = fn(in[i])|. |fn| may instead
+// take a chunk, |fn(std::span<In>, std::span<Out>)|, with both spans the
+// same length. A |grain| of 0 uses L2Grain(sizeof(In) + sizeof(Out)).
+// False, without calling |fn|, when |out| is shorter than |in|.
+template <typename In, typename Out, typename Fn>
+bool ParallelTransform(std::span<In> in,
+                       std::span<Out> out,
+                       const Fn &fn,
+                       size_t grain = 0,
+                       WorkStealingPool *pool = nullptr) {
+  if (out.size() < in.size())
+    return false;
+  if (grain == 0)
+    grain = L2Grain(sizeof(In) + sizeof(Out));
+  ParallelFor(
+      0, in.size(), grain,
+      [in, out, &fn](size_t b, size_t e) {
+        if constexpr (std::is_invocable_v<const Fn &, std::span<In>,
+                                          std::span<Out>>) {
+          fn(in.subspan(b, e - b), out.subspan(b, e - b));
+        } else {
+          for (size_t i = b; i < e; i++)
+            out[i] = fn(in[i]);
+        }
+      },
+      pool);
+  return true;
+}
+
+}  // namespace base
+
+#endif  // PARALLEL_FOR_H_
\ No newline at end of file
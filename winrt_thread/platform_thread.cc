@@ -4,6 +4,9 @@
 #include <wrl/event.h>
 #include <stdio.h>
 #include <Objbase.h>
+#include <atomic>
+#include <chrono>
+#include "futex.h"
 #include "platform_thread.h"
 #include "pch.h"
 
@@ -51,34 +54,19 @@ static bool InternalStartThread(
 bool CreateThreadInternal(PlatformThread::Delegate *delegate,
                           PlatformThreadHandle *out_thread_handle,
                           ThreadPriority priority) {
-  HANDLE handle = CreateEventEx(NULL, NULL, CREATE_EVENT_MANUAL_RESET, EVENT_ALL_ACCESS);
-
-  HANDLE platform_handle = INVALID_HANDLE_VALUE;
-
-  if (!DuplicateHandle(GetCurrentProcess(),
-                       handle,
-                       GetCurrentProcess(),
-                       &platform_handle,
-                       0,
-                       false,
-                       DUPLICATE_SAME_ACCESS)) {
-    CloseHandle(handle);
-    return false;
-  }
-
+  JoinHandle *handle = new JoinHandle;
   *out_thread_handle = handle;
 
   Microsoft::WRL::ComPtr<ABI::Windows::System::Threading::IWorkItemHandler> work_item =
       Microsoft::WRL::Callback<Microsoft::WRL::Implements<Microsoft::WRL::RuntimeClassFlags<Microsoft::WRL::ClassicCom>,
                                                           ABI::Windows::System::Threading::IWorkItemHandler,
                                                           Microsoft::WRL::FtmBase>>
-          ([delegate, platform_handle](ABI::Windows::Foundation::IAsyncAction *) {
+          ([delegate, handle](ABI::Windows::Foundation::IAsyncAction *) {
             __try{
                 delegate->ThreadMain();
             }
             __finally{
-                SetEvent(platform_handle);
-                CloseHandle(platform_handle);
+                handle->MarkDone();
             }
             return S_OK;
           });
@@ -86,8 +74,8 @@ bool CreateThreadInternal(PlatformThread::Delegate *delegate,
   bool result = InternalStartThread(std::move(work_item),
                                     GetWorkItemPriority(priority));
   if (!result) {
-    CloseHandle(handle);
-    CloseHandle(platform_handle);
+    delete handle;
+    *out_thread_handle = nullptr;
   }
   return result;
 }
@@ -96,26 +84,18 @@ bool CreateThreadInternal(PlatformThread::Delegate *delegate,
 
 // static
 void PlatformThread::Sleep(uint32_t milliseconds) {
-  static HANDLE g_singleton_event = nullptr;
-
-  HANDLE sleep_event = g_singleton_event;
-
-  if (!sleep_event) {
-    sleep_event = CreateEventEx(nullptr, nullptr, CREATE_EVENT_MANUAL_RESET, EVENT_ALL_ACCESS);
-
-    if (!sleep_event)
-      return;
-
-    HANDLE previous_event = InterlockedCompareExchangePointerRelease(&g_singleton_event, sleep_event, nullptr);
-
-    if (previous_event) {
-      CloseHandle(sleep_event);
-      sleep_event = g_singleton_event;
-    }
+  // Never changed or woken, so only the timeout ends a wait on it; the
+  // loop covers WaitOnAddress() returning early.
+  static std::atomic<int32_t> g_sleep_word(0);
+
+  std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds);
+  while (true) {
+    std::chrono::nanoseconds left = deadline - std::chrono::steady_clock::now();
+    if (left <= std::chrono::nanoseconds::zero())
+      break;
+    FutexWaitFor(&g_sleep_word, 0, left);
   }
-  WaitForSingleObjectEx(sleep_event,
-                        static_cast<DWORD>(milliseconds),
-                        false);
 }
 
 // static
@@ -128,12 +108,20 @@ CreateThreadInternal(delegate, thread_handle, priority
 );
 }
 
+// static
+bool PlatformThread::CreateWithOptions(Delegate *delegate,
+                                       PlatformThreadHandle *thread_handle,
+                                       const ThreadOptions &options) {
+  // Work items run on pooled threads shared with the rest of the process,
+  // so pinning or renaming them would outlive this thread.
+  return CreateThreadInternal(delegate, thread_handle, options.priority);
+}
+
 // static
 void PlatformThread::Join(PlatformThreadHandle thread_handle) {
-  DWORD result = WaitForSingleObjectEx(thread_handle, INFINITE, false);
-  if (result != WAIT_OBJECT_0) {
-    DWORD error = GetLastError();
-  }
-  CloseHandle(thread_handle);
+  if (!thread_handle)
+    return;
+  thread_handle->Join();
+  delete thread_handle;
 }
 }  // namespace base
\ No newline at end of file
@@ -3,18 +3,57 @@
 
 #include <stddef.h>
 #include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
 #include <windows.h>
+#include "join_handle.h"
+#else
+#include <pthread.h>
+#endif
 
 namespace base {
 
-typedef HANDLE PlatformThreadHandle;
+#if defined(_WIN32)
+// Work items of the WinRT pool have no thread handle to wait on; the item
+// marks this done when the delegate returns, and Join() frees it.
+typedef JoinHandle *PlatformThreadHandle;
+#else
+typedef pthread_t PlatformThreadHandle;
+#endif
 
+// On POSIX BACKGROUND runs the thread at nice 10 and REALTIME_AUDIO under
+// SCHED_RR, falling back to nice -10 and then NORMAL when the process is
+// not allowed either.
 enum class ThreadPriority : int {
   BACKGROUND,
   NORMAL,
   REALTIME_AUDIO,
 };
 
+// Scheduling and placement of a new thread. CpuTopology and
+// PlanThreadPlacement() (cpu_topology.h) fill these in for a pool.
+//
+// On POSIX everything applies where the OS allows it (affinity and NUMA
+// policies on Linux only) and failures leave the thread unplaced rather
+// than failing its creation. The Windows backend runs on the shared WinRT
+// thread pool, where only |priority| applies.
+struct ThreadOptions {
+  ThreadOptions() : priority(ThreadPriority::NORMAL), numa_node(-1) {}
+
+  ThreadPriority priority;
+  // Logical CPUs the thread may run on. Empty: |numa_node|'s CPUs, or no
+  // restriction without one.
+  std::vector<int> cpus;
+  // Node whose memory the thread's new pages should come from; -1 for
+  // none.
+  int numa_node;
+  // For debuggers and top; Linux keeps the first 15 bytes.
+  std::string name;
+};
+
 class PlatformThread {
 public:
   class Delegate {
@@ -37,6 +76,10 @@ public:
                                  PlatformThreadHandle *thread_handle,
                                  ThreadPriority priority);
 
+  static bool CreateWithOptions(Delegate *delegate,
+                                PlatformThreadHandle *thread_handle,
+                                const ThreadOptions &options);
+
   static void Join(PlatformThreadHandle thread_handle);
 
 };
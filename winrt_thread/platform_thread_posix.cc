@@ -0,0 +1,168 @@
+﻿#include <errno.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/resource.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include "cpu_topology.h"
+#include "platform_thread.h"
+
+namespace base {
+
+namespace {
+
+const int kBackgroundNiceValue = 10;
+const int kRealtimeAudioNiceValue = -10;
+// Low in the SCHED_RR range so that real kernel work still preempts it.
+const int kRealtimeAudioSchedPriority = 8;
+
+// Linux rejects longer names.
+const size_t kMaxThreadNameLength = 15;
+
+struct ThreadParams {
+  PlatformThread::Delegate *delegate;
+  ThreadOptions options;
+};
+
+// Sets the nice value of the calling thread only. Linux keeps a nice
+// value per thread; elsewhere setpriority() would change the whole
+// process, so the call is skipped.
+bool SetCurrentThreadNiceValue(int nice_value) {
+#if defined(__linux__)
+  return setpriority(PRIO_PROCESS,
+                     static_cast<id_t>(syscall(SYS_gettid)),
+                     nice_value) == 0;
+#else
+  return false;
+#endif
+}
+
+void SetCurrentThreadPriority(ThreadPriority priority) {
+  switch (priority) {
+    case ThreadPriority::BACKGROUND:
+      SetCurrentThreadNiceValue(kBackgroundNiceValue);
+      break;
+    case ThreadPriority::REALTIME_AUDIO: {
+      // Needs CAP_SYS_NICE or an RLIMIT_RTPRIO allowance; a raised nice
+      // value needs only RLIMIT_NICE.
+      sched_param param = {};
+      param.sched_priority = kRealtimeAudioSchedPriority;
+      if (pthread_setschedparam(pthread_self(), SCHED_RR, &param) != 0)
+        SetCurrentThreadNiceValue(kRealtimeAudioNiceValue);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+void SetCurrentThreadAffinity(const std::vector<int> &cpus) {
+#if defined(__linux__)
+  int max_cpu = 0;
+  for (int cpu : cpus)
+    max_cpu = cpu > max_cpu ? cpu : max_cpu;
+  cpu_set_t *set = CPU_ALLOC(max_cpu + 1);
+  if (!set)
+    return;
+  size_t size = CPU_ALLOC_SIZE(max_cpu + 1);
+  CPU_ZERO_S(size, set);
+  for (int cpu : cpus) {
+    if (cpu >= 0)
+      CPU_SET_S(cpu, size, set);
+  }
+  pthread_setaffinity_np(pthread_self(), size, set);
+  CPU_FREE(set);
+#endif
+}
+
+void SetCurrentThreadName(const std::string &name) {
+  std::string truncated = name.substr(0, kMaxThreadNameLength);
+#if defined(__APPLE__)
+  pthread_setname_np(truncated.c_str());
+#elif defined(__linux__)
+  pthread_setname_np(pthread_self(), truncated.c_str());
+#endif
+}
+
+// Runs first on the new thread, so that the memory it touches afterwards
+// already follows the node policy.
+void ApplyThreadOptions(const ThreadOptions &options) {
+  if (!options.name.empty())
+    SetCurrentThreadName(options.name);
+  if (!options.cpus.empty()) {
+    SetCurrentThreadAffinity(options.cpus);
+  } else if (options.numa_node >= 0) {
+    const CpuTopology::Node *node =
+        CpuTopology::Get().FindNode(options.numa_node);
+    if (node)
+      SetCurrentThreadAffinity(node->cpus);
+  }
+  if (options.numa_node >= 0)
+    SetCurrentThreadPreferredNode(options.numa_node);
+  SetCurrentThreadPriority(options.priority);
+}
+
+void *ThreadFunc(void *arg) {
+  ThreadParams *params = static_cast<ThreadParams *>(arg);
+  PlatformThread::Delegate *delegate = params->delegate;
+  ApplyThreadOptions(params->options);
+  delete params;
+
+  delegate->ThreadMain();
+  return nullptr;
+}
+
+}  // namespace
+
+// static
+void PlatformThread::Sleep(uint32_t milliseconds) {
+  timespec remaining;
+  remaining.tv_sec = milliseconds / 1000;
+  remaining.tv_nsec = static_cast<long>(milliseconds % 1000) * 1000000;
+#if defined(__APPLE__)
+  while (nanosleep(&remaining, &remaining) == -1 && errno == EINTR) {
+  }
+#else
+  // Relative sleep on the monotonic clock, resumed with the time left when
+  // a signal interrupts it.
+  while (clock_nanosleep(CLOCK_MONOTONIC, 0, &remaining, &remaining) == EINTR) {
+  }
+#endif
+}
+
+// static
+bool PlatformThread::CreateWithPriority(Delegate *delegate,
+                                        PlatformThreadHandle *thread_handle,
+                                        ThreadPriority priority) {
+  ThreadOptions options;
+  options.priority = priority;
+  return CreateWithOptions(delegate, thread_handle, options);
+}
+
+// static
+bool PlatformThread::CreateWithOptions(Delegate *delegate,
+                                       PlatformThreadHandle *thread_handle,
+                                       const ThreadOptions &options) {
+  ThreadParams *params = new ThreadParams;
+  params->delegate = delegate;
+  params->options = options;
+
+  pthread_attr_t attributes;
+  pthread_attr_init(&attributes);
+  pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_JOINABLE);
+  int err = pthread_create(thread_handle, &attributes, ThreadFunc, params);
+  pthread_attr_destroy(&attributes);
+  if (err != 0) {
+    delete params;
+    return false;
+  }
+  return true;
+}
+
+// static
+void PlatformThread::Join(PlatformThreadHandle thread_handle) {
+  pthread_join(thread_handle, nullptr);
+}
+}  // namespace base
\ No newline at end of file
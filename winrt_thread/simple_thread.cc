@@ -1,34 +1,52 @@
 ﻿#include "simple_thread.h"
+#if defined(_WIN32)
 #include "pch.h"
+#endif
 
 namespace base {
 
+namespace {
+
+ThreadOptions OptionsWithPriority(ThreadPriority priority) {
+  ThreadOptions options;
+  options.priority = priority;
+  return options;
+}
+
+}  // namespace
+
 SimpleThread::SimpleThread()
-    : thread_(), joined_(false),
-      priority_(ThreadPriority::NORMAL) {
+    : options_(), thread_(), started_(false), joined_(false) {
 }
 
 SimpleThread::SimpleThread(const ThreadPriority &priority)
-    : priority_(priority),
-      thread_(), joined_(false) {
+    : options_(OptionsWithPriority(priority)),
+      thread_(), started_(false), joined_(false) {
+}
+
+SimpleThread::SimpleThread(const ThreadOptions &options)
+    : options_(options),
+      thread_(), started_(false), joined_(false) {
 }
 
 SimpleThread::~SimpleThread() {
 }
 
 void SimpleThread::Start() {
-  bool success;
-  if (priority_ == ThreadPriority::NORMAL) {
-    success = PlatformThread::Create(this, &thread_);
+  if (options_.priority == ThreadPriority::NORMAL && options_.cpus.empty() &&
+      options_.numa_node < 0 && options_.name.empty()) {
+    started_ = PlatformThread::Create(this, &thread_);
   } else {
-    success = PlatformThread::CreateWithPriority(this,
+    started_ = PlatformThread::CreateWithOptions(this,
                                                  &thread_,
-                                                 priority_);
+                                                 options_);
   }
 }
 
 void SimpleThread::Join() {
-  PlatformThread::Join(thread_);
+  // No thread to join, and |thread_| was never set.
+  if (started_)
+    PlatformThread::Join(thread_);
   joined_ = true;
 }
 
@@ -15,10 +15,12 @@ class SimpleThread : public PlatformThread::Delegate {
 public:
   SimpleThread();
   SimpleThread(const ThreadPriority &priority);
+  explicit SimpleThread(const ThreadOptions &options);
 
   ~SimpleThread() override;
 
   virtual void Start();
+  // A no-op, other than marking the thread joined, if Start() failed.
   virtual void Join();
 
   // Subclasses should override the Run method.
@@ -27,12 +29,16 @@ public:
   // Return True if Join() has evern been called.
   bool HasBeenJoined() { return joined_; }
 
+  // True once Start() has created the thread.
+  bool HasBeenStarted() const { return started_; }
+
   // Overridden from PlatformThread::Delegate:
   void ThreadMain() override;
 
 private:
-  const ThreadPriority priority_;
+  const ThreadOptions options_;
   PlatformThreadHandle thread_;
+  bool started_;
   bool joined_;
 };
 
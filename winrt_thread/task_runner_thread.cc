@@ -0,0 +1,175 @@
+﻿#include "task_runner_thread.h"
+#include <thread>
+#include "futex.h"
+#if defined(_WIN32)
+#include "pch.h"
+#endif
+
+namespace base {
+
+namespace {
+
+thread_local const TaskRunnerThread *g_current_runner = nullptr;
+
+}  // namespace
+
+TaskRunnerThread::TaskRunnerThread(ThreadPriority priority, size_t max_batch)
+    : SimpleThread(priority),
+      max_batch_(max_batch > 0 ? max_batch : 1),
+      idle_(0),
+      stopping_(false),
+      posting_(0),
+      quit_(false),
+      tasks_(0),
+      batches_(0),
+      wakeups_(0),
+      total_queue_wait_ns_(0),
+      max_queue_wait_ns_(0) {
+  batch_.reserve(max_batch_);
+}
+
+TaskRunnerThread::~TaskRunnerThread() {
+  if (HasBeenStarted())
+    Stop();
+  DropPending();
+}
+
+void TaskRunnerThread::Start() {
+  // The loop could never be told to quit: Stop() has already been and
+  // queued nothing.
+  if (stopping_.load(std::memory_order_seq_cst))
+    return;
+  SimpleThread::Start();
+}
+
+void TaskRunnerThread::Stop() {
+  if (!HasBeenStarted()) {
+    stopping_.store(true, std::memory_order_seq_cst);
+    return;
+  }
+  if (!stopping_.exchange(true, std::memory_order_seq_cst)) {
+    // Pairs with PostTask(): a post either sees stopping_ and fails, or is
+    // counted here and finishes its push before the quit task goes in.
+    int32_t posting;
+    while ((posting = posting_.load(std::memory_order_seq_cst)) != 0)
+      FutexWait(&posting_, posting);
+
+    // Queued behind everything posted so far.
+    PendingTask *quit = new PendingTask;
+    quit->task = [this] { quit_ = true; };
+    quit->posted = Clock::now();
+    queue_.Push(quit);
+    if (idle_.exchange(0, std::memory_order_seq_cst) == 1)
+      FutexWakeOne(&idle_);
+  }
+  if (RunsTasksInCurrentThread() || HasBeenJoined())
+    return;
+  Join();
+}
+
+bool TaskRunnerThread::PostTask(Task task) {
+  posting_.fetch_add(1, std::memory_order_seq_cst);
+  bool accepted = !stopping_.load(std::memory_order_seq_cst);
+  if (accepted) {
+    PendingTask *pending = new PendingTask;
+    pending->task = std::move(task);
+    pending->posted = Clock::now();
+    queue_.Push(pending);
+    // Pairs with the store in Run(): either the loop sees this task before
+    // parking, or this sees the loop idle and wakes it.
+    if (idle_.load(std::memory_order_seq_cst) == 1 &&
+        idle_.exchange(0, std::memory_order_seq_cst) == 1)
+      FutexWakeOne(&idle_);
+  }
+  if (posting_.fetch_sub(1, std::memory_order_seq_cst) == 1 &&
+      stopping_.load(std::memory_order_seq_cst))
+    FutexWakeAll(&posting_);
+  return accepted;
+}
+
+bool TaskRunnerThread::RunsTasksInCurrentThread() const {
+  return g_current_runner == this;
+}
+
+TaskRunnerThread::Stats TaskRunnerThread::GetStats() const {
+  Stats stats;
+  stats.tasks = tasks_.load(std::memory_order_relaxed);
+  stats.batches = batches_.load(std::memory_order_relaxed);
+  stats.wakeups = wakeups_.load(std::memory_order_relaxed);
+  stats.total_queue_wait_ns =
+      total_queue_wait_ns_.load(std::memory_order_relaxed);
+  stats.max_queue_wait_ns = max_queue_wait_ns_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void TaskRunnerThread::Run() {
+  g_current_runner = this;
+  while (!quit_) {
+    if (RunBatch() > 0)
+      continue;
+    if (!queue_.Empty()) {
+      // A producer is half way through its push.
+      std::this_thread::yield();
+      continue;
+    }
+    idle_.store(1, std::memory_order_seq_cst);
+    if (!queue_.Empty()) {
+      idle_.store(0, std::memory_order_relaxed);
+      continue;
+    }
+    wakeups_.fetch_add(1, std::memory_order_relaxed);
+    while (idle_.load(std::memory_order_acquire) == 1)
+      FutexWait(&idle_, 1);
+  }
+  DropPending();
+  g_current_runner = nullptr;
+}
+
+size_t TaskRunnerThread::RunBatch() {
+  while (batch_.size() < max_batch_) {
+    MpscQueue::Node *node = queue_.Pop();
+    if (!node)
+      break;
+    batch_.push_back(static_cast<PendingTask *>(node));
+  }
+  size_t count = batch_.size();
+  if (count == 0)
+    return 0;
+
+  Clock::time_point now = Clock::now();
+  uint64_t total_wait = 0;
+  uint64_t max_wait = max_queue_wait_ns_.load(std::memory_order_relaxed);
+  for (PendingTask *pending : batch_) {
+    uint64_t wait = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            now - pending->posted).count());
+    total_wait += wait;
+    if (wait > max_wait)
+      max_wait = wait;
+  }
+  total_queue_wait_ns_.fetch_add(total_wait, std::memory_order_relaxed);
+  max_queue_wait_ns_.store(max_wait, std::memory_order_relaxed);
+  batches_.fetch_add(1, std::memory_order_relaxed);
+
+  size_t ran = 0;
+  for (PendingTask *pending : batch_) {
+    // Whatever follows the quit task in this batch is dropped.
+    if (!quit_) {
+      pending->task();
+      // Not counting the quit task itself.
+      if (!quit_)
+        ++ran;
+    }
+    delete pending;
+  }
+  tasks_.fetch_add(ran, std::memory_order_relaxed);
+  batch_.clear();
+  return count;
+}
+
+void TaskRunnerThread::DropPending() {
+  while (MpscQueue::Node *node = queue_.Pop())
+    delete static_cast<PendingTask *>(node);
+}
+
+}  // namespace base
\ No newline at end of file
@@ -0,0 +1,101 @@
+﻿#ifndef TASK_RUNNER_THREAD_H_
+#define TASK_RUNNER_THREAD_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+#include "mpsc_queue.h"
+#include "simple_thread.h"
+
+namespace base {
+
+// SimpleThread running a message loop: any thread can PostTask() to it and
+// the tasks run on it one at a time, in posting order. Use it to keep
+// state that is not thread-safe, such as a crypto context, on one owning
+// thread and hand work to it cheaply.
+//
+// Posting is a lock-free push onto an intrusive MPSC queue; the loop is
+// only woken through a futex (WaitOnAddress on Windows) when it had run
+// out of work and gone idle. The loop drains up to |max_batch| tasks at a
+// time, reading the clock once per batch to account how long they waited.
+class TaskRunnerThread : public SimpleThread {
+public:
+  typedef std::function<void()> Task;
+
+  struct Stats {
+    uint64_t tasks;
+    uint64_t batches;
+    // Times the loop went idle and had to be woken by a post.
+    uint64_t wakeups;
+    // Time between PostTask() and the start of the task's batch.
+    uint64_t total_queue_wait_ns;
+    uint64_t max_queue_wait_ns;
+  };
+
+  explicit TaskRunnerThread(ThreadPriority priority = ThreadPriority::NORMAL,
+                            size_t max_batch = 64);
+
+  // Stops and joins the thread if it was started.
+  ~TaskRunnerThread() override;
+
+  // Does nothing once Stop() has been called.
+  void Start() override;
+
+  // Runs the tasks already posted, then ends the loop and joins it. From a
+  // task on this thread it only asks the loop to end. On a thread that was
+  // never started, tasks posted so far are dropped by the destructor.
+  void Stop();
+
+  // Any thread. False once Stop() has been called; a task accepted by a
+  // post racing Stop() still runs before the loop ends.
+  bool PostTask(Task task);
+
+  bool RunsTasksInCurrentThread() const;
+
+  Stats GetStats() const;
+
+  // The message loop.
+  void Run() override;
+
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct PendingTask : public MpscQueue::Node {
+    Task task;
+    Clock::time_point posted;
+  };
+
+  // Pops and runs up to |max_batch_| tasks; returns how many ran.
+  size_t RunBatch();
+
+  // Deletes whatever is left in the queue without running it.
+  void DropPending();
+
+  const size_t max_batch_;
+  MpscQueue queue_;
+  std::vector<PendingTask *> batch_;
+
+  // 1 while the loop is parked or about to park; the futex word.
+  std::atomic<int32_t> idle_;
+  std::atomic<bool> stopping_;
+  // PostTask() calls past their stopping_ check but not done pushing;
+  // Stop() waits on it as a futex word before queueing the quit task.
+  std::atomic<int32_t> posting_;
+  // Loop thread only.
+  bool quit_;
+
+  std::atomic<uint64_t> tasks_;
+  std::atomic<uint64_t> batches_;
+  std::atomic<uint64_t> wakeups_;
+  std::atomic<uint64_t> total_queue_wait_ns_;
+  std::atomic<uint64_t> max_queue_wait_ns_;
+};
+
+}  // namespace base
+
+#endif  // TASK_RUNNER_THREAD_H_
\ No newline at end of file
@@ -0,0 +1,136 @@
+﻿#include "timer_wheel.h"
+#if defined(_WIN32)
+#include "pch.h"
+#endif
+
+namespace base {
+
+TimerWheel::TimerWheel(uint64_t now)
+    : now_(now),
+      size_(0) {
+  for (int level = 0; level < LEVELS; level++) {
+    for (int i = 0; i < SLOTS; i++) {
+      Timer *head = &slots_[level][i].head;
+      head->prev_ = head;
+      head->next_ = head;
+    }
+  }
+}
+
+void TimerWheel::Link(Slot *slot, Timer *timer) {
+  Timer *head = &slot->head;
+  timer->prev_ = head->prev_;
+  timer->next_ = head;
+  head->prev_->next_ = timer;
+  head->prev_ = timer;
+}
+
+void TimerWheel::Unlink(Timer *timer) {
+  timer->prev_->next_ = timer->next_;
+  timer->next_->prev_ = timer->prev_;
+  timer->prev_ = nullptr;
+  timer->next_ = nullptr;
+}
+
+void TimerWheel::Insert(Timer *timer) {
+  uint64_t expiry = timer->expiry_;
+  uint64_t delta = expiry - now_;
+  int level = 0;
+  while (level < LEVELS - 1 &&
+         delta >= (uint64_t(1) << (SLOT_BITS * (level + 1))))
+    ++level;
+  if (level == LEVELS - 1 &&
+      delta >= (uint64_t(1) << (SLOT_BITS * LEVELS))) {
+    // Out of range: wait in the furthest top level slot and be re-filed
+    // from there.
+    expiry = now_ + (uint64_t(1) << (SLOT_BITS * LEVELS)) - 1;
+  }
+  int index = static_cast<int>((expiry >> (SLOT_BITS * level)) & SLOT_MASK);
+  Link(&slots_[level][index], timer);
+}
+
+void TimerWheel::Schedule(Timer *timer, uint64_t expiry) {
+  timer->expiry_ = expiry > now_ ? expiry : now_ + 1;
+  Insert(timer);
+  ++size_;
+}
+
+void TimerWheel::Cancel(Timer *timer) {
+  if (!timer->IsScheduled())
+    return;
+  Unlink(timer);
+  --size_;
+}
+
+int TimerWheel::Cascade(int level, int index) {
+  Timer *head = &slots_[level][index].head;
+  while (head->next_ != head) {
+    Timer *timer = head->next_;
+    Unlink(timer);
+    Insert(timer);
+  }
+  return index;
+}
+
+void TimerWheel::Advance(uint64_t now, std::vector<Timer *> *expired) {
+  while (now_ < now) {
+    // Ticks with nothing to expire or cascade are skipped in one step.
+    uint64_t next = NextEventTick();
+    if (next > now) {
+      now_ = now;
+      break;
+    }
+    now_ = next;
+    int index = static_cast<int>(now_ & SLOT_MASK);
+    // Each upper level moves down one slot whenever the level below it
+    // completes a turn.
+    if (index == 0) {
+      for (int level = 1; level < LEVELS; level++) {
+        int upper = static_cast<int>(
+            (now_ >> (SLOT_BITS * level)) & SLOT_MASK);
+        if (Cascade(level, upper) != 0)
+          break;
+      }
+    }
+    Timer *head = &slots_[0][index].head;
+    while (head->next_ != head) {
+      Timer *timer = head->next_;
+      Unlink(timer);
+      --size_;
+      expired->push_back(timer);
+    }
+  }
+}
+
+uint64_t TimerWheel::NextEventTick() const {
+  if (size_ == 0)
+    return NO_EVENT;
+  // Level 0 holds the expiries of the next SLOTS - 1 ticks.
+  uint64_t next = NO_EVENT;
+  for (uint64_t tick = now_ + 1; tick < now_ + SLOTS; tick++) {
+    const Timer *head = &slots_[0][tick & SLOT_MASK].head;
+    if (head->next_ != head) {
+      next = tick;
+      break;
+    }
+  }
+  // Upper levels: the first turn boundary, before that, whose slot has
+  // something to cascade. A full turn round is included because a slot
+  // may be refilled just after it was emptied.
+  for (int level = 1; level < LEVELS; level++) {
+    int shift = SLOT_BITS * level;
+    for (uint64_t turn = 1; turn <= SLOTS; turn++) {
+      uint64_t tick = ((now_ >> shift) + turn) << shift;
+      if (tick >= next)
+        break;
+      const Timer *head = &slots_[level][(tick >> shift) & SLOT_MASK].head;
+      if (head->next_ != head) {
+        next = tick;
+        break;
+      }
+    }
+  }
+  return next;
+}
+
+}  // namespace base
\ No newline at end of file
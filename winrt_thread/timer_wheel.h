@@ -0,0 +1,90 @@
+﻿#ifndef TIMER_WHEEL_H_
+#define TIMER_WHEEL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+namespace base {
+
+// Hierarchical timer wheel over abstract ticks: four levels of 256 slots,
+// each slot of a level covering one full turn of the level below, so
+// expiries up to 2^32 ticks ahead are kept without sorting. Timers are
+// intrusive list nodes; Schedule() and Cancel() are O(1), and a timer
+// parked on an upper level is moved down once when its slot comes round.
+// Expiries further out than 2^32 ticks wait on the top level and are
+// re-filed until they come within range.
+//
+// Not thread-safe; the owner serializes all calls.
+class TimerWheel {
+public:
+  class Timer {
+  public:
+    Timer() : prev_(nullptr), next_(nullptr), expiry_(0) {}
+
+    bool IsScheduled() const { return next_ != nullptr; }
+    uint64_t expiry() const { return expiry_; }
+
+  private:
+    friend class TimerWheel;
+
+    Timer *prev_;
+    Timer *next_;
+    uint64_t expiry_;
+  };
+
+  static const uint64_t NO_EVENT = ~uint64_t(0);
+
+  explicit TimerWheel(uint64_t now = 0);
+
+  TimerWheel(const TimerWheel &) = delete;
+  TimerWheel &operator=(const TimerWheel &) = delete;
+
+  // Files |timer| to expire at tick |expiry|, or at the next tick if that
+  // has already passed. |timer| must not be scheduled already.
+  void Schedule(Timer *timer, uint64_t expiry);
+
+  // Does nothing if |timer| is not scheduled.
+  void Cancel(Timer *timer);
+
+  // Moves the wheel forward to |now| and appends every timer that expired
+  // on the way to |expired|, in expiry order. They are no longer
+  // scheduled when this returns. Costs one step per expiry or cascade,
+  // not per tick.
+  void Advance(uint64_t now, std::vector<Timer *> *expired);
+
+  // The first tick after now() at which Advance() has something to do:
+  // an expiry or a cascade from an upper level. NO_EVENT when empty.
+  uint64_t NextEventTick() const;
+
+  uint64_t now() const { return now_; }
+  size_t size() const { return size_; }
+
+private:
+  static const int LEVELS = 4;
+  static const int SLOT_BITS = 8;
+  static const int SLOTS = 1 << SLOT_BITS;
+  static const uint64_t SLOT_MASK = SLOTS - 1;
+
+  // Sentinel-headed circular list.
+  struct Slot {
+    Timer head;
+  };
+
+  void Insert(Timer *timer);
+
+  static void Link(Slot *slot, Timer *timer);
+  static void Unlink(Timer *timer);
+
+  // Re-files every timer of |level|'s |index| slot; returns |index|.
+  int Cascade(int level, int index);
+
+  uint64_t now_;
+  size_t size_;
+  Slot slots_[LEVELS][SLOTS];
+};
+
+}  // namespace base
+
+#endif  // TIMER_WHEEL_H_
\ No newline at end of file
@@ -0,0 +1,96 @@
+﻿#include "waitable_event.h"
+#include "futex.h"
+#if defined(_WIN32)
+#include "pch.h"
+#endif
+
+namespace base {
+
+WaitableEvent::WaitableEvent(ResetPolicy reset_policy,
+                             InitialState initial_state)
+    : reset_policy_(reset_policy),
+      state_(initial_state == InitialState::SIGNALED ? SIGNALED : 0) {
+}
+
+void WaitableEvent::Signal() {
+  // The exchange clears WAITERS: a MANUAL event wakes everyone, and an
+  // AUTOMATIC waiter that takes the signal after parking sets it again.
+  // Only the address is used once the signal is visible.
+  std::atomic<int32_t> *address = &state_;
+  bool automatic = reset_policy_ == ResetPolicy::AUTOMATIC;
+  if (!(state_.exchange(SIGNALED, std::memory_order_acq_rel) & WAITERS))
+    return;
+  if (automatic)
+    FutexWakeOne(address);
+  else
+    FutexWakeAll(address);
+}
+
+void WaitableEvent::Reset() {
+  // Leaves WAITERS alone: parked threads still need the next Signal().
+  state_.fetch_and(~SIGNALED, std::memory_order_relaxed);
+}
+
+bool WaitableEvent::IsSignaled() {
+  return TryConsume(false);
+}
+
+void WaitableEvent::Wait() {
+  for (int spins = MaxSpinCount(); spins > 0; spins--) {
+    if (TryConsume(false))
+      return;
+    SpinPause();
+  }
+  bool parked = false;
+  while (!TryConsume(parked)) {
+    int32_t expected = PrepareToPark();
+    if (expected == 0)
+      continue;
+    FutexWait(&state_, expected);
+    parked = true;
+  }
+}
+
+bool WaitableEvent::TimedWait(std::chrono::nanoseconds max_time) {
+  if (TryConsume(false))
+    return true;
+  std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::now() + max_time;
+  bool parked = false;
+  while (!TryConsume(parked)) {
+    std::chrono::nanoseconds left = deadline - std::chrono::steady_clock::now();
+    if (left <= std::chrono::nanoseconds::zero())
+      return false;
+    int32_t expected = PrepareToPark();
+    if (expected == 0)
+      continue;
+    FutexWaitFor(&state_, expected, left);
+    parked = true;
+  }
+  return true;
+}
+
+bool WaitableEvent::TryConsume(bool parked) {
+  int32_t state = state_.load(std::memory_order_acquire);
+  if (reset_policy_ == ResetPolicy::MANUAL)
+    return (state & SIGNALED) != 0;
+  while (state & SIGNALED) {
+    int32_t next = (state & ~SIGNALED) | (parked ? WAITERS : 0);
+    if (state_.compare_exchange_weak(state, next, std::memory_order_acquire))
+      return true;
+  }
+  return false;
+}
+
+int32_t WaitableEvent::PrepareToPark() {
+  int32_t state = state_.load(std::memory_order_relaxed);
+  if (state & SIGNALED)
+    return 0;
+  if (!(state & WAITERS) &&
+      !state_.compare_exchange_strong(state, state | WAITERS,
+                                      std::memory_order_relaxed))
+    return 0;
+  return WAITERS;
+}
+
+}  // namespace base
\ No newline at end of file
@@ -0,0 +1,69 @@
+﻿#ifndef WAITABLE_EVENT_H_
+#define WAITABLE_EVENT_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+
+namespace base {
+
+// Manual- or auto-reset event in one futex word holding the signal and a
+// flag for parked waiters. Wait() polls briefly before parking, and
+// Signal() only enters the kernel when a thread is parked. Signal() reads
+// nothing of the event after publishing the signal, so a waiter may
+// destroy it as soon as Wait() returns.
+class WaitableEvent {
+public:
+  enum class ResetPolicy {
+    MANUAL,
+    // Each Signal() releases one Wait() and resets the event.
+    AUTOMATIC
+  };
+
+  enum class InitialState {
+    SIGNALED,
+    NOT_SIGNALED
+  };
+
+  explicit WaitableEvent(
+      ResetPolicy reset_policy = ResetPolicy::MANUAL,
+      InitialState initial_state = InitialState::NOT_SIGNALED);
+
+  WaitableEvent(const WaitableEvent &) = delete;
+  WaitableEvent &operator=(const WaitableEvent &) = delete;
+
+  void Signal();
+  void Reset();
+
+  // Consumes the signal of an AUTOMATIC event.
+  bool IsSignaled();
+
+  void Wait();
+
+  // False if |max_time| passed first.
+  bool TimedWait(std::chrono::nanoseconds max_time);
+
+private:
+  enum : int32_t {
+    SIGNALED = 1,
+    // Some thread may be parked on |state_|.
+    WAITERS = 2
+  };
+
+  // Takes the signal (AUTOMATIC) or checks it (MANUAL). A waiter that has
+  // parked passes |parked| so that taking the signal keeps WAITERS set
+  // for the threads Signal() did not wake.
+  bool TryConsume(bool parked);
+
+  // Sets WAITERS unless the event is signaled. Returns the value to park
+  // on, or 0 to try consuming again.
+  int32_t PrepareToPark();
+
+  const ResetPolicy reset_policy_;
+  std::atomic<int32_t> state_;
+};
+
+}  // namespace base
+
+#endif  // WAITABLE_EVENT_H_
\ No newline at end of file
@@ -0,0 +1,128 @@
+﻿#ifndef WORK_STEALING_DEQUE_H_
+#define WORK_STEALING_DEQUE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace base {
+
+// Chase-Lev deque of T pointers: the owning thread pushes and pops at the
+// bottom without locking, other threads steal from the top. Based on
+// "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al.,
+// PPoPP 2013), with seq_cst accesses in place of the stand-alone fences.
+// The ring grows when full; old rings are kept until the deque is
+// destroyed because a thief may still be reading one.
+template <typename T>
+class WorkStealingDeque {
+public:
+  explicit WorkStealingDeque(size_t initial_capacity = 256)
+      : top_(0), bottom_(0) {
+    size_t capacity = 1;
+    while (capacity < initial_capacity)
+      capacity <<= 1;
+    rings_.push_back(std::make_unique<Ring>(capacity));
+    ring_.store(rings_.back().get(), std::memory_order_relaxed);
+  }
+
+  WorkStealingDeque(const WorkStealingDeque &) = delete;
+  WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+  // Owner thread only.
+  void Push(T *item) {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    int64_t top = top_.load(std::memory_order_acquire);
+    Ring *ring = ring_.load(std::memory_order_relaxed);
+    if (bottom - top >= static_cast<int64_t>(ring->capacity))
+      ring = Grow(ring, top, bottom);
+    ring->Put(bottom, item);
+    bottom_.store(bottom + 1, std::memory_order_release);
+  }
+
+  // Owner thread only. Newest item first; null when empty or when the last
+  // item was lost to a thief.
+  T *Pop() {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    Ring *ring = ring_.load(std::memory_order_relaxed);
+    bottom_.store(bottom, std::memory_order_seq_cst);
+    int64_t top = top_.load(std::memory_order_seq_cst);
+    if (top > bottom) {
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    T *item = ring->Get(bottom);
+    if (top == bottom) {
+      // Last item: race the thieves for it.
+      if (!top_.compare_exchange_strong(top, top + 1,
+                                        std::memory_order_seq_cst,
+                                        std::memory_order_relaxed))
+        item = nullptr;
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return item;
+  }
+
+  // Any thread. Oldest item first; null when empty or when another thread
+  // won the race for it.
+  T *Steal() {
+    int64_t top = top_.load(std::memory_order_seq_cst);
+    int64_t bottom = bottom_.load(std::memory_order_seq_cst);
+    if (top >= bottom)
+      return nullptr;
+    Ring *ring = ring_.load(std::memory_order_acquire);
+    T *item = ring->Get(top);
+    if (!top_.compare_exchange_strong(top, top + 1,
+                                      std::memory_order_seq_cst,
+                                      std::memory_order_relaxed))
+      return nullptr;
+    return item;
+  }
+
+  // Approximate when called from a thread other than the owner.
+  bool IsEmpty() const {
+    return bottom_.load(std::memory_order_seq_cst) <=
+           top_.load(std::memory_order_seq_cst);
+  }
+
+private:
+  struct Ring {
+    explicit Ring(size_t size)
+        : capacity(size),
+          mask(size - 1),
+          slots(new std::atomic<T *>[size]) {}
+
+    T *Get(int64_t index) const {
+      return slots[index & mask].load(std::memory_order_relaxed);
+    }
+
+    void Put(int64_t index, T *item) {
+      slots[index & mask].store(item, std::memory_order_relaxed);
+    }
+
+    const size_t capacity;
+    const size_t mask;
+    std::unique_ptr<std::atomic<T *>[]> slots;
+  };
+
+  Ring *Grow(Ring *ring, int64_t top, int64_t bottom) {
+    rings_.push_back(std::make_unique<Ring>(ring->capacity * 2));
+    Ring *grown = rings_.back().get();
+    for (int64_t i = top; i < bottom; i++)
+      grown->Put(i, ring->Get(i));
+    ring_.store(grown, std::memory_order_release);
+    return grown;
+  }
+
+  std::atomic<int64_t> top_;
+  std::atomic<int64_t> bottom_;
+  std::atomic<Ring *> ring_;
+  // Owned by the owner thread; every ring ever used.
+  std::vector<std::unique_ptr<Ring>> rings_;
+};
+
+}  // namespace base
+
+#endif  // WORK_STEALING_DEQUE_H_
\ No newline at end of file
@@ -0,0 +1,380 @@
+﻿#include "work_stealing_pool.h"
+#if defined(_WIN32)
+#include "pch.h"
+#endif
+
+namespace base {
+
+class WorkStealingPool::Worker : public SimpleThread {
+public:
+  Worker(WorkStealingPool *pool, int index, const ThreadOptions &options)
+      : SimpleThread(options),
+        pool_(pool),
+        node_(options.numa_node),
+        level_(kPriorityLevels),
+        random_state_(0x9e3779b97f4a7c15ULL * (index + 1)),
+        buffer_(nullptr),
+        buffer_size_(0) {}
+
+  ~Worker() override {
+    FreeNodeLocal(buffer_, buffer_size_);
+  }
+
+  void Run() override {
+    current_ = this;
+    pool_->WorkerMain(this);
+    current_ = nullptr;
+  }
+
+  // xorshift64, for picking steal victims.
+  uint64_t NextRandom() {
+    random_state_ ^= random_state_ << 13;
+    random_state_ ^= random_state_ >> 7;
+    random_state_ ^= random_state_ << 17;
+    return random_state_;
+  }
+
+  static Worker *current() { return current_; }
+
+  WorkStealingPool *pool() const { return pool_; }
+
+  int node() const { return node_; }
+
+  // Level of the item running on this worker.
+  int level() const { return level_; }
+  void set_level(int level) { level_ = level; }
+
+  void *Buffer(size_t size) {
+    if (size > buffer_size_) {
+      FreeNodeLocal(buffer_, buffer_size_);
+      buffer_ = AllocateNodeLocal(size, node_);
+      buffer_size_ = buffer_ ? size : 0;
+    }
+    return buffer_;
+  }
+
+  WorkStealingDeque<WorkStealingPool::Delegate> &deque(int level) {
+    return deques_[level];
+  }
+
+private:
+  static thread_local Worker *current_;
+
+  WorkStealingPool *pool_;
+  const int node_;
+  int level_;
+  uint64_t random_state_;
+  WorkStealingDeque<WorkStealingPool::Delegate> deques_[kPriorityLevels];
+  void *buffer_;
+  size_t buffer_size_;
+};
+
+thread_local WorkStealingPool::Worker *WorkStealingPool::Worker::current_ =
+    nullptr;
+
+namespace {
+
+WorkStealingPool::Options OptionsWithPriority(ThreadPriority priority) {
+  WorkStealingPool::Options options;
+  options.priority = priority;
+  return options;
+}
+
+int64_t NowNanoseconds() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace
+
+WorkStealingPool::WorkStealingPool(int num_threads, ThreadPriority priority)
+    : WorkStealingPool(num_threads, OptionsWithPriority(priority)) {
+}
+
+WorkStealingPool::WorkStealingPool(int num_threads, const Options &options)
+    : num_threads_(num_threads > 0 ? num_threads : 1),
+      options_(options),
+      park_cv_(&park_lock_),
+      parked_(0),
+      joining_(false),
+      started_(false) {
+  for (int level = 0; level < kPriorityLevels; level++) {
+    injected_[level].store(0, std::memory_order_relaxed);
+    pending_[level].store(0, std::memory_order_relaxed);
+    last_served_[level].store(0, std::memory_order_relaxed);
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  if (started_)
+    JoinAll();
+}
+
+void WorkStealingPool::Start() {
+  if (started_)
+    return;
+  joining_ = false;
+  // All deques exist before any worker can try to steal from them.
+  std::vector<ThreadOptions> plan = PlanThreadPlacement(
+      num_threads_, options_.placement, options_.pin_to_cpu,
+      options_.priority);
+  for (int i = 0; i < num_threads_; i++) {
+    if (!options_.name_prefix.empty())
+      plan[i].name = options_.name_prefix + std::to_string(i);
+    workers_.push_back(std::make_unique<Worker>(this, i, plan[i]));
+  }
+  for (std::unique_ptr<Worker> &worker : workers_)
+    worker->Start();
+  started_ = true;
+}
+
+void WorkStealingPool::JoinAll() {
+  if (!started_)
+    return;
+  {
+    AutoLock lock(park_lock_);
+    joining_ = true;
+  }
+  park_cv_.Broadcast();
+  for (std::unique_ptr<Worker> &worker : workers_)
+    worker->Join();
+  workers_.clear();
+  started_ = false;
+}
+
+bool WorkStealingPool::RunsTasksInCurrentThread() const {
+  Worker *worker = Worker::current();
+  return worker && worker->pool() == this;
+}
+
+// static
+int WorkStealingPool::CurrentWorkerNode() {
+  Worker *worker = Worker::current();
+  return worker ? worker->node() : -1;
+}
+
+// static
+void *WorkStealingPool::CurrentWorkerBuffer(size_t size) {
+  Worker *worker = Worker::current();
+  return worker ? worker->Buffer(size) : nullptr;
+}
+
+// static
+bool WorkStealingPool::ShouldYield() {
+  Worker *worker = Worker::current();
+  if (!worker)
+    return false;
+  WorkStealingPool *pool = worker->pool();
+  for (int level = 0; level < worker->level(); level++) {
+    if (pool->pending_[level].load(std::memory_order_relaxed) > 0)
+      return true;
+  }
+  return false;
+}
+
+// static
+bool WorkStealingPool::YieldToHigherPriority() {
+  Worker *worker = Worker::current();
+  if (!worker)
+    return false;
+  WorkStealingPool *pool = worker->pool();
+  bool ran = false;
+  int level = 0;
+  while (Delegate *delegate =
+             pool->NextWork(worker, worker->level(), false, &level)) {
+    pool->RunItem(worker, delegate, level);
+    ran = true;
+  }
+  return ran;
+}
+
+// static
+int WorkStealingPool::PriorityLevel(ThreadPriority priority) {
+  switch (priority) {
+    case ThreadPriority::REALTIME_AUDIO:
+      return 0;
+    case ThreadPriority::NORMAL:
+      return 1;
+    case ThreadPriority::BACKGROUND:
+      return 2;
+  }
+  return 1;
+}
+
+void WorkStealingPool::AddWork(Delegate *delegate,
+                               int repeat_count,
+                               ThreadPriority priority) {
+  if (repeat_count <= 0)
+    return;
+  int level = PriorityLevel(priority);
+  int64_t queued =
+      pending_[level].fetch_add(repeat_count, std::memory_order_seq_cst);
+  // A level's wait behind the others starts when it stops being empty.
+  if (queued == 0 && level > 0)
+    last_served_[level].store(NowNanoseconds(), std::memory_order_relaxed);
+  if (RunsTasksInCurrentThread()) {
+    Worker *worker = Worker::current();
+    for (int i = 0; i < repeat_count; i++)
+      worker->deque(level).Push(delegate);
+  } else {
+    AutoLock lock(injection_lock_);
+    for (int i = 0; i < repeat_count; i++)
+      injection_queues_[level].push_back(delegate);
+    injected_[level].fetch_add(repeat_count, std::memory_order_seq_cst);
+  }
+  Signal(repeat_count);
+}
+
+void WorkStealingPool::WorkerMain(Worker *worker) {
+  while (true) {
+    int level = 0;
+    Delegate *delegate = NextWork(worker, kPriorityLevels, true, &level);
+    if (delegate) {
+      RunItem(worker, delegate, level);
+      continue;
+    }
+    if (!Park())
+      break;
+  }
+}
+
+WorkStealingPool::Delegate *WorkStealingPool::NextWork(Worker *worker,
+                                                       int levels,
+                                                       bool aging,
+                                                       int *level) {
+  if (aging) {
+    int aged = AgedLevel();
+    if (aged >= 0) {
+      if (Delegate *delegate = TakeLevel(worker, aged)) {
+        *level = aged;
+        return delegate;
+      }
+    }
+  }
+  for (int i = 0; i < levels; i++) {
+    if (pending_[i].load(std::memory_order_acquire) <= 0)
+      continue;
+    if (Delegate *delegate = TakeLevel(worker, i)) {
+      *level = i;
+      return delegate;
+    }
+  }
+  return nullptr;
+}
+
+WorkStealingPool::Delegate *WorkStealingPool::TakeLevel(Worker *worker,
+                                                        int level) {
+  Delegate *delegate = worker->deque(level).Pop();
+  if (!delegate)
+    delegate = TakeInjected(level);
+  if (!delegate)
+    delegate = Steal(worker, level);
+  if (delegate)
+    pending_[level].fetch_sub(1, std::memory_order_relaxed);
+  return delegate;
+}
+
+int WorkStealingPool::AgedLevel() const {
+  // Only a level with more urgent work queued ahead of it is waiting; the
+  // clock is not read otherwise.
+  bool behind = pending_[0].load(std::memory_order_relaxed) > 0;
+  int64_t now = 0;
+  for (int level = 1; level < kPriorityLevels; level++) {
+    bool queued = pending_[level].load(std::memory_order_relaxed) > 0;
+    if (queued && behind) {
+      if (now == 0)
+        now = NowNanoseconds();
+      int64_t waited = now - last_served_[level].load(std::memory_order_relaxed);
+      if (waited >= std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        options_.aging_interval).count())
+        return level;
+    }
+    behind = behind || queued;
+  }
+  return -1;
+}
+
+void WorkStealingPool::RunItem(Worker *worker, Delegate *delegate, int level) {
+  if (level > 0)
+    last_served_[level].store(NowNanoseconds(), std::memory_order_relaxed);
+  int outer = worker->level();
+  worker->set_level(level);
+  delegate->Run();
+  worker->set_level(outer);
+}
+
+WorkStealingPool::Delegate *WorkStealingPool::TakeInjected(int level) {
+  if (injected_[level].load(std::memory_order_seq_cst) == 0)
+    return nullptr;
+  AutoLock lock(injection_lock_);
+  std::deque<Delegate *> &queue = injection_queues_[level];
+  if (queue.empty())
+    return nullptr;
+  Delegate *delegate = queue.front();
+  queue.pop_front();
+  injected_[level].fetch_sub(1, std::memory_order_relaxed);
+  return delegate;
+}
+
+WorkStealingPool::Delegate *WorkStealingPool::Steal(Worker *worker,
+                                                    int level) {
+  int count = static_cast<int>(workers_.size());
+  if (count < 2)
+    return nullptr;
+  // One pass over the other workers from a random start, so that thieves
+  // spread out instead of all hitting the same victim.
+  int start = static_cast<int>(worker->NextRandom() % count);
+  for (int i = 0; i < count; i++) {
+    Worker *victim = workers_[(start + i) % count].get();
+    if (victim == worker)
+      continue;
+    Delegate *delegate = victim->deque(level).Steal();
+    if (delegate)
+      return delegate;
+  }
+  return nullptr;
+}
+
+bool WorkStealingPool::HasWork() const {
+  for (int level = 0; level < kPriorityLevels; level++) {
+    if (injected_[level].load(std::memory_order_seq_cst) > 0)
+      return true;
+    for (const std::unique_ptr<Worker> &worker : workers_) {
+      if (!worker->deque(level).IsEmpty())
+        return true;
+    }
+  }
+  return false;
+}
+
+void WorkStealingPool::Signal(int count) {
+  // Pairs with the increment in Park(): either this sees the parked
+  // worker, or the worker sees the new item when it checks again.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int parked = parked_.load(std::memory_order_seq_cst);
+  if (parked == 0)
+    return;
+  {
+    // A worker between its last check and the wait still holds the lock.
+    AutoLock lock(park_lock_);
+  }
+  if (count >= parked) {
+    park_cv_.Broadcast();
+  } else {
+    while (count--)
+      park_cv_.Signal();
+  }
+}
+
+bool WorkStealingPool::Park() {
+  AutoLock lock(park_lock_);
+  parked_.fetch_add(1, std::memory_order_seq_cst);
+  bool work = HasWork();
+  if (!work && !joining_)
+    park_cv_.Wait();
+  parked_.fetch_sub(1, std::memory_order_relaxed);
+  // Joining workers only leave once nothing is queued anywhere.
+  return work || !joining_ || HasWork();
+}
+
+}  // namespace base
\ No newline at end of file
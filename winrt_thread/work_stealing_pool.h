@@ -0,0 +1,170 @@
+﻿#ifndef WORK_STEALING_POOL_H_
+#define WORK_STEALING_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "condition_variable.h"
+#include "cpu_topology.h"
+#include "lock.h"
+#include "simple_thread.h"
+#include "work_stealing_deque.h"
+
+namespace base {
+
+// Keeps |num_threads| SimpleThread workers alive and runs
+// DelegateSimpleThread::Delegate work items on them, so a short task costs
+// a queue operation rather than a thread start and join.
+//
+// Work added from one of the pool's own workers goes onto that worker's
+// deque and is run newest first; work added from any other thread goes
+// through a shared injection queue. Idle workers steal the oldest item
+// from a random other worker and park on a futex condition variable once
+// there is nothing left anywhere.
+//
+// Every item carries a ThreadPriority and each priority has its own
+// deques and injection queue. Workers take REALTIME_AUDIO work before
+// NORMAL before BACKGROUND; a lower priority that has waited longer than
+// Options::aging_interval without any of its items starting is served
+// next regardless, so bulk work is slowed down but never starved. Long
+// items should call YieldToHigherPriority() between chunks, which runs
+// more urgent work on the spot, since a running item is never preempted.
+//
+// Workers can be placed over the machine's cores and NUMA nodes. A placed
+// worker's CurrentWorkerBuffer(), and any deque ring it grows, come from
+// its node; the Worker itself and its initial rings are allocated by the
+// thread calling Start(), before any worker can steal from them.
+//
+// The pool does not own the delegates, which must outlive their run.
+class WorkStealingPool {
+public:
+  typedef DelegateSimpleThread::Delegate Delegate;
+
+  struct Options {
+    Options()
+        : priority(ThreadPriority::NORMAL),
+          placement(ThreadPlacement::NONE),
+          pin_to_cpu(false),
+          aging_interval(std::chrono::milliseconds(20)) {}
+
+    ThreadPriority priority;
+    ThreadPlacement placement;
+    // Bind each placed worker to one CPU instead of its whole node.
+    bool pin_to_cpu;
+    // When set, workers are named |name_prefix| followed by their index.
+    std::string name_prefix;
+    // How long queued work may wait behind higher priorities.
+    std::chrono::microseconds aging_interval;
+  };
+
+  explicit WorkStealingPool(int num_threads,
+                            ThreadPriority priority = ThreadPriority::NORMAL);
+  WorkStealingPool(int num_threads, const Options &options);
+  ~WorkStealingPool();
+
+  void Start();
+
+  // Runs every item added so far, and any the items themselves add, then
+  // stops and joins the workers. Called by the destructor if needed.
+  void JoinAll();
+
+  // Runs |delegate->Run()| |repeat_count| times at |priority|.
+  void AddWork(Delegate *delegate,
+               int repeat_count = 1,
+               ThreadPriority priority = ThreadPriority::NORMAL);
+
+  int num_threads() const { return num_threads_; }
+
+  // True when called from one of this pool's workers.
+  bool RunsTasksInCurrentThread() const;
+
+  // NUMA node of the calling worker; -1 off the pool's workers or when the
+  // worker was not placed.
+  static int CurrentWorkerNode();
+
+  // At least |size| bytes of scratch memory owned by the calling worker and
+  // allocated on its node. Valid until the worker's next call or the end of
+  // JoinAll(); null when not called from a worker.
+  static void *CurrentWorkerBuffer(size_t size);
+
+  // From a running item: whether work of higher priority than the item's
+  // own is waiting.
+  static bool ShouldYield();
+
+  // From a running item: runs waiting work of higher priority than the
+  // item's own, on this thread, until there is none. Returns whether any
+  // ran. A no-op off the pool's workers.
+  static bool YieldToHigherPriority();
+
+private:
+  class Worker;
+
+  // Queue index of a priority; 0 is the most urgent.
+  static const int kPriorityLevels = 3;
+
+  static int PriorityLevel(ThreadPriority priority);
+
+  void WorkerMain(Worker *worker);
+
+  // Next item for |worker| among the first |levels| levels, most urgent
+  // first, unless |aging| finds a lower level that has waited too long.
+  // Stores the item's level in |level|.
+  Delegate *NextWork(Worker *worker, int levels, bool aging, int *level);
+
+  // From |worker|'s own deque, then the injection queue, then the other
+  // workers' deques.
+  Delegate *TakeLevel(Worker *worker, int level);
+
+  // A level past the first whose work has waited over the aging interval,
+  // or -1.
+  int AgedLevel() const;
+
+  void RunItem(Worker *worker, Delegate *delegate, int level);
+
+  Delegate *TakeInjected(int level);
+
+  Delegate *Steal(Worker *worker, int level);
+
+  bool HasWork() const;
+
+  // Wakes up to |count| parked workers.
+  void Signal(int count);
+
+  // Blocks |worker| until there may be work. Returns false once the pool
+  // is joining and nothing is left.
+  bool Park();
+
+  const int num_threads_;
+  const Options options_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+
+  Lock injection_lock_;
+  std::deque<Delegate *> injection_queues_[kPriorityLevels];
+  // Readable without |injection_lock_|, for the idle checks.
+  std::atomic<size_t> injected_[kPriorityLevels];
+  // Items added and not yet taken, per level; counted before they are
+  // queued, so never below the real number.
+  std::atomic<int64_t> pending_[kPriorityLevels];
+  // Steady clock, in nanoseconds, when an item of the level last started
+  // or when the level last went from empty to non-empty.
+  std::atomic<int64_t> last_served_[kPriorityLevels];
+
+  Lock park_lock_;
+  ConditionVariable park_cv_;
+  std::atomic<int> parked_;
+  std::atomic<bool> joining_;
+  bool started_;
+};
+
+typedef WorkStealingPool DelegateSimpleThreadPool;
+
+}  // namespace base
+
+#endif  // WORK_STEALING_POOL_H_
\ No newline at end of file